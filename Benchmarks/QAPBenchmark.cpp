@@ -0,0 +1,529 @@
+/*
+  ==============================================================================
+
+    QAPBenchmark.cpp
+    Standalone benchmark for the QAP processor, the procedural models and the
+    library index. Results are written as JSON so they can be compared from
+    one commit to the next.
+
+    Usage: QAPBenchmark [--output=results.json] [--label=name] [--quick]
+                        [--library-sizes=10000,100000,1000000] [--seconds=5]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <numeric>
+#include "PluginProcessor.h"
+#include "ExplosionImpl.h"
+#include "FireImpl.h"
+
+namespace
+{
+    struct Settings
+    {
+        juce::File output;
+        juce::String label;
+        double secondsPerRun = 5.0;
+        juce::Array<int> blockSizes { 32, 64, 128, 256, 512, 1024, 2048 };
+        juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+        juce::Array<int> librarySizes { 10000, 100000, 1000000 };
+    };
+
+    struct Timing
+    {
+        std::vector<double> samples;    // seconds per measured call
+
+        void add (double seconds)   { samples.push_back (seconds); }
+
+        double sum() const          { return std::accumulate (samples.begin(), samples.end(), 0.0); }
+        double mean() const         { return samples.empty() ? 0.0 : sum() / (double) samples.size(); }
+
+        double percentile (double p)
+        {
+            if (samples.empty())
+                return 0.0;
+
+            auto index = (size_t) juce::jlimit (0.0, (double) samples.size() - 1.0, p * (double) (samples.size() - 1));
+            std::nth_element (samples.begin(), samples.begin() + (long) index, samples.end());
+            return samples[index];
+        }
+    };
+
+    double nowSeconds()
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks());
+    }
+
+    juce::var makeObject (std::initializer_list<std::pair<const char*, juce::var>> properties)
+    {
+        auto* object = new juce::DynamicObject();
+
+        for (auto& property : properties)
+            object->setProperty (property.first, property.second);
+
+        return juce::var (object);
+    }
+
+    //==============================================================================
+    // A ten second noise burst, so the transport scenarios read real audio through the library.
+    juce::File createPreviewFile (const juce::File& folder, double sampleRate)
+    {
+        folder.createDirectory();
+        auto file = folder.getChildFile ("bench_preview.wav");
+
+        if (file.existsAsFile())
+            return file;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (file.createOutputStream().release(),
+                                                                               sampleRate, 2, 24, {}, 0));
+        if (writer == nullptr)
+            return {};
+
+        juce::AudioBuffer<float> noise (2, (int) sampleRate);
+        juce::Random random (1234);
+
+        for (int second = 0; second < 10; ++second)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < noise.getNumSamples(); ++i)
+                    noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+            writer->writeFromAudioSampleBuffer (noise, 0, noise.getNumSamples());
+        }
+
+        return file;
+    }
+
+    enum Scenario
+    {
+        idle      = 0,
+        transport = 1 << 0,
+        explosion = 1 << 1,
+        fire      = 1 << 2,
+        baked     = 1 << 3      // the models play pre-rendered material
+    };
+
+    juce::String getScenarioName (int scenario)
+    {
+        if (scenario == idle)
+            return "idle";
+
+        juce::StringArray parts;
+        if (scenario & transport)  parts.add ("transport");
+        if (scenario & explosion)  parts.add ("explosion");
+        if (scenario & fire)       parts.add ("fire");
+        if (scenario & baked)      parts.add ("baked");
+        return parts.joinIntoString ("+");
+    }
+
+    juce::var benchmarkProcessBlock (const Settings& settings, const juce::File& previewFolder,
+                                     double sampleRate, int blockSize, int scenario, ProceduralRenderer::Mode mode,
+                                     bool parallel = false, int oversamplingChoice = 0)
+    {
+        QAPAudioProcessor processor;
+        auto* oversampling = processor.parameters.getParameter (ModelRegistry::oversamplingParameterId);
+        oversampling->setValueNotifyingHost (oversampling->convertTo0to1 ((float) oversamplingChoice));
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        processor.proceduralRenderer.setMode (mode);
+        processor.renderPool.setEnabled (parallel);
+
+        juce::AudioBuffer<float> buffer (juce::jmax (processor.getTotalNumInputChannels(),
+                                                     processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+
+        if (scenario & transport)
+        {
+            processor.loadAllWavFilesFromFolder (previewFolder);
+            processor.playWavFileByName ("bench_preview.wav");
+            processor.audition.waitForPendingRequests (5000);
+        }
+
+        if (scenario & baked)
+        {
+            // Time playback only, not the bake: wait until every model's material is complete.
+            processor.parameters.getParameter (ModelRegistry::bakedParameterId)->setValueNotifyingHost (1.0f);
+
+            for (int i = 0; i < processor.models.size(); ++i)
+                for (int waited = 0; waited < 10000 && ! processor.models[i].isBakedReady(); waited += 10)
+                    juce::Thread::sleep (10);
+        }
+
+        if (scenario & explosion)  processor.triggerModel ("explosion");
+        if (scenario & fire)       processor.triggerModel ("fire");
+
+        const int numBlocks = juce::jmax (1, (int) (settings.secondsPerRun * sampleRate / blockSize));
+        Timing timing;
+        timing.samples.reserve ((size_t) numBlocks);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            // Keep the scenario alive for the whole run: explosions ring out and go idle.
+            if ((scenario & explosion) && ! processor.isModelAwake ("explosion"))
+                processor.triggerModel ("explosion");
+
+            if ((scenario & transport) && ! processor.activity.isAwake (ActivityTracker::transport))
+                processor.playWavFileByName ("bench_preview.wav");
+
+            const auto start = nowSeconds();
+            processor.processBlock (buffer, midi);
+            timing.add (nowSeconds() - start);
+        }
+
+        processor.releaseResources();
+
+        const auto totalSamples = (double) numBlocks * blockSize;
+        const auto processed = timing.sum();
+
+        return makeObject ({
+            { "sampleRate",     sampleRate },
+            { "blockSize",      blockSize },
+            { "scenario",       getScenarioName (scenario) },
+            { "rendererMode",   mode == ProceduralRenderer::Mode::reference ? "reference" : "vectorised" },
+            { "renderPool",     parallel && processor.renderPool.shouldRunParallel (2, blockSize) },
+            { "oversampling",   processor.models.getOversampling() },
+            { "nsPerSample",    processed / totalSamples * 1.0e9 },
+            { "realtimeFactor", processed > 0.0 ? (totalSamples / sampleRate) / processed : 0.0 },
+            { "meanBlockUs",    timing.mean() * 1.0e6 },
+            { "p99BlockUs",     timing.percentile (0.99) * 1.0e6 },
+            { "maxBlockUs",     timing.percentile (1.0) * 1.0e6 }
+        });
+    }
+
+    // Serial vs. render pool on the same scenario; speedup is the ratio of mean block times.
+    juce::var benchmarkRenderPool (const Settings& settings, const juce::File& previewFolder,
+                                   double sampleRate, int blockSize, int scenario)
+    {
+        auto serial   = benchmarkProcessBlock (settings, previewFolder, sampleRate, blockSize, scenario, ProceduralRenderer::Mode::vectorised, false);
+        auto parallel = benchmarkProcessBlock (settings, previewFolder, sampleRate, blockSize, scenario, ProceduralRenderer::Mode::vectorised, true);
+
+        const double serialUs   = serial["meanBlockUs"];
+        const double parallelUs = parallel["meanBlockUs"];
+
+        return makeObject ({
+            { "sampleRate",       sampleRate },
+            { "blockSize",        blockSize },
+            { "scenario",         getScenarioName (scenario) },
+            { "parallelActive",   parallel["renderPool"] },
+            { "serialMeanUs",     serialUs },
+            { "parallelMeanUs",   parallelUs },
+            { "serialP99Us",      serial["p99BlockUs"] },
+            { "parallelP99Us",    parallel["p99BlockUs"] },
+            { "speedup",          parallelUs > 0.0 ? serialUs / parallelUs : 0.0 }
+        });
+    }
+
+    // Cost of each oversampling tier on the same scenario, relative to rendering at the host rate.
+    juce::var benchmarkOversampling (const Settings& settings, const juce::File& previewFolder,
+                                     double sampleRate, int blockSize, int scenario)
+    {
+        juce::Array<juce::var> tiers;
+        double baseUs = 0.0;
+
+        for (int choice = 0; choice < Oversampler::getFactorNames().size(); ++choice)
+        {
+            auto result = benchmarkProcessBlock (settings, previewFolder, sampleRate, blockSize, scenario,
+                                                 ProceduralRenderer::Mode::vectorised, false, choice);
+            const double meanUs = result["meanBlockUs"];
+
+            if (choice == 0)
+                baseUs = meanUs;
+
+            tiers.add (makeObject ({
+                { "factor",      Oversampler::factorForChoice (choice) },
+                { "meanBlockUs", meanUs },
+                { "p99BlockUs",  result["p99BlockUs"] },
+                { "relativeCost", baseUs > 0.0 ? meanUs / baseUs : 0.0 }
+            }));
+        }
+
+        return makeObject ({
+            { "sampleRate", sampleRate },
+            { "blockSize",  blockSize },
+            { "scenario",   getScenarioName (scenario) },
+            { "tiers",      tiers }
+        });
+    }
+
+    //==============================================================================
+    template <typename Model>
+    juce::var benchmarkModel (const char* name, const Settings& settings, double sampleRate, int blockSize,
+                              std::function<void (Model&)> start)
+    {
+        Model model;
+        model.initialize ((float) sampleRate);
+        start (model);
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        float* channels[] = { buffer.getWritePointer (0), buffer.getWritePointer (1) };
+        const int numBlocks = juce::jmax (1, (int) (settings.secondsPerRun * sampleRate / blockSize));
+        Timing timing;
+        timing.samples.reserve ((size_t) numBlocks);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            if (! model.isActive())
+                start (model);
+
+            buffer.clear();
+            const auto begin = nowSeconds();
+            model.fillBuffer (channels, blockSize);
+            timing.add (nowSeconds() - begin);
+        }
+
+        return makeObject ({
+            { "model",       name },
+            { "sampleRate",  sampleRate },
+            { "blockSize",   blockSize },
+            { "nsPerSample", timing.sum() / ((double) numBlocks * blockSize) * 1.0e9 },
+            { "p99BlockUs",  timing.percentile (0.99) * 1.0e6 }
+        });
+    }
+
+    //==============================================================================
+    const char* const vocabulary[] = { "explosion", "fire", "metal", "impact", "whoosh", "door", "glass", "wood",
+                                       "rain", "thunder", "debris", "crackle", "footstep", "engine", "ambience", "water" };
+
+    // Builds (or reuses) root/<a>/<b>/<words>_<n>.wav with a hundred files per folder.
+    juce::File createSyntheticLibrary (int numFiles)
+    {
+        auto root = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-bench-library-" + juce::String (numFiles));
+        auto marker = root.getChildFile (".complete");
+
+        if (marker.existsAsFile())
+            return root;
+
+        root.deleteRecursively();
+        juce::Random random (numFiles);
+
+        for (int i = 0; i < numFiles; ++i)
+        {
+            auto folder = root.getChildFile (juce::String (i / 10000)).getChildFile (juce::String ((i / 100) % 100));
+
+            if (i % 100 == 0)
+                folder.createDirectory();
+
+            auto name = juce::String (vocabulary[random.nextInt (juce::numElementsInArray (vocabulary))]) + "_"
+                      + juce::String (vocabulary[random.nextInt (juce::numElementsInArray (vocabulary))]) + "_"
+                      + juce::String (i).paddedLeft ('0', 7) + ".wav";
+
+            folder.getChildFile (name).create();
+        }
+
+        marker.create();
+        return root;
+    }
+
+    juce::var benchmarkLibrary (int numFiles)
+    {
+        auto root = createSyntheticLibrary (numFiles);
+
+        auto scanStart = nowSeconds();
+        auto index = LibraryIndex::scan (root);
+        auto scanSeconds = nowSeconds() - scanStart;
+
+        const char* const queries[] = { "e", "fire", "metal_impact", "0004", "thunder_debris_00", "nomatch" };
+        Timing search;
+
+        for (auto* query : queries)
+            for (int repeat = 0; repeat < 5; ++repeat)
+            {
+                auto start = nowSeconds();
+                auto matches = index->findMatches (query);
+                search.add (nowSeconds() - start);
+                juce::ignoreUnused (matches);
+            }
+
+        // Typos, so the BK-tree is searched for each word
+        const char* const typos[] = { "exploson", "thundr debri", "fotstep", "ambeince wter" };
+        Timing fuzzy;
+
+        for (auto* typo : typos)
+            for (int repeat = 0; repeat < 5; ++repeat)
+            {
+                auto start = nowSeconds();
+                auto matches = index->findMatches (typo);
+                fuzzy.add (nowSeconds() - start);
+                juce::ignoreUnused (matches);
+            }
+
+        // Filter plus a three-key sort over the metadata columns
+        LibraryQuery sorted = LibraryQuery::parse ("e date > 2000-01-01");
+        sorted.sortKeys = { { LibraryColumn::category, true }, { LibraryColumn::date, false }, { LibraryColumn::name, true } };
+        Timing query;
+
+        for (int repeat = 0; repeat < 10; ++repeat)
+        {
+            auto start = nowSeconds();
+            auto rows = index->runQuery (sorted);
+            query.add (nowSeconds() - start);
+            juce::ignoreUnused (rows);
+        }
+
+        // Facets: a tenth of the files tagged, one in a hundred favourite
+        auto databaseFile = root.getSiblingFile ("qap-bench-library-" + juce::String (numFiles) + ".qapdb");
+        double facetBuildSeconds = 0.0;
+        Timing facetQuery;
+
+        {
+            databaseFile.deleteFile();
+            LibraryDatabase database (databaseFile);
+
+            for (int id = 0; id < index->size(); id += 10)
+            {
+                database.setTag (index->getFile (id), "metal", true);
+
+                if (id % 100 == 0)
+                    database.setFavourite (index->getFile (id), true);
+            }
+
+            database.flush();
+
+            auto buildStart = nowSeconds();
+            auto facets = database.getFacets (index);
+            facetBuildSeconds = nowSeconds() - buildStart;
+
+            const auto faceted = LibraryQuery::parse ("tag:metal AND NOT favourite AND NOT played");
+
+            for (int repeat = 0; repeat < 10; ++repeat)
+            {
+                auto start = nowSeconds();
+                auto rows = index->runQuery (faceted, facets.get());
+                facetQuery.add (nowSeconds() - start);
+                juce::ignoreUnused (rows);
+            }
+        }
+
+        databaseFile.deleteFile();
+
+        juce::Random random (42);
+        Timing lookup;
+        const int numLookups = 10000;
+
+        for (int i = 0; i < numLookups && index->size() > 0; ++i)
+        {
+            auto name = index->getName (random.nextInt (index->size()));
+            auto start = nowSeconds();
+            auto file = index->getFile (name);
+            lookup.add (nowSeconds() - start);
+            juce::ignoreUnused (file);
+        }
+
+        return makeObject ({
+            { "files",          index->size() },
+            { "scanMs",         scanSeconds * 1.0e3 },
+            { "searchMeanMs",   search.mean() * 1.0e3 },
+            { "searchMaxMs",    search.percentile (1.0) * 1.0e3 },
+            { "fuzzySearchMs",  fuzzy.mean() * 1.0e3 },
+            { "sortedQueryMs",  query.mean() * 1.0e3 },
+            { "facetBuildMs",   facetBuildSeconds * 1.0e3 },
+            { "facetQueryMs",   facetQuery.mean() * 1.0e3 },
+            { "lookupMeanNs",   lookup.mean() * 1.0e9 },
+            { "pathBytesPerFile", index->size() > 0 ? (double) index->paths.getMemoryBytes() / index->size() : 0.0 },
+            { "nameBytesPerFile", index->size() > 0 ? (double) index->getNameMemoryBytes() / index->size() : 0.0 }
+        });
+    }
+
+    juce::Array<int> parseIntList (const juce::String& text)
+    {
+        juce::Array<int> values;
+
+        for (auto& token : juce::StringArray::fromTokens (text, ",", {}))
+            if (token.trim().getIntValue() > 0)
+                values.add (token.trim().getIntValue());
+
+        return values;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    Settings settings;
+    settings.label = args.containsOption ("--label") ? args.getValueForOption ("--label") : juce::String ("unlabelled");
+
+    if (args.containsOption ("--output"))
+        settings.output = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--output"));
+
+    if (args.containsOption ("--seconds"))
+        settings.secondsPerRun = juce::jmax (0.1, args.getValueForOption ("--seconds").getDoubleValue());
+
+    if (args.containsOption ("--library-sizes"))
+        settings.librarySizes = parseIntList (args.getValueForOption ("--library-sizes"));
+
+    if (args.containsOption ("--quick"))
+    {
+        settings.secondsPerRun = 0.5;
+        settings.blockSizes = { 64, 512 };
+        settings.sampleRates = { 48000.0 };
+        settings.librarySizes = { 10000 };
+    }
+
+    // Held for the whole run, so the cache counters add up over every scenario.
+    juce::SharedResourcePointer<MemoryBudget> memoryBudget;
+
+    auto previewFolder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-bench-preview");
+    createPreviewFile (previewFolder, 48000.0);
+
+    juce::Array<juce::var> processResults, poolResults, oversamplingResults, modelResults, libraryResults;
+    const int scenarios[] = { idle, transport, explosion, fire, explosion | fire, transport | explosion | fire,
+                              fire | baked, explosion | fire | baked };
+
+    for (auto sampleRate : settings.sampleRates)
+    {
+        for (auto blockSize : settings.blockSizes)
+        {
+            for (auto scenario : scenarios)
+            {
+                processResults.add (benchmarkProcessBlock (settings, previewFolder, sampleRate, blockSize, scenario, ProceduralRenderer::Mode::vectorised));
+
+                if (scenario & (explosion | fire))
+                    processResults.add (benchmarkProcessBlock (settings, previewFolder, sampleRate, blockSize, scenario, ProceduralRenderer::Mode::reference));
+            }
+
+            for (auto scenario : { explosion | fire, transport | explosion | fire })
+                poolResults.add (benchmarkRenderPool (settings, previewFolder, sampleRate, blockSize, scenario));
+
+            oversamplingResults.add (benchmarkOversampling (settings, previewFolder, sampleRate, blockSize, explosion | fire));
+
+            modelResults.add (benchmarkModel<nemisindo::Explosion> ("explosion", settings, sampleRate, blockSize,
+                                                                    [] (nemisindo::Explosion& model) { model.trigger(); }));
+            modelResults.add (benchmarkModel<nemisindo::Fire> ("fire", settings, sampleRate, blockSize,
+                                                               [] (nemisindo::Fire& model) { model.start(); }));
+
+            std::cerr << "done " << sampleRate << " Hz / " << blockSize << std::endl;
+        }
+    }
+
+    for (auto numFiles : settings.librarySizes)
+    {
+        libraryResults.add (benchmarkLibrary (numFiles));
+        std::cerr << "done library " << numFiles << std::endl;
+    }
+
+    auto results = makeObject ({
+        { "label",        settings.label },
+        { "timestamp",    juce::Time::getCurrentTime().toISO8601 (true) },
+        { "processBlock", processResults },
+        { "renderPool",   poolResults },
+        { "oversampling", oversamplingResults },
+        { "models",       modelResults },
+        { "library",      libraryResults },
+        { "memory",       juce::JSON::parse (MemoryBudget::toJSON (memoryBudget->getStats())) }
+    });
+
+    auto json = juce::JSON::toString (results);
+
+    if (settings.output != juce::File())
+        settings.output.replaceWithText (json);
+    else
+        std::cout << json << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,1226 @@
+/*
+  ==============================================================================
+
+    OfflineHost.cpp
+    Drives QAPAudioProcessor the way a plugin host would, but offline: no
+    audio device, no window, no host. Runs a set of correctness checks and
+    exits non-zero if any of them fails, so it can run under ctest.
+
+    Usage: QAPHeadlessHost [--render=out.wav] [--sample-rate=48000] [--block-size=512]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "PluginProcessor.h"
+#include "ProceduralModels.h"
+
+namespace
+{
+    int failures = 0;
+
+    void expect (bool condition, const juce::String& what)
+    {
+        std::cout << (condition ? "  ok    " : "  FAIL  ") << what << std::endl;
+
+        if (! condition)
+            ++failures;
+    }
+
+    //==============================================================================
+    // Host timeline in 4/4 that advances with every rendered block while `playing`.
+    struct HostTransport  : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying (playing);
+            info.setBpm (bpm);
+            info.setTimeSignature (TimeSignature { 4, 4 });
+            info.setTimeInSamples (samplePosition);
+            info.setTimeInSeconds ((double) samplePosition / sampleRate);
+            info.setPpqPosition ((double) samplePosition / sampleRate * bpm / 60.0
+                                   + ((samplePosition / errorPeriod) % 2 == 0 ? ppqError : -ppqError));
+            return info;
+        }
+
+        double sampleRate = 48000.0, bpm = 120.0;
+        bool playing = false;
+        juce::int64 samplePosition = 0;
+
+        // Host rounding: added to the reported position, in alternating sign every `errorPeriod` samples.
+        double ppqError = 0.0;
+        juce::int64 errorPeriod = 1;
+    };
+
+    // Minimal host: owns a processor, prepares it and pulls blocks from it.
+    struct OfflineHost
+    {
+        OfflineHost (double rate, int block)
+            : sampleRate (rate), blockSize (block)
+        {
+            transport.sampleRate = sampleRate;
+            processor.setPlayHead (&transport);
+            processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+            processor.prepareToPlay (sampleRate, blockSize);
+        }
+
+        ~OfflineHost()
+        {
+            processor.releaseResources();
+        }
+
+        // Renders `seconds` of output in host-sized blocks, optionally delivering `midi` in the first block.
+        juce::AudioBuffer<float> render (double seconds, const juce::MidiBuffer& midi = {})
+        {
+            const int numSamples = (int) (seconds * sampleRate);
+            const int numChannels = juce::jmax (processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+            juce::AudioBuffer<float> output (numChannels, numSamples);
+            juce::AudioBuffer<float> block (numChannels, blockSize);
+            juce::MidiBuffer blockMidi (midi);
+
+            for (int pos = 0; pos < numSamples; pos += blockSize)
+            {
+                const int n = juce::jmin (blockSize, numSamples - pos);
+                block.setSize (numChannels, n, false, false, true);
+
+                processor.processBlock (block, blockMidi);
+                blockMidi.clear();
+
+                if (transport.playing)
+                    transport.samplePosition += n;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    output.copyFrom (ch, pos, block, ch, 0, n);
+            }
+
+            return output;
+        }
+
+        double sampleRate;
+        int blockSize;
+        HostTransport transport;
+        QAPAudioProcessor processor;
+    };
+
+    float getParameter (QAPAudioProcessor& p, const char* id)
+    {
+        return p.parameters.getRawParameterValue (id)->load();
+    }
+
+    void setParameter (QAPAudioProcessor& p, const char* id, float plainValue)
+    {
+        auto* parameter = p.parameters.getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (plainValue));
+    }
+
+    //==============================================================================
+    void checkIdleIsSilent (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        auto out = host.render (1.0);
+
+        expect (out.getMagnitude (0, out.getNumSamples()) == 0.0f, "idle instance outputs silence");
+        expect (host.processor.activity.isIdle(), "idle instance reports idle");
+    }
+
+    void checkExplosionRingsOutAndSleeps (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        host.processor.triggerModel ("explosion");
+
+        auto tail = host.processor.getTailLengthSeconds();
+        auto out = host.render (tail + 1.0);
+
+        expect (out.getMagnitude (0, 0, (int) sampleRate) > 0.01f, "explosion produces signal");
+        expect (! host.processor.isModelAwake ("explosion"), "explosion goes idle within its reported tail");
+
+        const int lastSecond = (int) sampleRate;
+        expect (out.getMagnitude (0, out.getNumSamples() - lastSecond, lastSecond) < 0.001f, "output is silent after the tail");
+    }
+
+    void checkFireStartStop (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        host.processor.triggerModel ("fire");
+        auto running = host.render (1.0);
+
+        host.processor.triggerModel ("fire");
+        host.render (0.5);
+
+        expect (running.getRMSLevel (0, 0, running.getNumSamples()) > 0.001f, "fire produces signal while running");
+        expect (! host.processor.models.find ("fire")->isActive(), "fire stops after the second trigger");
+
+        // Silent at zero intensity, but still burning: raising the slider brings it back.
+        OfflineHost quiet (sampleRate, blockSize);
+        setParameter (quiet.processor, "intensity", 0.0f);
+        quiet.processor.triggerModel ("fire");
+        auto silent = quiet.render (1.0);
+        setParameter (quiet.processor, "intensity", 0.5f);
+        auto raised = quiet.render (0.5);
+
+        expect (silent.getMagnitude (0, 0, silent.getNumSamples()) == 0.0f, "fire at zero intensity is silent");
+        expect (raised.getRMSLevel (0, 0, raised.getNumSamples()) > 0.001f, "raising the intensity restarts a silent fire");
+        expect (quiet.processor.models.find ("fire")->getTailSeconds() > ActivityTracker::silenceHoldSeconds,
+                "fire's tail covers its fade");
+
+        // A wake that lands after the silence check keeps the source awake.
+        ActivityTracker tracker;
+        tracker.prepare (sampleRate);
+        tracker.wake (ActivityTracker::firstModel);
+        expect (tracker.reportOutput (ActivityTracker::firstModel, 0.0f, 1 << 20) == false, "silence is reported after the hold");
+        tracker.wake (ActivityTracker::firstModel);
+        expect (! tracker.trySleep (ActivityTracker::firstModel) && tracker.isAwake (ActivityTracker::firstModel),
+                "a wake between the silence check and the sleep is kept");
+        expect (tracker.reportOutput (ActivityTracker::firstModel, 0.0f, 1) && tracker.trySleep (ActivityTracker::firstModel)
+                  && ! tracker.isAwake (ActivityTracker::firstModel),
+                "silence counts again from the wake");
+    }
+
+    template <typename Model>
+    Model& findModel (OfflineHost& host, const char* id)
+    {
+        return *dynamic_cast<Model*> (host.processor.models.find (id));
+    }
+
+    bool waitForBank (SampleBank& bank, int minimumReady)
+    {
+        for (int waited = 0; waited < 10000 && bank.getNumReady() < minimumReady; waited += 10)
+            juce::Thread::sleep (10);
+
+        return bank.getNumReady() >= minimumReady;
+    }
+
+    void checkBakedModels (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        setParameter (host.processor, ModelRegistry::bakedParameterId, 1.0f);
+
+        auto& explosion = findModel<ExplosionModel> (host, "explosion").getSampleBank();
+        expect (waitForBank (explosion, 16), "baked mode fills the sample bank");
+        expect (explosion.getMemoryBytes() > 0 && explosion.getMemoryBytes() < 64 * 1024 * 1024, "bank memory stays bounded");
+
+        host.processor.triggerModel ("explosion");
+        auto first = host.render (1.0);
+        host.processor.triggerModel ("explosion");
+        auto second = host.render (1.0);
+
+        expect (first.getMagnitude (0, 0, (int) sampleRate) > 0.01f, "baked explosion produces signal");
+        expect (std::abs (first.getRMSLevel (0, 0, (int) sampleRate) - second.getRMSLevel (0, 0, (int) sampleRate)) > 1.0e-6f,
+                "consecutive baked triggers differ");
+
+        // Moving a slider re-bakes one variation at a time; the bank never runs dry meanwhile.
+        setParameter (host.processor, "rumble", 1.0f);
+        int lowest = explosion.getNumReady();
+
+        for (int waited = 0; waited < 2000; waited += 5)
+        {
+            lowest = juce::jmin (lowest, explosion.getNumReady());
+            juce::Thread::sleep (5);
+        }
+
+        expect (lowest > 0, "re-baking keeps playable variations");
+
+        setParameter (host.processor, ModelRegistry::bakedParameterId, 0.0f);
+
+        for (int waited = 0; waited < 2000 && explosion.getMemoryBytes() > 0; waited += 10)
+            juce::Thread::sleep (10);
+
+        expect (explosion.getMemoryBytes() == 0, "leaving baked mode frees the bank");
+    }
+
+    bool waitForBed (GranularBed& bed)
+    {
+        for (int waited = 0; waited < 10000 && ! bed.isReady(); waited += 10)
+            juce::Thread::sleep (10);
+
+        return bed.isReady();
+    }
+
+    float lowestWindowRms (const juce::AudioBuffer<float>& buffer, int window)
+    {
+        float lowest = std::numeric_limits<float>::max();
+
+        for (int pos = 0; pos + window <= buffer.getNumSamples(); pos += window)
+            lowest = juce::jmin (lowest, buffer.getRMSLevel (0, pos, window));
+
+        return lowest;
+    }
+
+    void checkGranularBed (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        setParameter (host.processor, ModelRegistry::bakedParameterId, 1.0f);
+
+        auto& bed = findModel<FireModel> (host, "fire").getGranularBed();
+        expect (waitForBed (bed), "baked mode renders the fire source");
+
+        // The source is a few seconds long; the bed must outlast it without a gap.
+        host.processor.triggerModel ("fire");
+        auto burning = host.render (10.0);
+        const int window = (int) (0.05 * sampleRate);
+        expect (lowestWindowRms (burning, window) > 0.0005f, "baked fire sustains well past its source");
+
+        // A slider change renders a new source in the background and crossfades to it.
+        setParameter (host.processor, "intensity", 1.0f);
+        juce::AudioBuffer<float> moving (1, 0);
+
+        // Keep playing meanwhile, in real time-ish steps so the bed thread sees the change first.
+        for (int waited = 0; waited < 10000 && (waited < 500 || ! bed.isReady()); waited += 10)
+        {
+            juce::Thread::sleep (10);
+            auto part = host.render (0.01);
+            moving.setSize (1, moving.getNumSamples() + part.getNumSamples(), true);
+            moving.copyFrom (0, moving.getNumSamples() - part.getNumSamples(), part, 0, 0, part.getNumSamples());
+        }
+
+        auto after = host.render (1.0);
+        expect (bed.isReady(), "a slider change re-renders the source");
+        expect (lowestWindowRms (moving, window) > 0.0005f && lowestWindowRms (after, window) > 0.0005f,
+                "the bed crossfades to the new source without a gap");
+        expect (bed.getMemoryBytes() > 0 && bed.getMemoryBytes() < 8 * 1024 * 1024, "bed memory stays bounded");
+
+        host.processor.triggerModel ("fire");
+        host.render (0.5);
+        expect (! host.processor.models.find ("fire")->isActive(), "baked fire stops after the second trigger");
+
+        setParameter (host.processor, ModelRegistry::bakedParameterId, 0.0f);
+
+        for (int waited = 0; waited < 2000 && bed.getMemoryBytes() > 0; waited += 10)
+            juce::Thread::sleep (10);
+
+        expect (bed.getMemoryBytes() == 0, "leaving baked mode frees the bed");
+    }
+
+    // RMS of a sine generated at `factor` times the rate and decimated, relative to the sine's own.
+    float decimatedSineLevel (double frequencyRatio, int factor)
+    {
+        struct Sine
+        {
+            void fillBuffer (float** channels, int numSamples)
+            {
+                for (int i = 0; i < numSamples; ++i, phase += increment)
+                    channels[0][i] += (float) std::sin (phase);
+            }
+
+            double phase = 0.0, increment = 0.0;
+        };
+
+        constexpr int blockSize = 256;
+        Oversampler oversampler;
+        oversampler.prepare (factor, 1, blockSize);
+
+        Sine sine;
+        sine.increment = juce::MathConstants<double>::twoPi * frequencyRatio / factor;
+
+        juce::AudioBuffer<float> output (1, blockSize * 64);
+
+        for (int pos = 0; pos < output.getNumSamples(); pos += blockSize)
+        {
+            sine.fillBuffer (oversampler.getInput (blockSize), blockSize * factor);
+            oversampler.decimate (output.getWritePointer (0, pos), blockSize);
+        }
+
+        const int settled = blockSize * 4;
+        return output.getRMSLevel (0, settled, output.getNumSamples() - settled) / std::sqrt (0.5f);
+    }
+
+    void checkOversampling (double sampleRate, int blockSize)
+    {
+        // 0.7 of the host rate folds onto 0.3 without the filters; 0.1 must pass untouched.
+        for (int factor : { 2, 4, 8 })
+        {
+            expect (decimatedSineLevel (0.7, factor) < 0.001f, juce::String (factor) + "x decimation rejects what would alias");
+            expect (std::abs (decimatedSineLevel (0.1, factor) - 1.0f) < 0.01f, juce::String (factor) + "x decimation passes the audio band");
+        }
+
+        expect (Oversampler::getLatencySamples (1) == 0.0 && Oversampler::getLatencySamples (2) == 11.5
+                  && Oversampler::getLatencySamples (4) == 14.25 && Oversampler::getLatencySamples (8) == 15.625,
+                "decimator group delay per factor");
+
+        OfflineHost host (sampleRate, blockSize);
+        expect (host.processor.models.getOversampling() == 1, "live oversampling is off by default");
+        expect (host.processor.getLatencySamples() == 0, "no latency without oversampling");
+
+        setParameter (host.processor, ModelRegistry::oversamplingParameterId, 1.0f);     // 2x
+        host.processor.prepareToPlay (sampleRate, blockSize);
+        expect (host.processor.models.getOversampling() == 2 && host.processor.getLatencySamples() == 12,
+                "2x reports the decimators' latency");
+
+        host.processor.setNonRealtime (true);
+        host.processor.prepareToPlay (sampleRate, blockSize);
+        expect (host.processor.models.getOversampling() == 8 && host.processor.getLatencySamples() == 16,
+                "offline rendering uses the render quality and reports its latency");
+
+        host.processor.triggerModel ("explosion");
+        auto out = host.render (1.0);
+        expect (out.getMagnitude (0, 0, out.getNumSamples()) > 0.01f, "oversampled explosion produces signal");
+    }
+
+    int firstNonSilentSample (const juce::AudioBuffer<float>& buffer)
+    {
+        auto* data = buffer.getReadPointer (0);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+            if (data[i] != 0.0f)
+                return i;
+
+        return -1;
+    }
+
+    void checkScheduledTriggers (double sampleRate)
+    {
+        // Bar 1 beat 2 at 120 bpm is half a second in: not on a block boundary for either size.
+        auto renderWith = [sampleRate] (int blockSize, double ppqError = 0.0)
+        {
+            OfflineHost host (sampleRate, blockSize);
+            setParameter (host.processor, "timeSeparation", 0.0f);
+            host.transport.playing = true;
+            host.transport.ppqError = ppqError;
+            host.transport.errorPeriod = blockSize;
+            host.processor.startSequence ("explosion", TriggerScheduler::Sequence::parse ("bar 1 beat 2 every 0.25 s x 2"));
+            return host.render (1.0);
+        };
+
+        auto blocks512 = renderWith (512);
+        auto blocks333 = renderWith (333);
+        const int expected = juce::roundToInt (sampleRate * 0.5);
+
+        expect (firstNonSilentSample (blocks512) == expected, "a synced sequence starts on its exact sample");
+        expect (blocks512.getNumSamples() == blocks333.getNumSamples()
+                  && std::memcmp (blocks512.getReadPointer (0), blocks333.getReadPointer (0),
+                                  sizeof (float) * (size_t) blocks512.getNumSamples()) == 0,
+                "scheduled onsets do not depend on the host block size");
+
+        // Blocks that start right on an onset, with the host a fraction of a sample off either way.
+        const int onBeat = juce::roundToInt (sampleRate / 100.0);
+        auto exact = renderWith (onBeat);
+        auto rounded = renderWith (onBeat, 0.2 * 2.0 / sampleRate);
+        expect (std::memcmp (exact.getReadPointer (0), rounded.getReadPointer (0), sizeof (float) * (size_t) exact.getNumSamples()) == 0,
+                "host rounding neither drops nor repeats a synced onset");
+
+        // Free-running, jittered by Time Separation, and over after its count.
+        OfflineHost host (sampleRate, 512);
+        setParameter (host.processor, "timeSeparation", 1.0f);
+        host.processor.startSequence ("explosion", TriggerScheduler::Sequence::parse ("every 0.1 s x 3"));
+        auto burst = host.render (0.4);
+        host.render (host.processor.getTailLengthSeconds() + 0.5);
+
+        expect (burst.getMagnitude (0, 0, burst.getNumSamples()) > 0.01f, "a free-running sequence plays");
+        expect (! host.processor.isModelAwake ("explosion"), "a counted sequence ends");
+
+        // Stopped transport holds synced sequences back.
+        OfflineHost stopped (sampleRate, 512);
+        stopped.processor.startSequence ("explosion", TriggerScheduler::Sequence::parse ("bar 1 every 0.25 s"));
+        auto held = stopped.render (0.5);
+        expect (held.getMagnitude (0, 0, held.getNumSamples()) == 0.0f, "synced sequences wait for the host transport");
+    }
+
+    void checkTakeExport (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-takes");
+        folder.deleteRecursively();
+
+        juce::WavAudioFormat wav;
+
+        auto readTake = [&wav] (const juce::File& file)
+        {
+            juce::AudioBuffer<float> audio;
+
+            if (std::unique_ptr<juce::AudioFormatReader> reader { wav.createReaderFor (file.createInputStream().release(), true) })
+            {
+                audio.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+                reader->read (&audio, 0, audio.getNumSamples(), 0, true, true);
+            }
+
+            return audio;
+        };
+
+        const auto started = juce::Time::getMillisecondCounterHiRes();
+        auto explosionFile = host.processor.renderTake ("explosion", folder);
+        const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - started) / 1000.0;
+        auto explosion = readTake (explosionFile);
+        const double explosionSeconds = explosion.getNumSamples() / sampleRate;
+
+        expect (explosion.getNumChannels() == 1 && explosionSeconds > 0.5 && explosionSeconds <= 60.0, "explosion take rings out into a file");
+        expect (explosion.getMagnitude (0, 0, explosion.getNumSamples()) > 0.01f, "explosion take produces signal");
+        expect (elapsedSeconds < explosionSeconds, "takes render faster than real time");
+
+        auto fire = readTake (host.processor.renderTake ("fire", folder));
+        const double fireSeconds = fire.getNumSamples() / sampleRate;
+        const int lastBlock = juce::jmin (fire.getNumSamples(), 32);
+
+        expect (fireSeconds >= QAPAudioProcessor::takeSeconds && fireSeconds < QAPAudioProcessor::takeSeconds + 10.0, "fire take burns for the take length");
+        expect (fire.getRMSLevel (0, fire.getNumSamples() - lastBlock, lastBlock) < 0.001f, "fire take fades out");
+
+        auto stale = folder.getChildFile ("stale_take.wav"), recent = folder.getChildFile ("recent_take.wav");
+        stale.create();
+        recent.create();
+        stale.setLastModificationTime (juce::Time::getCurrentTime() - juce::RelativeTime::hours (QAPAudioProcessor::tempFileHours + 1));
+        QAPAudioProcessor::deleteOldFiles (folder);
+        expect (! stale.exists() && recent.exists(), "old takes are cleaned up, recent ones kept");
+
+        folder.deleteRecursively();
+    }
+
+    void checkReferenceModeMatches (double sampleRate)
+    {
+        // The same explosion rendered through both renderer modes and two block sizes must be identical.
+        auto renderWith = [sampleRate] (ProceduralRenderer::Mode mode, int blockSize)
+        {
+            OfflineHost host (sampleRate, blockSize);
+            host.processor.proceduralRenderer.setMode (mode);
+            host.processor.triggerModel ("explosion");
+            return host.render (2.0);
+        };
+
+        auto reference  = renderWith (ProceduralRenderer::Mode::reference, 480);
+        auto vectorised = renderWith (ProceduralRenderer::Mode::vectorised, 480);
+        auto oddBlocks  = renderWith (ProceduralRenderer::Mode::vectorised, 333);
+
+        auto identical = [] (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+        {
+            return a.getNumSamples() == b.getNumSamples()
+                && std::memcmp (a.getReadPointer (0), b.getReadPointer (0), sizeof (float) * (size_t) a.getNumSamples()) == 0;
+        };
+
+        expect (identical (reference, vectorised), "vectorised renderer is bit-identical to reference mode");
+        expect (identical (reference, oddBlocks), "output does not depend on the host block size");
+    }
+
+    void checkRenderPoolMatches (double sampleRate)
+    {
+        // Parallel rendering must not change a single sample: same models, same mix order.
+        auto renderWith = [sampleRate] (bool parallel)
+        {
+            OfflineHost host (sampleRate, 512);
+            host.processor.renderPool.setEnabled (parallel);
+            host.processor.triggerModel ("explosion");
+            host.processor.triggerModel ("fire");
+            return host.render (2.0);
+        };
+
+        auto serial   = renderWith (false);
+        auto parallel = renderWith (true);
+
+        expect (serial.getNumSamples() == parallel.getNumSamples()
+                  && std::memcmp (serial.getReadPointer (0), parallel.getReadPointer (0), sizeof (float) * (size_t) serial.getNumSamples()) == 0,
+                "render pool output is bit-identical to serial rendering");
+    }
+
+    void checkStateRoundTrip (double sampleRate, int blockSize)
+    {
+        juce::MemoryBlock state;
+        juce::String projectId;
+
+        {
+            OfflineHost host (sampleRate, blockSize);
+            projectId = host.processor.getProjectId();
+            setParameter (host.processor, "rumble", 0.8f);
+            setParameter (host.processor, "intensity", 0.25f);
+            host.processor.setSearchText ("fire crackle");
+            host.processor.setProceduralModel ("fire");
+            host.processor.getStateInformation (state);
+        }
+
+        OfflineHost restored (sampleRate, blockSize);
+        restored.processor.setStateInformation (state.getData(), (int) state.getSize());
+
+        expect (std::abs (getParameter (restored.processor, "rumble") - 0.8f) < 1.0e-4f, "state restores parameter values");
+        expect (std::abs (getParameter (restored.processor, "intensity") - 0.25f) < 1.0e-4f, "state restores fire parameters");
+        expect (restored.processor.getSearchText() == "fire crackle", "state restores search text");
+        expect (restored.processor.getProceduralModel() == "fire", "state restores the shown model");
+        expect (projectId.isNotEmpty() && restored.processor.getProjectId() == projectId, "state keeps the project ID");
+
+        const char garbage[] = "not a QAP state";
+        restored.processor.setStateInformation (garbage, (int) sizeof (garbage));
+        expect (restored.processor.getSearchText() == "fire crackle", "foreign state data is ignored");
+
+        OfflineHost untouched (sampleRate, blockSize);
+        const auto rumble = getParameter (untouched.processor, "rumble");
+        untouched.processor.setStateInformation (state.getData(), (int) state.getSize() - 8);
+        expect (getParameter (untouched.processor, "rumble") == rumble && untouched.processor.getSearchText().isEmpty(),
+                "truncated state changes nothing, parameters included");
+    }
+
+    void checkProgramChange (double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        const int target = 2; // "Close Blast"
+
+        juce::MidiBuffer midi;
+        midi.addEvent (juce::MidiMessage::programChange (1, target), 0);
+        host.render ((double) blockSize / sampleRate, midi);
+
+        expect (host.processor.getCurrentProgram() == target, "MIDI program change selects the preset");
+        expect (std::abs (getParameter (host.processor, "rumbleDecay") - 1.5f) > 1.0e-3f, "the audio thread does not set parameters");
+
+        host.processor.presets.applyPendingSelection();     // the bank's timer, without a message loop
+        expect (std::abs (getParameter (host.processor, "rumbleDecay") - 1.5f) < 1.0e-3f, "preset values apply on the message thread");
+        expect (host.processor.presets.getParameterIDs().size() == 12 && host.processor.presets.getParameterIDs()[0] == "rumble",
+                "presets cover every registered model parameter");
+    }
+
+    void checkLibraryScan()
+    {
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-library");
+        folder.deleteRecursively();
+        folder.getChildFile ("impacts").createDirectory();
+
+        for (auto name : { "impacts/metal_hit.wav", "explosion_big.wav", "fire_loop.wav", "notes.txt" })
+            folder.getChildFile (name).create();
+
+        OfflineHost host (48000.0, 512);
+        host.processor.loadAllWavFilesFromFolder (folder);
+
+        auto index = host.processor.getLibraryIndex();
+        expect (index->size() == 3, "library scan finds only audio files");
+        expect (index->findMatches ("FIRE").size() == 1, "search is case-insensitive");
+        expect (host.processor.getWavFileByName ("metal_hit.wav").existsAsFile(), "lookup by name finds nested files");
+
+        OfflineHost second (48000.0, 512);
+        second.processor.loadAllWavFilesFromFolder (folder);
+        expect (second.processor.getLibraryIndex() == index, "second instance shares the library index");
+
+        folder.deleteRecursively();
+    }
+
+    void checkPathStore()
+    {
+        auto root = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-paths");
+        PathStore store;
+        juce::Array<juce::File> files;
+
+        for (int i = 0; i < 300; ++i)
+            files.add (root.getChildFile ("kit" + juce::String (i % 3)).getChildFile ("hit_" + juce::String (i) + ".wav"));
+
+        for (auto& file : files)
+            store.add (file);
+
+        bool sameFiles = true;
+        for (int i = 0; i < files.size(); ++i)
+            sameFiles = sameFiles && store.getFile (i) == files[i] && store.indexOf (files[i]) == i;
+
+        expect (sameFiles, "path store gives back every path and finds every file");
+        // The root and each of its ancestors once, then the three kits
+        int depth = 1;
+        for (auto folder = root; folder.getParentDirectory() != folder; folder = folder.getParentDirectory())
+            ++depth;
+
+        expect (store.getNumDirectories() == depth + 3, "path store interns shared directories");
+        expect (store.indexOf (root.getChildFile ("kit0/hit_1.wav")) < 0, "path store tells files apart by directory");
+
+        auto subset = store.withDirectoriesOnly();
+        subset.addFrom (store, 7);
+        subset.add (root.getChildFile ("kit9/new.wav"));
+        expect (subset.size() == 2 && subset.getFile (0) == files[7] && subset.indexOf (files[7]) == 0
+                  && subset.getFile (1) == root.getChildFile ("kit9/new.wav"),
+                "path store copies files by ID into a store with its directories");
+    }
+
+    void writeConstantWav (const juce::File& file, double sampleRate, float value, double seconds = 1.0)
+    {
+        juce::AudioBuffer<float> data (1, (int) (sampleRate * seconds));
+        juce::FloatVectorOperations::fill (data.getWritePointer (0), value, data.getNumSamples());
+
+        juce::WavAudioFormat wav;
+        file.deleteFile();
+
+        if (std::unique_ptr<juce::AudioFormatWriter> writer { wav.createWriterFor (file.createOutputStream().release(),
+                                                                                   sampleRate, 1, 24, {}, 0) })
+            writer->writeFromAudioSampleBuffer (data, 0, data.getNumSamples());
+    }
+
+    void checkAuditionCrossfades (double sampleRate, int blockSize)
+    {
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-audition");
+        folder.deleteRecursively();
+        folder.createDirectory();
+        writeConstantWav (folder.getChildFile ("loud.wav"), sampleRate, 0.5f);
+        writeConstantWav (folder.getChildFile ("quiet.wav"), sampleRate, 0.25f);
+
+        OfflineHost host (sampleRate, blockSize);
+        host.processor.loadAllWavFilesFromFolder (folder);
+        host.processor.preloadWavFiles ({ folder.getChildFile ("loud.wav"), folder.getChildFile ("quiet.wav") });
+
+        // Hold the arrow key: a new row every 20 ms, faster than most key repeats.
+        float lowest = 1.0f, largestStep = 0.0f, previous = 0.0f;
+
+        for (int step = 0; step < 25; ++step)
+        {
+            host.processor.playWavFileByName (step % 2 == 0 ? "loud.wav" : "quiet.wav");
+            host.processor.audition.waitForPendingRequests (1000);
+            auto out = host.render (0.02);
+            auto* samples = out.getReadPointer (0);
+
+            for (int i = 0; i < out.getNumSamples(); ++i)
+            {
+                if (step > 0 || i > (int) (AuditionEngine::crossfadeSeconds * sampleRate))
+                    lowest = juce::jmin (lowest, samples[i]);
+
+                largestStep = juce::jmax (largestStep, std::abs (samples[i] - previous));
+                previous = samples[i];
+            }
+        }
+
+        expect (lowest > 0.2f, "audition never drops out while stepping through rows");
+        expect (largestStep < 0.01f, "switching rows crossfades without clicks");
+
+        // A region shorter than the fade in still fades out by its last sample
+        const int shortRegion = (int) (AuditionEngine::crossfadeSeconds * sampleRate / 2);
+        host.processor.playWavFile (folder.getChildFile ("loud.wav"), 1000, 1000 + shortRegion);
+        host.processor.audition.waitForPendingRequests (1000);
+        host.render (0.05);     // the outgoing voice fades out
+
+        host.processor.playWavFile (folder.getChildFile ("loud.wav"), 1000, 1000 + shortRegion);
+        host.processor.audition.waitForPendingRequests (1000);
+        auto shortOut = host.render (0.05);
+        expect (shortOut.getMagnitude (0, 0, shortRegion) > 0.03f
+                  && std::abs (shortOut.getSample (0, shortRegion - 1)) < 0.02f
+                  && shortOut.getMagnitude (0, shortRegion, shortOut.getNumSamples() - shortRegion) == 0.0f,
+                "a region shorter than the fade in fades out without a click");
+
+        // Too big for the preview cache: streamed through the read-ahead buffer
+        auto big = folder.getChildFile ("big.wav");
+        writeConstantWav (big, sampleRate, 0.5f, 70.0);
+        expect (big.getSize() > LibraryService::maxPreviewFileBytes, "streamed test file is over the preview limit");
+
+        host.processor.playWavFile (big, (juce::int64) sampleRate * 30);
+        host.processor.audition.waitForPendingRequests (5000);
+        juce::Thread::sleep (200);      // real time would give the read-ahead this long
+        auto streamed = host.render (0.25);
+        const int afterFade = (int) std::ceil (AuditionEngine::crossfadeSeconds * sampleRate) + 1;
+        expect (std::abs (streamed.getSample (0, afterFade) - 0.5f) < 1.0e-3f
+                  && std::abs (streamed.getSample (0, streamed.getNumSamples() - 1) - 0.5f) < 1.0e-3f,
+                "large files stream from their start position without gaps");
+
+        host.processor.playWavFile (big, (juce::int64) sampleRate * 50);
+        host.processor.audition.waitForPendingRequests (5000);
+        juce::Thread::sleep (200);
+        auto seeked = host.render (0.25);
+        float seekedLowest = 1.0f;
+
+        for (int i = 0; i < seeked.getNumSamples(); ++i)
+            seekedLowest = juce::jmin (seekedLowest, seeked.getSample (0, i));
+
+        expect (seekedLowest > 0.49f, "seeking a streamed file crossfades through the read-ahead without gaps");
+
+        folder.deleteRecursively();
+    }
+
+    void writeBuffer (const juce::File& file, const juce::AudioBuffer<float>& data, double sampleRate)
+    {
+        juce::WavAudioFormat wav;
+        file.deleteFile();
+
+        if (std::unique_ptr<juce::AudioFormatWriter> writer { wav.createWriterFor (file.createOutputStream().release(),
+                                                                                   sampleRate, 1, 24, {}, 0) })
+            writer->writeFromAudioSampleBuffer (data, 0, data.getNumSamples());
+    }
+
+    void checkAuditionRegions (double sampleRate, int blockSize)
+    {
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-regions");
+        folder.deleteRecursively();
+        folder.createDirectory();
+
+        // A ramp: every sample says where it is, so a seek can be checked to the sample.
+        const int length = (int) sampleRate * 2;
+        juce::AudioBuffer<float> ramp (1, length);
+        for (int i = 0; i < length; ++i)
+            ramp.setSample (0, i, 0.9f * (float) i / (float) length);
+
+        auto file = folder.getChildFile ("ramp.wav");
+        writeBuffer (file, ramp, sampleRate);
+
+        OfflineHost host (sampleRate, blockSize);
+        host.processor.loadAllWavFilesFromFolder (folder);
+
+        const juce::int64 start = length / 2 + 123, end = start + (juce::int64) (sampleRate * 0.25);
+        host.processor.playWavFile (file, start, end);
+        host.processor.audition.waitForPendingRequests (1000);
+        auto out = host.render (0.5);
+
+        const int afterFade = (int) std::ceil (AuditionEngine::crossfadeSeconds * sampleRate) + 1;
+        expect (std::abs (out.getSample (0, afterFade) - ramp.getSample (0, (int) start + afterFade)) < 1.0e-4f,
+                "audition seeks to the sample");
+
+        const int regionLength = (int) (end - start);
+        expect (out.getSample (0, regionLength - afterFade) > 0.1f, "region plays to its end");
+        expect (out.getMagnitude (0, regionLength, out.getNumSamples() - regionLength) == 0.0f, "region stops at its end");
+
+        // Trimming writes exactly the region
+        auto trimmed = host.processor.exportRegion (file, start, end, folder);
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (trimmed));
+        juce::AudioBuffer<float> first (1, 1);
+
+        if (reader != nullptr)
+            reader->read (&first, 0, 1, 0, true, false);
+
+        expect (reader != nullptr && reader->lengthInSamples == end - start
+                  && std::abs (first.getSample (0, 0) - ramp.getSample (0, (int) start)) < 1.0e-4f,
+                "exported region is trimmed to the sample");
+
+        // Transients: noise bursts in silence, found during the loudness pass
+        juce::AudioBuffer<float> bursts (1, (int) sampleRate * 6);
+        bursts.clear();
+        juce::Random random (7);
+        const int onsets[] = { (int) (sampleRate * 0.7), (int) (sampleRate * 2.13), (int) (sampleRate * 4.0) + 37 };
+
+        for (auto onset : onsets)
+            for (int i = 0; i < (int) (sampleRate * 0.3); ++i)
+                bursts.setSample (0, onset + i, 0.5f * std::exp (-(float) i / (float) (sampleRate * 0.05)) * (random.nextFloat() * 2.0f - 1.0f));
+
+        auto burstFile = folder.getChildFile ("bursts.wav");
+        writeBuffer (burstFile, bursts, sampleRate);
+
+        std::vector<juce::uint32> transients;
+        std::unique_ptr<juce::AudioFormatReader> burstReader (formats.createReaderFor (burstFile));
+
+        if (burstReader != nullptr)
+            LibraryColumns::measureLoudness (*burstReader, &transients);
+
+        const auto hop = (juce::int64) std::ceil (sampleRate * LibraryColumns::transientHopSeconds);
+        bool found = transients.size() == std::size (onsets);
+
+        for (size_t i = 0; found && i < transients.size(); ++i)
+            found = std::abs ((juce::int64) transients[i] - onsets[i]) < hop;
+
+        expect (found, "transient analysis finds every burst within a hop");
+
+        folder.deleteRecursively();
+    }
+
+    void checkMemoryBudget()
+    {
+        // Pools borrow free memory and give it back
+        MemoryBudget budget;
+        budget.setCap (100 * MemoryBudget::megabyte);
+        budget.add (MemoryBudget::previews, 60 * MemoryBudget::megabyte);
+        expect (! budget.isOverLimit (MemoryBudget::previews), "a pool may grow past its quota into free memory");
+
+        budget.add (MemoryBudget::sampleBanks, 40 * MemoryBudget::megabyte);
+        budget.add (MemoryBudget::sampleBanks, 5 * MemoryBudget::megabyte);
+        expect (budget.isOverLimit (MemoryBudget::previews) && ! budget.isOverLimit (MemoryBudget::sampleBanks),
+                "a pool within its quota pushes out the pools that borrowed");
+
+        // The cap is the largest any live instance asks for
+        int first = 0, second = 0;
+        budget.addClient (&first, 256 * MemoryBudget::megabyte);
+        budget.addClient (&second, 1024 * MemoryBudget::megabyte);
+        const bool largestWins = budget.getCap() == 1024 * MemoryBudget::megabyte;
+        budget.requestCap (&second, 128 * MemoryBudget::megabyte);
+        const bool lowered = budget.getCap() == 256 * MemoryBudget::megabyte;
+        budget.removeClient (&first);
+        expect (largestWins && lowered && budget.getCap() == 128 * MemoryBudget::megabyte, "memory cap is the largest request");
+        budget.removeClient (&second);
+
+        // ARC: stepping through many files once keeps the ones auditioned again and again
+        ArcCache<int, int> arc;
+        for (int pass = 0; pass < 3; ++pass)
+            for (int key : { 1, 2 })
+                if (arc.find (key) == nullptr)
+                {
+                    arc.insert (key, key, 1, 8);
+                    arc.trim (8);
+                }
+
+        for (int key = 100; key < 140; ++key)
+        {
+            if (arc.find (key) == nullptr)
+                arc.insert (key, key, 1, 8);
+
+            arc.trim (8);
+        }
+
+        expect (arc.find (1) != nullptr && arc.find (2) != nullptr && arc.getBytes() <= 8, "ARC resists a scan");
+
+        // The shared budget bounds the preview cache of the library service
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-memory");
+        folder.deleteRecursively();
+        folder.createDirectory();
+
+        for (int i = 0; i < 12; ++i)
+            writeConstantWav (folder.getChildFile ("file" + juce::String (i) + ".wav"), 48000.0, 0.1f, 4.0);   // about 576 kB each
+
+        juce::SharedResourcePointer<LibraryService> library;
+        auto& shared = library->getMemoryBudget();
+        const auto previousCap = shared.getCap();
+        const auto others = shared.getTotalBytes() - shared.getBytes (MemoryBudget::previews);
+        shared.setCap (others + 4 * MemoryBudget::megabyte);
+
+        bool bounded = true;
+        for (int i = 0; i < 12; ++i)
+        {
+            auto reader = library->createReaderFor (folder.getChildFile ("file" + juce::String (i) + ".wav"));
+            bounded = bounded && reader != nullptr && ! shared.isOverLimit (MemoryBudget::previews);
+        }
+
+        const auto hitsBefore = shared.getStats().pools[MemoryBudget::previews].hits;
+        auto again = library->createReaderFor (folder.getChildFile ("file11.wav"));
+
+        expect (bounded, "preview cache stays within the memory budget");
+        expect (shared.getStats().pools[MemoryBudget::previews].hits == hitsBefore + 1, "preview hits are counted");
+
+        // A reader keeps its block, and its bytes, after the cache lets go of it
+        const auto fileBytes = folder.getChildFile ("file11.wav").getSize();
+        shared.setCap (0);
+        library->createReaderFor (folder.getChildFile ("file0.wav"));     // a miss, which trims the cache to nothing
+        const bool stillCounted = shared.getBytes (MemoryBudget::previews) >= fileBytes;
+        again.reset();
+        expect (stillCounted && shared.getBytes (MemoryBudget::previews) < fileBytes, "blocks held by readers count until released");
+
+        shared.setCap (previousCap);
+        folder.deleteRecursively();
+    }
+
+    void checkLibraryQuery()
+    {
+        auto query = LibraryQuery::parse ("thunder duration < 2 s AND loudness > -20 LUFS");
+        expect (query.text == "thunder", "query keeps the name text");
+        expect (query.ranges.size() == 2 && query.ranges[0].column == LibraryColumn::duration
+                  && query.ranges[0].maxValue < 2.0f && query.ranges[1].minValue > -20.0f,
+                "query parses ranges with units");
+
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-query");
+        folder.deleteRecursively();
+        folder.getChildFile ("hits").createDirectory();
+        folder.getChildFile ("beds").createDirectory();
+        writeConstantWav (folder.getChildFile ("hits/short.wav"), 48000.0, 0.5f, 0.5);
+        writeConstantWav (folder.getChildFile ("hits/long.wav"),  48000.0, 0.5f, 3.0);
+        writeConstantWav (folder.getChildFile ("beds/short.wav"), 44100.0, 0.1f, 0.5);
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        auto index = LibraryIndex::scan (folder, "*.wav", &formats);
+
+        auto nameOf = [&index] (int id) { return index->getFile (id).getRelativePathFrom (index->root).replaceCharacter ('\\', '/'); };
+
+        LibraryQuery shortOnes;
+        shortOnes.ranges.push_back ({ LibraryColumn::duration, 0.0f, 2.0f });
+        expect (index->runQuery (shortOnes).size() == 2, "range filter drops long files");
+
+        LibraryQuery sorted;
+        sorted.sortKeys = { { LibraryColumn::category, true }, { LibraryColumn::duration, false } };
+        auto rows = index->runQuery (sorted);
+        expect (rows.size() == 3 && nameOf (rows[0]) == "beds/short.wav" && nameOf (rows[1]) == "hits/long.wav"
+                  && nameOf (rows[2]) == "hits/short.wav",
+                "multi-key sort orders by category, then duration descending");
+
+        // Nothing is analysed yet: a descending loudness key in front of another is all unknown.
+        LibraryQuery unanalysed;
+        unanalysed.sortKeys = { { LibraryColumn::loudness, false }, { LibraryColumn::name, true } };
+        rows = index->runQuery (unanalysed);
+        expect (rows.size() == 3 && nameOf (rows[0]) == "hits/long.wav",
+                "sorting by an unanalysed column falls through to the next key");
+
+        // A 1 kHz sine at -20 dBFS peak reads about -23 LUFS
+        auto sine = folder.getChildFile ("sine.wav");
+        {
+            juce::AudioBuffer<float> data (1, 48000 * 3);
+            for (int i = 0; i < data.getNumSamples(); ++i)
+                data.setSample (0, i, 0.1f * std::sin (juce::MathConstants<float>::twoPi * 1000.0f * (float) i / 48000.0f));
+
+            juce::WavAudioFormat wav;
+            if (std::unique_ptr<juce::AudioFormatWriter> writer { wav.createWriterFor (sine.createOutputStream().release(),
+                                                                                       48000.0, 1, 24, {}, 0) })
+                writer->writeFromAudioSampleBuffer (data, 0, data.getNumSamples());
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (sine));
+        const auto lufs = reader != nullptr ? LibraryColumns::measureLoudness (*reader) : 0.0f;
+        expect (std::abs (lufs + 23.0f) < 0.5f, "loudness of a -20 dBFS sine is about -23 LUFS");
+
+        folder.deleteRecursively();
+    }
+
+    void checkLibrarySearch()
+    {
+        std::vector<std::string> words;
+        LibrarySearch::tokenize ("MetalHit_02-big", words);
+        expect (words == std::vector<std::string> { "metal", "hit", "02", "big" }, "names split into lower-case words");
+        expect (LibrarySearch::getEditDistance ("kitten", "sitting") == 3, "edit distance counts substitutions and insertions");
+
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-search");
+        folder.deleteRecursively();
+        folder.getChildFile ("metal").createDirectory();
+
+        for (auto name : { "metal/door.wav", "Metal_Hit.wav", "ExplosionBig_0217.wav", "thunder_rumble.wav", "wind.wav" })
+            folder.getChildFile (name).create();
+
+        auto index = LibraryIndex::scan (folder);
+        auto namesOf = [&index] (const juce::String& text)
+        {
+            juce::StringArray names;
+
+            for (auto id : index->findMatches (text))
+                names.add (index->getName (id));
+
+            return names;
+        };
+
+        expect (namesOf ("exploson") == juce::StringArray { "ExplosionBig_0217.wav" }, "a typo still finds the file");
+        expect (namesOf ("thundr rumble") == juce::StringArray { "thunder_rumble.wav" }, "every word has to match");
+        expect (namesOf ("metal") == juce::StringArray { "Metal_Hit.wav", "door.wav" }, "a name match ranks above a folder match");
+        expect (namesOf ("021") == juce::StringArray { "ExplosionBig_0217.wav" } && namesOf ("ind").contains ("wind.wav"),
+                "substrings still match");
+
+        auto sorted = LibraryQuery::parse ("metal");
+        sorted.sortKeys = { { LibraryColumn::name, true } };
+        auto rows = index->runQuery (sorted);
+        expect (rows.size() == 2 && index->getName (rows[0]) == "door.wav", "sort keys override the ranking");
+
+        folder.deleteRecursively();
+    }
+
+    void checkLibraryDatabase()
+    {
+        auto query = LibraryQuery::parse ("thunder tag:Metal AND favourite AND NOT used-in-project rating:3");
+        expect (query.text == "thunder" && query.facets.size() == 4 && query.facets[0].tag == "metal"
+                  && query.facets[2].kind == LibraryQuery::Facet::usedInProject && query.facets[2].negated
+                  && query.facets[3].minRating == 3,
+                "query parses facets");
+
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-database");
+        folder.deleteRecursively();
+        folder.getChildFile ("kit").createDirectory();
+
+        for (auto name : { "kit/anvil.wav", "kit/pipe.wav", "kit/bell.wav", "wind.wav" })
+            folder.getChildFile (name).create();
+
+        auto index = LibraryIndex::scan (folder);
+        auto databaseFile = folder.getSiblingFile ("qap-headless-database.qapdb");
+        databaseFile.deleteFile();
+
+        {
+            LibraryDatabase database (databaseFile);
+            database.setTag (folder.getChildFile ("kit/anvil.wav"), "Metal", true);
+            database.setTag (folder.getChildFile ("kit/pipe.wav"), "metal", true);
+            database.setTag (folder.getChildFile ("kit/bell.wav"), "metal", true);
+            database.setFavourite (folder.getChildFile ("kit/anvil.wav"), true);
+            database.setFavourite (folder.getChildFile ("kit/pipe.wav"), true);
+            database.setRating (folder.getChildFile ("kit/anvil.wav"), 4);
+            database.noteUsed (folder.getChildFile ("kit/pipe.wav"), "project-a");
+            database.notePlayed (folder.getChildFile ("wind.wav"));
+            database.flush();
+
+            auto facets = database.getFacets (index);
+            auto metal = LibraryQuery::parse ("tag:metal favourite NOT used-in-project");
+            metal.project = "project-a";
+            auto rows = index->runQuery (metal, facets.get());
+            expect (rows.size() == 1 && index->getName (rows[0]) == "anvil.wav", "facets combine tags, favourites and project usage");
+
+            metal.project = "project-b";
+            expect (index->runQuery (metal, facets.get()).size() == 2, "used-in-project is per project");
+            expect (index->runQuery (LibraryQuery::parse ("played"), facets.get()).size() == 1
+                      && index->runQuery (LibraryQuery::parse ("rating:4"), facets.get()).size() == 1,
+                    "play counts and ratings are facets");
+            expect (index->runQuery (LibraryQuery::parse ("tag:metal")).empty(), "without facets no file has a tag");
+
+            database.notePlayed (folder.getChildFile ("wind.wav"));
+            database.flush();
+            expect (database.getFacets (index) == facets, "a repeated play leaves the facets alone");
+
+            database.setFavourite (folder.getChildFile ("kit/bell.wav"), true);
+            database.flush();
+            auto patched = database.getFacets (index);
+            expect (patched != facets && patched->isFavourite (index->paths.indexOf (folder.getChildFile ("kit/bell.wav")))
+                      && patched->tags.at ("metal") == facets->tags.at ("metal") && patched->played == facets->played,
+                    "a change copies only the bitmaps it flips");
+        }
+
+        {
+            LibraryDatabase reopened (databaseFile);
+            auto record = reopened.getRecord (folder.getChildFile ("kit/anvil.wav"));
+            expect (record.favourite && record.rating == 4 && record.tags.contains ("metal")
+                      && reopened.getRecord (folder.getChildFile ("wind.wav")).playCount == 2,
+                    "library database survives a restart");
+        }
+
+        {
+            // Two processes sharing the file: neither save loses the other's changes.
+            LibraryDatabase first (databaseFile), second (databaseFile);
+            first.setTag (folder.getChildFile ("kit/bell.wav"), "air", true);
+            first.notePlayed (folder.getChildFile ("kit/anvil.wav"));
+            first.flush();
+            second.setRating (folder.getChildFile ("wind.wav"), 2);
+            second.notePlayed (folder.getChildFile ("kit/anvil.wav"));
+            second.flush();
+
+            LibraryDatabase reopened (databaseFile);
+            expect (reopened.getRecord (folder.getChildFile ("kit/bell.wav")).tags.contains ("air")
+                      && reopened.getRecord (folder.getChildFile ("wind.wav")).rating == 2
+                      && reopened.getRecord (folder.getChildFile ("kit/anvil.wav")).playCount == 2,
+                    "saves merge with changes from other processes");
+        }
+
+        databaseFile.deleteFile();
+        folder.deleteRecursively();
+    }
+
+    void checkLibraryWatcher()
+    {
+        if (! LibraryWatcher::isSupported())
+            return;
+
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-watch");
+        folder.deleteRecursively();
+        folder.getChildFile ("hits").createDirectory();
+        writeConstantWav (folder.getChildFile ("hits/old.wav"), 48000.0, 0.5f, 0.1);
+        writeConstantWav (folder.getChildFile ("keep.wav"), 48000.0, 0.5f, 0.1);
+
+        OfflineHost host (48000.0, 512);
+        host.processor.loadAllWavFilesFromFolder (folder);
+        auto& library = *host.processor.library;
+        auto before = library.acquireIndex (folder);
+
+        folder.getChildFile ("hits/old.wav").moveFileTo (folder.getChildFile ("hits/renamed.wav"));
+        writeConstantWav (folder.getChildFile ("added.wav"), 48000.0, 0.5f, 0.1);
+        folder.getChildFile ("keep.wav").deleteFile();
+
+        // The update is published from the watcher thread; there is no message loop here, so poll the service.
+        auto after = before;
+        for (int waited = 0; waited < 3000 && (after->size() != 2 || after->indexOf ("keep.wav") >= 0); waited += 50)
+        {
+            juce::Thread::sleep (50);
+            after = library.acquireIndex (folder);
+        }
+
+        expect (after != before, "watcher publishes a new index");
+        expect (after->size() == 2 && after->indexOf ("renamed.wav") >= 0 && after->indexOf ("added.wav") >= 0
+                  && after->indexOf ("old.wav") < 0 && after->indexOf ("keep.wav") < 0,
+                "watcher applies rename, create and delete");
+        expect (after->columns.duration.size() == 2 && after->runQuery (LibraryQuery::parse ("renamed")).size() == 1,
+                "incremental update keeps columns and search in step");
+
+        // A folder moved out of the tree takes its files with it and is no longer watched
+        auto outside = folder.getSiblingFile ("qap-headless-watch-moved");
+        outside.deleteRecursively();
+        folder.getChildFile ("hits").moveFileTo (outside);
+
+        for (int waited = 0; waited < 3000 && after->indexOf ("renamed.wav") >= 0; waited += 50)
+        {
+            juce::Thread::sleep (50);
+            after = library.acquireIndex (folder);
+        }
+
+        auto moved = after;
+        writeConstantWav (outside.getChildFile ("later.wav"), 48000.0, 0.5f, 0.1);
+        juce::Thread::sleep (LibraryWatcher::settleMs + 300);
+
+        expect (after->indexOf ("renamed.wav") < 0 && library.acquireIndex (folder) == moved,
+                "folders moved out of the library are dropped and unwatched");
+
+        outside.deleteRecursively();
+        folder.deleteRecursively();
+    }
+
+    void checkCompressedFilesAreCached()
+    {
+        auto folder = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("qap-headless-compressed");
+        folder.deleteRecursively();
+        folder.createDirectory();
+
+        auto flacFile = folder.getChildFile ("rain.flac");
+        juce::AudioBuffer<float> data (1, 48000);
+        juce::Random random (42);
+
+        for (int i = 0; i < data.getNumSamples(); ++i)
+            data.setSample (0, i, random.nextFloat() * 0.5f - 0.25f);
+
+        juce::FlacAudioFormat flac;
+
+        if (std::unique_ptr<juce::AudioFormatWriter> writer { flac.createWriterFor (flacFile.createOutputStream().release(),
+                                                                                    48000.0, 1, 16, {}, 0) })
+            writer->writeFromAudioSampleBuffer (data, 0, data.getNumSamples());
+
+        OfflineHost host (48000.0, 512);
+        host.processor.loadAllWavFilesFromFolder (folder);
+        expect (host.processor.getLibraryIndex()->indexOf ("rain.flac") >= 0, "library scan picks up compressed formats");
+
+        auto& cache = host.processor.library->getPcmCache();
+        cache.getCachedFile (flacFile).deleteFile();    // left over from an earlier run
+
+        auto live = host.processor.library->createReaderFor (flacFile);
+        expect (live != nullptr && live->lengthInSamples == data.getNumSamples()
+                  && dynamic_cast<juce::FileInputStream*> (live->input) != nullptr,
+                "the first audition decodes from disk, behind the read-ahead buffer");
+        cache.waitForPendingDecodes (10000);
+
+        auto decoded = cache.getCachedFile (flacFile);
+        expect (decoded.existsAsFile(), "first audition queues the file for decoding");
+
+        auto cached = host.processor.library->createReaderFor (flacFile);
+        expect (cached != nullptr && cached->lengthInSamples == data.getNumSamples() && cached->bitsPerSample == 16
+                  && cached->getFormatName() == juce::WavAudioFormat().getFormatName(),
+                "later auditions read the decoded copy, at the source's bit depth");
+        expect (cache.getTotalBytes() >= decoded.getSize(), "the cache keeps track of its size in memory");
+
+        decoded.deleteFile();
+        folder.deleteRecursively();
+    }
+
+    void renderDemo (const juce::File& file, double sampleRate, int blockSize)
+    {
+        OfflineHost host (sampleRate, blockSize);
+        host.processor.triggerModel ("explosion");
+        host.processor.triggerModel ("fire");
+        auto out = host.render (5.0);
+
+        file.deleteFile();
+        juce::WavAudioFormat wav;
+
+        if (std::unique_ptr<juce::AudioFormatWriter> writer { wav.createWriterFor (file.createOutputStream().release(),
+                                                                                   sampleRate, (unsigned int) out.getNumChannels(), 24, {}, 0) })
+        {
+            writer->writeFromAudioSampleBuffer (out, 0, out.getNumSamples());
+            std::cout << "Rendered " << file.getFullPathName() << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    const double sampleRate = args.containsOption ("--sample-rate") ? args.getValueForOption ("--sample-rate").getDoubleValue() : 48000.0;
+    const int blockSize = args.containsOption ("--block-size") ? args.getValueForOption ("--block-size").getIntValue() : 512;
+
+    std::cout << "QAP headless host, " << sampleRate << " Hz, " << blockSize << " samples" << std::endl;
+
+    checkIdleIsSilent (sampleRate, blockSize);
+    checkExplosionRingsOutAndSleeps (sampleRate, blockSize);
+    checkFireStartStop (sampleRate, blockSize);
+    checkBakedModels (sampleRate, blockSize);
+    checkGranularBed (sampleRate, blockSize);
+    checkOversampling (sampleRate, blockSize);
+    checkScheduledTriggers (sampleRate);
+    checkTakeExport (sampleRate, blockSize);
+    checkReferenceModeMatches (sampleRate);
+    checkRenderPoolMatches (sampleRate);
+    checkStateRoundTrip (sampleRate, blockSize);
+    checkProgramChange (sampleRate, blockSize);
+    checkLibraryScan();
+    checkPathStore();
+    checkLibraryQuery();
+    checkMemoryBudget();
+    checkLibrarySearch();
+    checkLibraryDatabase();
+    checkLibraryWatcher();
+    checkCompressedFilesAreCached();
+    checkAuditionCrossfades (sampleRate, blockSize);
+    checkAuditionRegions (sampleRate, blockSize);
+
+    if (args.containsOption ("--render"))
+        renderDemo (juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--render")), sampleRate, blockSize);
+
+    std::cout << (failures == 0 ? "All checks passed" : juce::String (failures) + " check(s) failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
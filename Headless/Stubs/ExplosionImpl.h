@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    ExplosionImpl.h (headless stub)
+    Stand-in for the nemisindo Explosion model so the processor can be built
+    and exercised without the external model sources. Same interface, simple
+    but deterministic synthesis: decaying filtered noise layers.
+
+    Output depends only on the samples rendered so far, never on how they are
+    split into blocks, which the headless harness relies on.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace nemisindo
+{
+
+class Explosion
+{
+public:
+    void initialize (float newSampleRate)
+    {
+        sampleRate = newSampleRate > 0.0f ? newSampleRate : 44100.0f;
+        rumbleLevel = airLevel = dustLevel = 0.0f;
+        lowpass = 0.0f;
+        previousNoise = 0.0f;
+    }
+
+    void setRumble (float v)            { rumble = v; }
+    void setRumbleDecay (float v)       { rumbleDecay = v; }
+    void setAir (float v)               { air = v; }
+    void setAirDecay (float v)          { airDecay = v; }
+    void setDust (float v)              { dust = v; }
+    void setDustDecay (float v)         { dustDecay = v; }
+    void setTimeSeparation (float v)    { timeSeparation = v; }
+    void setGrit (bool v)               { grit = v; }
+    void setGritAmount (float v)        { gritAmount = v; }
+    void setOverTheTop (bool v)         { overTheTop = v; }
+
+    void trigger()
+    {
+        rumbleLevel = rumble;
+        airLevel = air;
+        dustLevel = dust;
+    }
+
+    bool isActive() const   { return rumbleLevel + airLevel + dustLevel > silence; }
+
+    void fillBuffer (float** channels, int numSamples)
+    {
+        auto* out = channels[0];
+
+        const float rumbleCoeff = decayCoefficient (rumbleDecay);
+        const float airCoeff    = decayCoefficient (airDecay);
+        const float dustCoeff   = decayCoefficient (dustDecay);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (! isActive())
+                return;
+
+            const float white = nextNoise();
+            lowpass += 0.01f * (white - lowpass);
+            const float highpass = white - previousNoise;
+            previousNoise = white;
+            const float crackle = (nextNoise() > 0.995f) ? white : 0.0f;
+
+            float sample = 8.0f * lowpass * rumbleLevel
+                         + 0.5f * highpass * airLevel
+                         + crackle * dustLevel;
+
+            if (grit)
+                sample = std::tanh (sample * (1.0f + 4.0f * gritAmount * (overTheTop ? 2.0f : 1.0f)));
+
+            out[i] += sample;
+
+            rumbleLevel *= rumbleCoeff;
+            airLevel    *= airCoeff;
+            dustLevel   *= dustCoeff;
+        }
+    }
+
+private:
+    static constexpr float silence = 1.0e-5f;
+
+    // Reaches -100 dB after `seconds`.
+    float decayCoefficient (float seconds) const
+    {
+        return seconds > 0.0f ? std::pow (silence, 1.0f / (seconds * sampleRate)) : 0.0f;
+    }
+
+    float nextNoise()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (float) state / 2147483648.0f - 1.0f;
+    }
+
+    float sampleRate = 44100.0f;
+    float rumble = 0.5f, rumbleDecay = 4.0f, air = 0.5f, airDecay = 1.0f, dust = 0.5f, dustDecay = 1.0f;
+    float timeSeparation = 0.0f, gritAmount = 0.5f;
+    bool grit = false, overTheTop = false;
+
+    float rumbleLevel = 0.0f, airLevel = 0.0f, dustLevel = 0.0f;
+    float lowpass = 0.0f, previousNoise = 0.0f;
+    uint32_t state = 0x12345678u;
+};
+
+} // namespace nemisindo
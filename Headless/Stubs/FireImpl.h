@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    FireImpl.h (headless stub)
+    Stand-in for the nemisindo Fire model: filtered noise for lapping and
+    hissing plus random crackles, with a short fade on stop. Block-size
+    independent, like the Explosion stub.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace nemisindo
+{
+
+class Fire
+{
+public:
+    void initialize (float newSampleRate)
+    {
+        sampleRate = newSampleRate > 0.0f ? newSampleRate : 44100.0f;
+        gain = 0.0f;
+        running = false;
+        lowpass = 0.0f;
+        previousNoise = 0.0f;
+    }
+
+    void setLapping (float v)     { lapping = v; }
+    void setHissing (float v)     { hissing = v; }
+    void setCrackling (float v)   { crackling = v; }
+    void setIntensity (float v)   { intensity = v; }
+
+    void start()    { running = true; }
+    void stop()     { running = false; }
+
+    bool isActive() const   { return running || gain > 1.0e-5f; }
+
+    void fillBuffer (float** channels, int numSamples)
+    {
+        auto* out = channels[0];
+        const float fadeStep = 1.0f / (0.05f * sampleRate);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (! isActive())
+                return;
+
+            gain = running ? std::fmin (1.0f, gain + fadeStep) : std::fmax (0.0f, gain - fadeStep);
+
+            const float white = nextNoise();
+            lowpass += 0.02f * (white - lowpass);
+            const float highpass = white - previousNoise;
+            previousNoise = white;
+            const float crackle = (nextNoise() > 1.0f - 0.002f * crackling) ? white : 0.0f;
+
+            out[i] += gain * intensity * (4.0f * lowpass * lapping + 0.2f * highpass * hissing + crackle);
+        }
+    }
+
+private:
+    float nextNoise()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (float) state / 2147483648.0f - 1.0f;
+    }
+
+    float sampleRate = 44100.0f;
+    float lapping = 0.5f, hissing = 0.5f, crackling = 0.5f, intensity = 0.5f;
+    float gain = 0.0f, lowpass = 0.0f, previousNoise = 0.0f;
+    bool running = false;
+    uint32_t state = 0x9e3779b9u;
+};
+
+} // namespace nemisindo
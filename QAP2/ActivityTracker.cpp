@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    ActivityTracker.cpp
+
+  ==============================================================================
+*/
+
+#include "ActivityTracker.h"
+
+void ActivityTracker::prepare (double sampleRate)
+{
+    silenceHoldSamples = juce::roundToInt (sampleRate * silenceHoldSeconds);
+
+    for (int source = 0; source < maxSources; ++source)
+    {
+        seenWakes[source] = states[source].load (std::memory_order_acquire) & ~awakeBit;
+        silentSamples[source] = 0;
+    }
+}
+
+void ActivityTracker::wake (int source) noexcept
+{
+    auto state = states[source].load (std::memory_order_relaxed);
+
+    while (! states[source].compare_exchange_weak (state, (state + wakeStep) | awakeBit,
+                                                   std::memory_order_acq_rel, std::memory_order_relaxed))
+    {}
+}
+
+bool ActivityTracker::isIdle() const noexcept
+{
+    for (auto& state : states)
+        if ((state.load (std::memory_order_acquire) & awakeBit) != 0)
+            return false;
+
+    return true;
+}
+
+bool ActivityTracker::takeNewWake (int source, juce::uint32 state) noexcept
+{
+    const auto wakes = state & ~awakeBit;
+
+    if (wakes == seenWakes[source])
+        return false;
+
+    // Woken again: its silence so far no longer counts.
+    seenWakes[source] = wakes;
+    silentSamples[source] = 0;
+    return true;
+}
+
+bool ActivityTracker::reportOutput (int source, float peak, int numSamples) noexcept
+{
+    takeNewWake (source, states[source].load (std::memory_order_acquire));
+
+    if (peak > silenceThreshold)
+    {
+        silentSamples[source] = 0;
+        return true;
+    }
+
+    silentSamples[source] += numSamples;
+    return silentSamples[source] < silenceHoldSamples;
+}
+
+bool ActivityTracker::trySleep (int source) noexcept
+{
+    auto state = states[source].load (std::memory_order_acquire);
+
+    if (takeNewWake (source, state))
+        return false;
+
+    if (states[source].compare_exchange_strong (state, state & ~awakeBit, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        silentSamples[source] = 0;
+        return true;
+    }
+
+    takeNewWake (source, state);
+    return false;
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    ActivityTracker.h
+    Keeps track of which sound sources (file preview, procedural models) are
+    producing audio, so processBlock can skip idle work and the host gets a
+    realistic tail length.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+class ActivityTracker
+{
+public:
+    // Source 0 is the file preview, procedural model N uses firstModel + N.
+    enum
+    {
+        transport  = 0,
+        firstModel = 1,
+        maxSources = 9
+    };
+
+    // Output below this level for `silenceHoldSeconds` puts a source back to sleep.
+    static constexpr float silenceThreshold   = 0.00003f; // about -90 dB
+    static constexpr double silenceHoldSeconds = 0.25;
+
+    ActivityTracker() = default;
+
+    void prepare (double sampleRate);
+
+    // Called from any thread when a source is (re)started.
+    void wake (int source) noexcept;
+
+    bool isAwake (int source) const noexcept   { return (states[source].load (std::memory_order_acquire) & awakeBit) != 0; }
+    bool isIdle() const noexcept;
+
+    // Audio thread: reports the peak level a source produced in this block.
+    // Returns false once the source has been silent long enough to go to sleep.
+    bool reportOutput (int source, float peak, int numSamples) noexcept;
+
+    // Audio thread: puts a source that has nothing left to play to sleep, unless it was woken
+    // since the audio thread last looked. The check and the sleep are one compare-exchange,
+    // so a wake from another thread in between is never lost.
+    bool trySleep (int source) noexcept;
+
+private:
+    static constexpr juce::uint32 awakeBit = 1, wakeStep = 2;
+
+    // Number of wakes times wakeStep, plus awakeBit.
+    std::atomic<juce::uint32> states[maxSources] {};
+
+    // Audio thread
+    juce::uint32 seenWakes[maxSources] {};
+    int silentSamples[maxSources] {};
+    int silenceHoldSamples = 11025;
+
+    bool takeNewWake (int source, juce::uint32 state) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ActivityTracker)
+};
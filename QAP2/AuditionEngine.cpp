@@ -0,0 +1,368 @@
+/*
+  ==============================================================================
+
+    AuditionEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "AuditionEngine.h"
+
+AuditionEngine::AuditionEngine (ReaderFactory factory)
+    : createReader (std::move (factory))
+{
+    readAheadThread.startThread();
+}
+
+AuditionEngine::~AuditionEngine()
+{
+    cancelPendingRequests();
+
+    for (auto& slot : slots)
+        budget->add (MemoryBudget::previews, -slot.bufferBytes);
+}
+
+void AuditionEngine::prepare (double sampleRate, int maximumBlockSize)
+{
+    reset();
+
+    hostSampleRate = sampleRate;
+
+    const int fadeLength = juce::jmax (1, juce::roundToInt (crossfadeSeconds * sampleRate));
+    fadeCurve.resize ((size_t) fadeLength + 1);
+
+    for (int i = 0; i <= fadeLength; ++i)
+        fadeCurve[(size_t) i] = std::sin ((float) i / (float) fadeLength * juce::MathConstants<float>::halfPi);
+
+    voiceBuffer.setSize (2, maximumBlockSize);
+    sourceBuffer.setSize (2, (int) std::ceil (maximumBlockSize * maxResampleRatio) + 8);
+}
+
+void AuditionEngine::release()
+{
+    reset();
+
+    voiceBuffer.setSize (0, 0);
+    sourceBuffer.setSize (0, 0);
+}
+
+void AuditionEngine::reset()
+{
+    for (auto& voice : voices)
+        if (voice.slot >= 0)
+            stopVoice (voice);
+
+    if (pending.slot >= 0)
+        releaseSlot (pending.slot);
+
+    pending = {};
+
+    int start1, size1, start2, size2;
+    commands.prepareToRead (commands.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)  releaseSlot (queue[start1 + i].slot);
+    for (int i = 0; i < size2; ++i)  releaseSlot (queue[start2 + i].slot);
+
+    commands.finishedRead (size1 + size2);
+}
+
+//==============================================================================
+int AuditionEngine::findSlot (const juce::File& file) const
+{
+    // A file can be open twice after a seek; the copy no voice holds is the one to use.
+    int found = -1;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        if (slots[i].reader != nullptr && slots[i].file == file)
+        {
+            if (slots[i].users.load (std::memory_order_acquire) == 0)
+                return i;
+
+            if (found < 0)
+                found = i;
+        }
+    }
+
+    return found;
+}
+
+int AuditionEngine::openSlot (const juce::File& file, const juce::Array<juce::File>& keep, juce::int64 startSample)
+{
+    // Least recently used slot that the audio thread does not hold and we don't want to keep.
+    int victim = -1;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[i];
+
+        if (slot.users.load (std::memory_order_acquire) > 0 || (slot.reader != nullptr && keep.contains (slot.file)))
+            continue;
+
+        if (victim < 0 || slot.lastUsed < slots[victim].lastUsed)
+            victim = i;
+    }
+
+    if (victim < 0)
+        return -1;
+
+    auto reader = createReader (file);
+
+    if (reader == nullptr)
+        return -1;
+
+    auto& slot = slots[victim];
+    slot.reader.reset();    // unregisters a buffered reader before the next one starts
+    slot.buffered = nullptr;
+    budget->add (MemoryBudget::previews, -slot.bufferBytes);
+    slot.bufferBytes = 0;
+
+    if (dynamic_cast<juce::FileInputStream*> (reader->input) != nullptr)
+    {
+        const auto readAhead = juce::jmax (4096, (int) (reader->sampleRate * readAheadSeconds));
+        slot.bufferBytes = (juce::int64) reader->numChannels * readAhead * (juce::int64) sizeof (float);
+        budget->add (MemoryBudget::previews, slot.bufferBytes);
+        auto buffered = std::make_unique<juce::BufferingAudioReader> (reader.release(), readAheadThread, readAhead);
+        prime (*buffered, startSample);
+        slot.buffered = buffered.get();
+        reader = std::move (buffered);
+    }
+
+    slot.file = file;
+    slot.reader = std::move (reader);
+    slot.lastUsed = ++useClock;
+    return victim;
+}
+
+void AuditionEngine::prime (juce::BufferingAudioReader& reader, juce::int64 startSample)
+{
+    // Wait here, not on the audio thread, for the block the voice will start in.
+    juce::AudioBuffer<float> first (2, 1);
+    reader.setReadTimeout (primeTimeoutMs);
+    reader.read (&first, 0, 1, startSample, true, true);
+    reader.setReadTimeout (0);      // from now on a block that isn't there yet plays as silence
+}
+
+void AuditionEngine::preload (const juce::Array<juce::File>& files)
+{
+    loader.addJob ([this, files] { preloadSlots (files); });
+}
+
+void AuditionEngine::preloadSlots (const juce::Array<juce::File>& files)
+{
+    for (auto& file : files)
+    {
+        auto index = findSlot (file);
+
+        if (index >= 0)
+            slots[index].lastUsed = ++useClock;
+        else
+            openSlot (file, files, 0);
+    }
+}
+
+void AuditionEngine::play (const juce::File& file, juce::int64 startSample, juce::int64 endSample)
+{
+    const auto request = ++latestPlay;
+
+    loader.addJob ([this, request, file, startSample, endSample]
+    {
+        // Rows the user has already stepped past are not worth opening.
+        if (request == latestPlay.load())
+            queueRequest (file, startSample, endSample);
+    });
+}
+
+void AuditionEngine::waitForPendingRequests (int timeoutMs)
+{
+    const auto end = juce::Time::getMillisecondCounter() + (juce::uint32) timeoutMs;
+
+    while (loader.getNumJobs() > 0 && juce::Time::getMillisecondCounter() < end)
+        juce::Thread::sleep (5);
+}
+
+void AuditionEngine::cancelPendingRequests()
+{
+    loader.removeAllJobs (true, 10000);
+}
+
+void AuditionEngine::queueRequest (const juce::File& file, juce::int64 startSample, juce::int64 endSample)
+{
+    auto index = findSlot (file);
+
+    // A streamed reader reads ahead of one position. An idle one is moved to the new start; one
+    // that a voice still plays from keeps its position and the seek opens another.
+    if (index >= 0 && slots[index].buffered != nullptr)
+    {
+        if (slots[index].users.load (std::memory_order_acquire) == 0)
+            prime (*slots[index].buffered, startSample);
+        else
+            index = -1;
+    }
+
+    if (index < 0)
+        index = openSlot (file, {}, startSample);
+
+    if (index < 0 || commands.getFreeSpace() == 0)
+        return;
+
+    auto& slot = slots[index];
+    const auto length = slot.reader->lengthInSamples;
+    const auto start = juce::jlimit ((juce::int64) 0, length, startSample);
+    const auto end = endSample < 0 ? length : juce::jlimit (start, length, endSample);
+
+    slot.lastUsed = ++useClock;
+    slot.users.fetch_add (1, std::memory_order_acq_rel);
+
+    int start1, size1, start2, size2;
+    commands.prepareToWrite (1, start1, size1, start2, size2);
+    queue[size1 > 0 ? start1 : start2] = { index, start, end };
+    commands.finishedWrite (1);
+
+    if (onRequestQueued != nullptr)
+        onRequestQueued();
+}
+
+//==============================================================================
+void AuditionEngine::releaseSlot (int slot) noexcept
+{
+    slots[slot].users.fetch_sub (1, std::memory_order_release);
+}
+
+void AuditionEngine::startVoice (Voice& voice, const Request& request) noexcept
+{
+    voice.slot = request.slot;
+    voice.position = request.start;
+    voice.end = request.end;
+    voice.ratio = juce::jlimit (1.0 / maxResampleRatio, maxResampleRatio, slots[request.slot].reader->sampleRate / hostSampleRate);
+    voice.fade = Voice::Fade::in;
+    voice.fadePosition = 0;
+
+    for (auto& interpolator : voice.interpolators)
+        interpolator.reset();
+}
+
+void AuditionEngine::stopVoice (Voice& voice) noexcept
+{
+    releaseSlot (voice.slot);
+    voice.slot = -1;
+    voice.fade = Voice::Fade::none;
+}
+
+bool AuditionEngine::isCrossfading() const noexcept
+{
+    for (auto& voice : voices)
+        if (voice.slot >= 0 && voice.fade != Voice::Fade::none)
+            return true;
+
+    return false;
+}
+
+bool AuditionEngine::renderAdding (juce::AudioBuffer<float>& output, int numSamples) noexcept
+{
+    // Only the newest request matters: rows the user has already stepped past are dropped.
+    int start1, size1, start2, size2;
+    commands.prepareToRead (commands.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        if (pending.slot >= 0)
+            releaseSlot (pending.slot);
+
+        pending = queue[i < size1 ? start1 + i : start2 + i - size1];
+    }
+
+    commands.finishedRead (size1 + size2);
+
+    // Start the next crossfade once the previous one is over, so gains never jump.
+    if (pending.slot >= 0 && ! isCrossfading())
+    {
+        auto& outgoing = voices[current];
+
+        if (outgoing.slot >= 0)
+        {
+            outgoing.fade = Voice::Fade::out;
+            outgoing.fadePosition = 0;
+        }
+
+        current ^= 1;
+        startVoice (voices[current], pending);
+        pending = {};
+    }
+
+    const int chunk = voiceBuffer.getNumSamples();
+
+    for (int pos = 0; pos < numSamples && chunk > 0; pos += chunk)
+        for (auto& voice : voices)
+            if (voice.slot >= 0)
+                renderVoice (voice, output, pos, juce::jmin (chunk, numSamples - pos));
+
+    return voices[0].slot >= 0 || voices[1].slot >= 0 || pending.slot >= 0 || hasPendingCommands();
+}
+
+void AuditionEngine::renderVoice (Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept
+{
+    auto& reader = *slots[voice.slot].reader;
+    const int fadeLength = (int) fadeCurve.size() - 1;
+
+    // A region ends with a fade that is over by its last sample, instead of a click. It multiplies
+    // with the crossfade, so a region shorter than the fade in still fades out.
+    const double remaining = (double) (voice.end - voice.position) / voice.ratio;     // output samples
+    const bool regionFades = voice.end < reader.lengthInSamples && remaining < fadeLength + numSamples;
+
+    if (voice.ratio == 1.0)
+    {
+        reader.read (&voiceBuffer, 0, numSamples, voice.position, true, true);
+        voice.position += numSamples;
+    }
+    else
+    {
+        // Re-read from the first unconsumed sample, the interpolators keep their own history.
+        const int needed = juce::jmin (sourceBuffer.getNumSamples(), (int) std::ceil (numSamples * voice.ratio) + 4);
+        reader.read (&sourceBuffer, 0, needed, voice.position, true, true);
+
+        int used = 0;
+        for (int ch = 0; ch < 2; ++ch)
+            used = voice.interpolators[ch].process (voice.ratio, sourceBuffer.getReadPointer (ch), voiceBuffer.getWritePointer (ch), numSamples);
+
+        voice.position += used;
+    }
+
+    if (voice.fade != Voice::Fade::none || regionFades)
+    {
+        const bool fadingIn = voice.fade == Voice::Fade::in;
+        auto* left  = voiceBuffer.getWritePointer (0);
+        auto* right = voiceBuffer.getWritePointer (1);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float gain = 1.0f;
+
+            if (voice.fade != Voice::Fade::none)
+            {
+                const int p = juce::jlimit (0, fadeLength, voice.fadePosition++);
+                gain = fadeCurve[(size_t) (fadingIn ? p : fadeLength - p)];
+            }
+
+            if (regionFades)
+                gain *= fadeCurve[(size_t) juce::jlimit (0, fadeLength, (int) (remaining - i) - 1)];
+
+            left[i]  *= gain;
+            right[i] *= gain;
+        }
+    }
+
+    for (int ch = 0; ch < output.getNumChannels(); ++ch)
+        output.addFrom (ch, startSample, voiceBuffer, juce::jmin (ch, 1), 0, numSamples);
+
+    if (voice.fade != Voice::Fade::none && voice.fadePosition >= fadeLength)
+    {
+        if (voice.fade == Voice::Fade::in)
+            voice.fade = Voice::Fade::none;
+        else
+            stopVoice (voice);
+    }
+
+    if (voice.slot >= 0 && voice.position >= voice.end)
+        stopVoice (voice);
+}
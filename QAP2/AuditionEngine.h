@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    AuditionEngine.h
+    File preview with two voices and a short equal-power crossfade between
+    them, so stepping through the file list never stops and restarts the
+    output. Readers for the selected row and its neighbours are opened ahead
+    of time on a loader thread and handed to the audio thread through a
+    lock-free queue; the audio thread never opens, allocates or frees.
+    Readers that stream from disk (files too big for the preview cache) are
+    read ahead on a TimeSliceThread, so the audio thread never waits on it.
+    A request can start anywhere in the file and stop early, which is how the
+    waveform view seeks and plays regions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryBudget.h"
+#include <atomic>
+#include <functional>
+
+class AuditionEngine
+{
+public:
+    using ReaderFactory = std::function<std::unique_ptr<juce::AudioFormatReader> (const juce::File&)>;
+
+    static constexpr int numSlots = 8;                  // two voices plus pre-opened neighbours
+    static constexpr double crossfadeSeconds = 0.012;
+    static constexpr double maxResampleRatio = 8.0;     // e.g. a 192 kHz file on a 24 kHz host
+    static constexpr double readAheadSeconds = 1.0;     // per streamed slot
+    static constexpr int primeTimeoutMs = 200;          // a new streamed slot waits this long for its first block
+
+    explicit AuditionEngine (ReaderFactory factory);
+    ~AuditionEngine();
+
+    // Message thread, while the audio thread is stopped.
+    void prepare (double sampleRate, int maximumBlockSize);
+    void release();
+
+    //==============================================================================
+    // Message thread. Both return at once; the work happens on the loader thread, in order.
+    // Opens readers for these files unless they are open already, reusing idle slots.
+    void preload (const juce::Array<juce::File>& files);
+
+    // Crossfades to `file`, from `startSample` to `endSample` in the file's sample frames (-1 for
+    // its end). Seeking within the playing file is the same call; a streamed file then gets a
+    // second reader, read ahead from the new position, while the first one fades out. A request overtaken by a newer
+    // one before its file was open is dropped, as is one whose file cannot be opened.
+    void play (const juce::File& file, juce::int64 startSample = 0, juce::int64 endSample = -1);
+
+    // Called on the loader thread once a request is queued for the audio thread.
+    std::function<void()> onRequestQueued;
+
+    // Tests and offline renders: waits until the loader thread has nothing left to do.
+    void waitForPendingRequests (int timeoutMs);
+
+    // Drops the requests the loader has not started and waits for the one it is on, so nothing
+    // onRequestQueued uses can go while it runs.
+    void cancelPendingRequests();
+
+    //==============================================================================
+    // Audio thread
+    // Adds the preview into `output`. Returns false once nothing is playing or pending.
+    bool renderAdding (juce::AudioBuffer<float>& output, int numSamples) noexcept;
+    bool hasPendingCommands() const noexcept    { return commands.getNumReady() > 0; }
+
+private:
+    struct Slot
+    {
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::BufferingAudioReader* buffered = nullptr;   // `reader`, if it streams from disk
+        juce::int64 bufferBytes = 0;        // its read-ahead, counted in the previews pool
+        std::atomic<int> users { 0 };       // queued requests and voices on the audio thread
+        juce::uint32 lastUsed = 0;
+    };
+
+    struct Request
+    {
+        int slot = -1;
+        juce::int64 start = 0, end = 0;     // in source samples
+    };
+
+    struct Voice
+    {
+        enum class Fade { none, in, out };
+
+        int slot = -1;                      // -1 when silent
+        juce::int64 position = 0, end = 0;  // in source samples
+        double ratio = 1.0;
+        Fade fade = Fade::none;             // the crossfade; a region's end fades on its own
+        int fadePosition = 0;
+        juce::LagrangeInterpolator interpolators[2];
+    };
+
+    // Loader thread
+    int findSlot (const juce::File& file) const;
+    int openSlot (const juce::File& file, const juce::Array<juce::File>& keep, juce::int64 startSample);
+    void preloadSlots (const juce::Array<juce::File>& files);
+    void queueRequest (const juce::File& file, juce::int64 startSample, juce::int64 endSample);
+    static void prime (juce::BufferingAudioReader& reader, juce::int64 startSample);
+
+    void releaseSlot (int slot) noexcept;
+    void startVoice (Voice& voice, const Request& request) noexcept;
+    void stopVoice (Voice& voice) noexcept;
+    void renderVoice (Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept;
+    void reset();
+    bool isCrossfading() const noexcept;
+
+    ReaderFactory createReader;
+    juce::SharedResourcePointer<MemoryBudget> budget;   // readers from the preview cache count there already
+    juce::TimeSliceThread readAheadThread { "Audition read-ahead" };     // before the slots, it outlives their readers
+    Slot slots[numSlots];
+    juce::uint32 useClock = 0;
+    std::atomic<juce::uint32> latestPlay { 0 };
+
+    static constexpr int queueSize = 16;
+    juce::AbstractFifo commands { queueSize };
+    Request queue[queueSize] {};
+
+    // Audio thread only
+    Voice voices[2];
+    int current = 0;                        // index of the voice that is (or becomes) audible
+    Request pending;                        // waiting for the running crossfade to finish
+
+    double hostSampleRate = 44100.0;
+    std::vector<float> fadeCurve;           // sin (0 .. pi/2), cos is read backwards
+    juce::AudioBuffer<float> voiceBuffer, sourceBuffer;
+
+    juce::ThreadPool loader { 1 };          // last, so its jobs finish before anything they use goes
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AuditionEngine)
+};
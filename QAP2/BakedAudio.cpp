@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    BakedAudio.cpp
+
+  ==============================================================================
+*/
+
+#include "BakedAudio.h"
+#include "ModelRegistry.h"
+
+BakedAudioPool::BakedAudioPool (ProceduralModel& owner, MemoryBudget::Pool budgetPool)
+    : model (owner), pool (budgetPool)
+{
+}
+
+BakedAudioPool::~BakedAudioPool()
+{
+    budget->add (pool, -memoryBytes.load());
+}
+
+std::vector<float> BakedAudioPool::readParameters() const
+{
+    std::vector<float> values (model.getParameterSpecs().size());
+
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = model.getParameter ((int) i);
+
+    return values;
+}
+
+bool BakedAudioPool::isStale (const BakedAudio& audio, const std::vector<float>& current, double rate) const
+{
+    if (audio.sampleRate != rate)
+        return true;
+
+    auto& specs = model.getParameterSpecs();
+
+    for (size_t i = 0; i < current.size(); ++i)
+        if (std::abs (audio.centre[i] - current[i]) > 0.02f * (specs[i].maxValue - specs[i].minValue))
+            return true;
+
+    return false;
+}
+
+void BakedAudioPool::account (juce::int64 bytes) noexcept
+{
+    memoryBytes.fetch_add (bytes, std::memory_order_relaxed);
+    budget->add (pool, bytes);
+}
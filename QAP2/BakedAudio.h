@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    BakedAudio.h
+    What SampleBank and GranularBed have in common: audio rendered from a
+    model's slider values on a background thread, held by the audio thread
+    while it sounds, and counted against one MemoryBudget pool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryBudget.h"
+#include <atomic>
+#include <vector>
+
+class ProceduralModel;
+
+// One rendered piece of audio. The render thread only frees or reuses it while nobody holds it.
+struct BakedAudio
+{
+    std::atomic<int> users { 0 };       // audio thread holders
+    double sampleRate = 0.0;
+    std::vector<float> centre;          // slider values it was rendered around
+
+    // Audio thread. Claim first, then check: the render thread never reuses a claimed piece, so
+    // what `stillValid` saw holds until release(). False, with nothing held, if the check fails.
+    template <typename Check>
+    bool claim (Check&& stillValid) noexcept
+    {
+        users.fetch_add (1);
+
+        if (stillValid())
+            return true;
+
+        users.fetch_sub (1);
+        return false;
+    }
+
+    void release() noexcept             { users.fetch_sub (1); }
+    bool isHeld() const noexcept        { return users.load() != 0; }
+};
+
+//==============================================================================
+// Render thread side: reads the owner's sliders and keeps the bytes it holds in `pool`.
+class BakedAudioPool
+{
+public:
+    BakedAudioPool (ProceduralModel& owner, MemoryBudget::Pool pool);
+    ~BakedAudioPool();      // gives back whatever is still counted
+
+    std::vector<float> readParameters() const;
+
+    // Rendered at another rate, or a slider has moved by more than 2% of its range since.
+    bool isStale (const BakedAudio& audio, const std::vector<float>& current, double rate) const;
+
+    void account (juce::int64 bytes) noexcept;
+    juce::int64 getMemoryBytes() const noexcept             { return memoryBytes.load (std::memory_order_relaxed); }
+
+    bool isOverLimit() const noexcept                       { return budget->isOverLimit (pool); }
+    bool canGrow (juce::int64 bytes) const noexcept         { return budget->canGrow (pool, bytes); }
+    juce::int64 getRoom() const noexcept                    { return budget->getLimit (pool) - budget->getBytes (pool); }
+    void noteHit() noexcept                                 { budget->noteHit (pool); }
+    void noteMiss() noexcept                                { budget->noteMiss (pool); }
+
+private:
+    ProceduralModel& model;
+    const MemoryBudget::Pool pool;
+    juce::SharedResourcePointer<MemoryBudget> budget;
+    std::atomic<juce::int64> memoryBytes { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BakedAudioPool)
+};
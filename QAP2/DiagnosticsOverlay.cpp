@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    DiagnosticsOverlay.cpp
+
+  ==============================================================================
+*/
+
+#include "DiagnosticsOverlay.h"
+
+namespace
+{
+    juce::String formatBytes (juce::int64 bytes)
+    {
+        return juce::String ((double) bytes / (double) MemoryBudget::megabyte, 1) + " MB";
+    }
+}
+
+DiagnosticsOverlay::DiagnosticsOverlay (PerformanceMonitor& monitorToShow, MemoryBudget& budgetToShow,
+                                        juce::AudioProcessorValueTreeState& state)
+    : monitor (monitorToShow), budget (budgetToShow)
+{
+    history.reserve (historySize);
+    memory = budget.getStats();
+
+    // The attachment selects the current choice, so the items have to be there first.
+    addAndMakeVisible (capBox);
+    capBox.addItemList (MemoryBudget::getCapNames(), 1);
+    capBox.setTooltip ("Memory cap for the caches of every QAP instance in this process");
+    capAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (state, MemoryBudget::capParameterId, capBox);
+
+    addAndMakeVisible (dumpButton);
+    dumpButton.onClick = [this]
+    {
+        auto file = dumpHistory();
+        dumpResult = file != juce::File() ? "saved " + file.getFileName() : juce::String ("could not save the history");
+        dumpButton.setTooltip (file.getFullPathName());
+        repaint();
+    };
+
+    setInterceptsMouseClicks (false, true);
+    startTimerHz (10);
+}
+
+DiagnosticsOverlay::~DiagnosticsOverlay()
+{
+    stopTimer();
+}
+
+void DiagnosticsOverlay::timerCallback()
+{
+    PerformanceMonitor::Snapshot snapshot;
+    bool changed = false;
+
+    while (monitor.popSnapshot (snapshot))
+    {
+        if (history.size() >= (size_t) historySize)
+            history.erase (history.begin());
+
+        history.push_back (snapshot);
+        latest = snapshot;
+        hasSnapshot = changed = true;
+    }
+
+    // The caches change without audio running, so poll them separately.
+    auto stats = budget.getStats();
+
+    for (int i = 0; i < MemoryBudget::numPools && ! changed; ++i)
+        changed = stats.pools[i].bytes != memory.pools[i].bytes || stats.pools[i].hits != memory.pools[i].hits
+                    || stats.pools[i].misses != memory.pools[i].misses || stats.pools[i].limit != memory.pools[i].limit;
+
+    memory = stats;
+
+    if (changed)
+        repaint();
+}
+
+void DiagnosticsOverlay::paint (juce::Graphics& g)
+{
+    g.setColour (juce::Colours::black.withAlpha (0.75f));
+    g.fillRoundedRectangle (getLocalBounds().toFloat(), 6.0f);
+
+    g.setColour (juce::Colours::white);
+    g.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+
+    auto area = getLocalBounds().reduced (8).withTrimmedBottom (28);
+    const int lineHeight = 16;
+
+    auto line = [&] (const juce::String& text)
+    {
+        g.drawText (text, area.removeFromTop (lineHeight), juce::Justification::centredLeft);
+    };
+
+    // Where the last dump went; the button's tooltip has the full path.
+    if (dumpResult.isNotEmpty())
+        g.drawText (dumpResult, area.removeFromBottom (lineHeight), juce::Justification::centredLeft);
+
+    // Memory first, it does not need audio
+    line ("memory " + formatBytes (memory.total) + " of " + formatBytes (memory.cap));
+
+    for (auto& pool : memory.pools)
+        line (juce::String (pool.name).paddedRight (' ', 13)
+                + (formatBytes (pool.bytes) + " / " + formatBytes (pool.limit)).paddedRight (' ', 22)
+                + (pool.hits + pool.misses > 0 ? juce::String (juce::roundToInt (pool.getHitRate() * 100.0)) + "% hits" : juce::String()));
+
+    area.removeFromTop (lineHeight / 2);
+
+    if (! hasSnapshot)
+    {
+        line ("Waiting for audio...");
+        return;
+    }
+
+    line (juce::String::formatted ("%d blocks  %d misses  worst load %.0f%%",
+                                   (int) latest.blocks, (int) latest.deadlineMisses, latest.worstBlockLoad * 100.0));
+    line (juce::String::formatted ("allocs %d  locks %d  dropped %d",
+                                   (int) latest.allocations, (int) latest.lockAcquisitions, (int) monitor.getDroppedSnapshots()));
+    line ("stage          min     mean      p99      max");
+
+    for (int i = 0; i < PerformanceMonitor::numStages; ++i)
+    {
+        if (latest.stageNames[i] == nullptr)
+            continue;
+
+        auto& s = latest.stages[i];
+        line (juce::String (latest.stageNames[i]).paddedRight (' ', 10)
+                + juce::String::formatted ("%8llu %8llu %8llu %8llu",
+                                           (unsigned long long) s.minCycles, (unsigned long long) s.meanCycles,
+                                           (unsigned long long) s.p99Cycles, (unsigned long long) s.maxCycles));
+    }
+}
+
+void DiagnosticsOverlay::resized()
+{
+    auto bottom = getLocalBounds().reduced (8).removeFromBottom (22);
+    dumpButton.setBounds (bottom.removeFromRight (90));
+    capBox.setBounds (bottom.removeFromLeft (90));
+}
+
+juce::File DiagnosticsOverlay::dumpHistory() const
+{
+    auto file = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                    .getChildFile ("QAP")
+                    .getChildFile ("diagnostics-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S") + ".json");
+
+    file.getParentDirectory().createDirectory();
+
+    juce::StringArray entries;
+
+    for (auto& snapshot : history)
+        entries.add (PerformanceMonitor::toJSON (snapshot));
+
+    if (! file.replaceWithText ("[\n" + entries.joinIntoString (",\n") + "\n]\n"))
+        return {};
+
+    return file;
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    DiagnosticsOverlay.h
+    Editor overlay showing the PerformanceMonitor snapshots, with a JSON dump
+    of the recent history for offline analysis, and the MemoryBudget pools
+    with their hit rates and the cap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PerformanceMonitor.h"
+#include "MemoryBudget.h"
+
+class DiagnosticsOverlay  : public juce::Component,
+                            private juce::Timer
+{
+public:
+    DiagnosticsOverlay (PerformanceMonitor& monitorToShow, MemoryBudget& budgetToShow,
+                        juce::AudioProcessorValueTreeState& state);
+    ~DiagnosticsOverlay() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    // Writes every snapshot still in the history as a JSON array. Returns the file written, or
+    // File() if it could not be written.
+    juce::File dumpHistory() const;
+
+    static constexpr int historySize = 240; // one minute at four snapshots per second
+
+private:
+    void timerCallback() override;
+
+    PerformanceMonitor& monitor;
+    std::vector<PerformanceMonitor::Snapshot> history;
+    PerformanceMonitor::Snapshot latest;
+    bool hasSnapshot = false;
+
+    MemoryBudget& budget;
+    MemoryBudget::Stats memory;
+
+    juce::TextButton dumpButton { "Dump JSON" };
+    juce::String dumpResult;                // shown under the stats once the button was used
+    juce::ComboBox capBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> capAttachment;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiagnosticsOverlay)
+};
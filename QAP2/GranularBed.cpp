@@ -0,0 +1,310 @@
+/*
+  ==============================================================================
+
+    GranularBed.cpp
+
+  ==============================================================================
+*/
+
+#include "GranularBed.h"
+#include "ModelRegistry.h"
+
+GranularBed::GranularBed (ProceduralModel& owner, Settings bedSettings, RenderFunction renderFunction)
+    : juce::Thread ("QAP granular bed"),
+      model (owner), settings (bedSettings), render (std::move (renderFunction)),
+      baked (owner, MemoryBudget::granularBeds)
+{
+}
+
+GranularBed::~GranularBed()
+{
+    stopThread (10000);
+}
+
+void GranularBed::prepare (double sampleRate, int maximumBlockSize)
+{
+    stop();
+
+    bedSampleRate.store (sampleRate, std::memory_order_relaxed);
+
+    grainLength = juce::jmax (16, juce::roundToInt (settings.grainSeconds * sampleRate));
+    hop = juce::jmax (1, grainLength / settings.overlap);
+    crossfadeLength = juce::jmax (1, juce::roundToInt (settings.crossfadeSeconds * sampleRate));
+
+    // Grains start at random offsets, so they are uncorrelated and add up in power: scale by the
+    // summed power of `overlap` Hann windows (3/8 each) to keep the bed at the source's level.
+    grainGain = 1.0f / std::sqrt ((float) settings.overlap * 0.375f);
+
+    window.resize ((size_t) grainLength);
+    for (int i = 0; i < grainLength; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) i / (float) grainLength);
+
+    chunkSize = juce::jmax (1, maximumBlockSize);
+    grainScratch.allocate ((size_t) chunkSize, true);
+    mix.allocate ((size_t) chunkSize, true);
+
+    if (! isThreadRunning())
+        startThread (juce::Thread::Priority::low);
+}
+
+void GranularBed::release()
+{
+    stop();
+}
+
+bool GranularBed::canPlay() const noexcept
+{
+    return model.isBakedModeOn() && latest.load (std::memory_order_acquire) >= 0;
+}
+
+bool GranularBed::isReady() const noexcept
+{
+    return latest.load (std::memory_order_acquire) >= 0 && upToDate.load (std::memory_order_acquire);
+}
+
+//==============================================================================
+void GranularBed::run()
+{
+    // As SampleBank::run: polls while baked mode is on or sources are left, sleeps until wake() after.
+    while (! threadShouldExit())
+        if (! renderNextSource())
+            wait (model.isBakedModeOn() || baked.getMemoryBytes() > 0 ? 50 : -1);
+}
+
+void GranularBed::freeSource (Source& source)
+{
+    baked.account (-(juce::int64) source.audio.getNumSamples() * (juce::int64) sizeof (float));
+    source.audio.setSize (0, 0);
+    source.sampleRate = 0.0;
+}
+
+bool GranularBed::renderNextSource()
+{
+    const double rate = bedSampleRate.load (std::memory_order_relaxed);
+
+    if (! model.isBakedModeOn() || rate <= 0.0)
+    {
+        // Stop offering a source, then free whatever the audio thread no longer plays.
+        latest.store (-1);
+        upToDate.store (false);
+
+        for (auto& source : sources)
+            if (! source.isHeld() && source.audio.getNumSamples() > 0)
+                freeSource (source);
+
+        return false;
+    }
+
+    // Wait for the sliders to settle: a drag would otherwise render a source per poll.
+    const auto current = baked.readParameters();
+
+    if (current != lastSeen)
+    {
+        lastSeen = current;
+        return false;
+    }
+
+    const int shown = latest.load();
+
+    if (shown >= 0 && ! baked.isStale (sources[(size_t) shown], current, rate))
+    {
+        upToDate.store (true);
+
+        // Under pressure, the sources we crossfaded away from go before they are reused.
+        if (baked.isOverLimit())
+            for (int i = 0; i < numSources; ++i)
+                if (i != shown && ! sources[(size_t) i].isHeld() && sources[(size_t) i].audio.getNumSamples() > 0)
+                    freeSource (sources[(size_t) i]);
+
+        return false;
+    }
+
+    upToDate.store (false);
+
+    int target = -1;
+
+    for (int i = 0; i < numSources && target < 0; ++i)
+        if (i != shown && ! sources[(size_t) i].isHeld())
+            target = i;
+
+    if (target < 0)
+        return false;   // both others still sounding, try again after the crossfade
+
+    auto& source = sources[(size_t) target];
+    const auto held = (juce::int64) source.audio.getNumSamples() * (juce::int64) sizeof (float);
+    auto length = (int) std::ceil (settings.sourceSeconds * rate);
+
+    // Shorter sources when the budget is tight: the grains only need somewhere to come from.
+    if (! baked.canGrow ((juce::int64) length * (juce::int64) sizeof (float) - held))
+    {
+        const auto room = baked.getRoom() + held;
+        length = (int) juce::jlimit ((juce::int64) std::ceil (settings.minimumSourceSeconds * rate), (juce::int64) length,
+                                     room / (juce::int64) sizeof (float));
+    }
+
+    baked.account (-held);
+    source.audio.setSize (1, length);
+    source.audio.clear();
+    baked.account ((juce::int64) length * (juce::int64) sizeof (float));
+
+    render (current, rate, source.audio);
+    source.sampleRate = rate;
+    source.centre = current;
+
+    latest.store (target);
+    upToDate.store (true);
+    return true;
+}
+
+//==============================================================================
+bool GranularBed::adoptLatest() noexcept
+{
+    const int next = latest.load();
+
+    if (next < 0 || next == current)
+        return false;
+
+    if (! sources[(size_t) next].claim ([this, next] { return latest.load() == next; }))
+        return false;
+
+    releaseSource (previous);   // a crossfade still running is cut short, its grains finish anyway
+    previous = current;
+    current = next;
+    crossfadePosition = 0;
+    return true;
+}
+
+void GranularBed::releaseSource (int& index) noexcept
+{
+    if (index >= 0)
+        sources[(size_t) index].release();
+
+    index = -1;
+}
+
+void GranularBed::startGrain (int source, float gain, int delay) noexcept
+{
+    auto& audio = sources[(size_t) source].audio;
+    const int range = audio.getNumSamples() - grainLength;
+
+    if (range <= 0)
+        return;
+
+    for (auto& grain : grains)
+    {
+        if (grain.source >= 0)
+            continue;
+
+        sources[(size_t) source].users.fetch_add (1);     // already held as current or previous, no check needed
+        grain.source = source;
+        grain.data = audio.getReadPointer (0, playRandom.nextInt (range));
+        grain.position = 0;
+        grain.delay = delay;
+        grain.gain = gain;
+        return;
+    }
+}
+
+void GranularBed::stop() noexcept
+{
+    for (auto& grain : grains)
+        if (grain.source >= 0)
+            releaseSource (grain.source);
+
+    releaseSource (current);
+    releaseSource (previous);
+    running.store (false);
+    samplesToNextGrain = 0;
+}
+
+bool GranularBed::isActive() const noexcept
+{
+    if (isRunning())
+        return true;
+
+    for (auto& grain : grains)
+        if (grain.source >= 0)
+            return true;
+
+    return false;
+}
+
+float GranularBed::renderAdding (juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept
+{
+    float peak = 0.0f;
+
+    for (int pos = 0; pos < numSamples && chunkSize > 0; pos += chunkSize)
+        peak = juce::jmax (peak, renderChunk (output.getWritePointer (0, startSample + pos), juce::jmin (chunkSize, numSamples - pos)));
+
+    return peak;
+}
+
+float GranularBed::renderChunk (float* output, int numSamples) noexcept
+{
+    adoptLatest();
+
+    if (isRunning() && current >= 0)
+    {
+        // A new grain every hop, jittered so the grain rate never becomes audible as a pitch.
+        while (samplesToNextGrain < numSamples)
+        {
+            if (previous >= 0)
+            {
+                const auto t = juce::jlimit (0.0f, 1.0f, (float) (crossfadePosition + samplesToNextGrain) / (float) crossfadeLength);
+                const auto angle = t * juce::MathConstants<float>::halfPi;
+                startGrain (current,  grainGain * std::sin (angle), samplesToNextGrain);
+                startGrain (previous, grainGain * std::cos (angle), samplesToNextGrain);
+            }
+            else
+            {
+                startGrain (current, grainGain, samplesToNextGrain);
+            }
+
+            samplesToNextGrain += juce::jmax (1, juce::roundToInt ((float) hop * (0.75f + 0.5f * playRandom.nextFloat())));
+        }
+
+        samplesToNextGrain -= numSamples;
+    }
+    else
+    {
+        samplesToNextGrain = 0;
+    }
+
+    if (previous >= 0)
+    {
+        crossfadePosition += numSamples;
+
+        if (crossfadePosition >= crossfadeLength)
+            releaseSource (previous);
+    }
+
+    // Window and mix every grain with vector ops: one multiply and one multiply-add per grain.
+    juce::FloatVectorOperations::clear (mix.get(), numSamples);
+    bool any = false;
+
+    for (auto& grain : grains)
+    {
+        if (grain.source < 0)
+            continue;
+
+        const int start = grain.delay;
+        const int n = juce::jmin (numSamples - start, grainLength - grain.position);
+
+        juce::FloatVectorOperations::multiply (grainScratch.get(), grain.data + grain.position, window.data() + grain.position, n);
+        juce::FloatVectorOperations::addWithMultiply (mix.get() + start, grainScratch.get(), grain.gain, n);
+
+        grain.position += n;
+        grain.delay = 0;
+        any = true;
+
+        if (grain.position >= grainLength)
+            releaseSource (grain.source);
+    }
+
+    if (! any)
+        return 0.0f;
+
+    juce::FloatVectorOperations::add (output, mix.get(), numSamples);
+    const auto range = juce::FloatVectorOperations::findMinAndMax (mix.get(), numSamples);
+    return juce::jmax (-range.getStart(), range.getEnd());
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    GranularBed.h
+    Endless ambience bed for a continuous model (Fire): a background thread
+    renders a few seconds of the model, and the audio thread sustains it by
+    overlap-adding short windowed grains taken from random positions. When
+    the sliders move, a new source is rendered in the background and the
+    grains crossfade over to it. Sources count against the MemoryBudget and
+    are rendered shorter when it is tight.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BakedAudio.h"
+#include <array>
+#include <atomic>
+
+class ProceduralModel;
+
+class GranularBed  : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        double sourceSeconds = 4.0;
+        double minimumSourceSeconds = 1.0;  // when the budget is tight
+        double grainSeconds = 0.12;
+        int overlap = 4;                    // grains sounding at once
+        double crossfadeSeconds = 0.5;      // from one source to the next
+    };
+
+    // Bed thread: renders the model with the given parameter values (in spec order) into
+    // channel 0 of `output`, all of it.
+    using RenderFunction = std::function<void (const std::vector<float>& parameterValues, double sampleRate,
+                                               juce::AudioBuffer<float>& output)>;
+
+    GranularBed (ProceduralModel& owner, Settings settings, RenderFunction render);
+    ~GranularBed() override;
+
+    // Message thread. Renders while the owner's baked mode is on.
+    void prepare (double sampleRate, int maximumBlockSize);
+    void release();
+
+    // Any thread: the owner's baked mode changed, see ProceduralModel::bakedModeChanged.
+    void wake()                                     { notify(); }
+
+    bool canPlay() const noexcept;
+    bool isReady() const noexcept;      // the source matches the current sliders
+    juce::int64 getMemoryBytes() const noexcept     { return baked.getMemoryBytes(); }
+
+    // Any thread
+    void setRunning (bool shouldRun) noexcept       { running.store (shouldRun, std::memory_order_release); }
+    bool isRunning() const noexcept                 { return running.load (std::memory_order_acquire); }
+
+    //==============================================================================
+    // Audio thread
+    bool isActive() const noexcept;
+    float renderAdding (juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept;
+    void stop() noexcept;
+
+private:
+    static constexpr int numSources = 3;    // playing, crossfading from, being rendered
+    static constexpr int maxGrains = 32;
+
+    // Held as the current or previous source and by each grain taken from it.
+    struct Source  : BakedAudio
+    {
+        juce::AudioBuffer<float> audio;
+    };
+
+    struct Grain
+    {
+        int source = -1;
+        const float* data = nullptr;        // start of the grain in the source
+        int position = 0;
+        int delay = 0;                      // samples into the block before it starts
+        float gain = 0.0f;
+    };
+
+    void run() override;
+    bool renderNextSource();
+    void freeSource (Source& source);
+
+    bool adoptLatest() noexcept;
+    void releaseSource (int& index) noexcept;
+    void startGrain (int source, float gain, int delay) noexcept;
+    float renderChunk (float* output, int numSamples) noexcept;
+
+    ProceduralModel& model;
+    const Settings settings;
+    const RenderFunction render;
+
+    std::array<Source, numSources> sources;
+    std::atomic<int> latest { -1 };         // newest complete source, -1 for none
+    BakedAudioPool baked;
+    std::atomic<double> bedSampleRate { 0.0 };
+    std::vector<float> lastSeen;            // bed thread: slider values of the previous poll
+    std::atomic<bool> upToDate { false };   // `latest` matches the sliders
+
+    std::atomic<bool> running { false };
+
+    // Audio thread
+    int current = -1, previous = -1;
+    int crossfadePosition = 0, crossfadeLength = 1;
+    int grainLength = 1, hop = 1, samplesToNextGrain = 0;
+    float grainGain = 1.0f;
+    std::vector<float> window;
+    juce::HeapBlock<float> grainScratch, mix;
+    int chunkSize = 0;
+    std::array<Grain, maxGrains> grains;
+    juce::Random playRandom;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularBed)
+};
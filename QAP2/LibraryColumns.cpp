@@ -0,0 +1,640 @@
+/*
+  ==============================================================================
+
+    LibraryColumns.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryColumns.h"
+#include "LibraryService.h"
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+//==============================================================================
+const std::vector<float>* LibraryColumns::getValues (LibraryColumn column) const noexcept
+{
+    switch (column)
+    {
+        case LibraryColumn::duration:    return &duration;
+        case LibraryColumn::sampleRate:  return &sampleRate;
+        case LibraryColumn::channels:    return &channels;
+        case LibraryColumn::loudness:    return &loudness;
+        case LibraryColumn::date:        return &date;
+        case LibraryColumn::name:
+        case LibraryColumn::category:
+        case LibraryColumn::numColumns:
+        default:                         return nullptr;
+    }
+}
+
+void LibraryColumns::addFile (const juce::File& file, const juce::File& root, juce::AudioFormatManager* formats)
+{
+    float seconds = 0.0f, rate = 0.0f, numChannels = 0.0f;
+
+    if (formats != nullptr)
+    {
+        if (std::unique_ptr<juce::AudioFormatReader> reader { formats->createReaderFor (file) })
+        {
+            rate = (float) reader->sampleRate;
+            numChannels = (float) reader->numChannels;
+            seconds = rate > 0.0f ? (float) ((double) reader->lengthInSamples / reader->sampleRate) : 0.0f;
+        }
+    }
+
+    duration.push_back (seconds);
+    sampleRate.push_back (rate);
+    channels.push_back (numChannels);
+    loudness.push_back (std::numeric_limits<float>::quiet_NaN());
+    transientOffsets.push_back ((juce::uint32) transients.size());
+    date.push_back ((float) ((double) file.getLastModificationTime().toMilliseconds() / 86400000.0));
+
+    // The first folder below the root, e.g. "impacts" for <root>/impacts/metal/hit.wav
+    auto relative = file.getParentDirectory().getRelativePathFrom (root);
+    auto folder = relative == "." ? juce::String() : relative.upToFirstOccurrenceOf (juce::File::getSeparatorString(), false, false);
+    auto categoryIndex = categoryNames.indexOf (folder);
+
+    if (categoryIndex < 0)
+    {
+        categoryIndex = juce::jmin (categoryNames.size(), 0xffff);
+
+        if (categoryIndex == categoryNames.size())
+            categoryNames.add (folder);
+    }
+
+    category.push_back ((juce::uint16) categoryIndex);
+}
+
+void LibraryColumns::addFrom (const LibraryColumns& source, int id)
+{
+    const auto i = (size_t) id;
+    duration.push_back (source.duration[i]);
+    sampleRate.push_back (source.sampleRate[i]);
+    channels.push_back (source.channels[i]);
+    loudness.push_back (source.loudness[i]);
+    date.push_back (source.date[i]);
+    category.push_back (source.category[i]);
+
+    transients.insert (transients.end(), source.transients.begin() + source.transientOffsets[i],
+                       source.transients.begin() + source.transientOffsets[i + 1]);
+    transientOffsets.push_back ((juce::uint32) transients.size());
+}
+
+std::vector<juce::uint32> LibraryColumns::getTransients (int id) const
+{
+    if (! juce::isPositiveAndBelow (id, (int) transientOffsets.size() - 1))
+        return {};
+
+    return { transients.begin() + transientOffsets[(size_t) id], transients.begin() + transientOffsets[(size_t) id + 1] };
+}
+
+void LibraryColumns::buildOrder (LibraryColumn column, const LibraryIndex& index)
+{
+    auto& ids = order[(int) column];
+    ids.resize ((size_t) index.size());
+    std::iota (ids.begin(), ids.end(), 0);
+
+    if (auto* values = getValues (column))
+    {
+        // Ascending, unknown (NaN) values last
+        std::stable_sort (ids.begin(), ids.end(), [values] (int a, int b)
+        {
+            const float va = (*values)[(size_t) a], vb = (*values)[(size_t) b];
+            return std::isnan (vb) ? ! std::isnan (va) : va < vb;
+        });
+    }
+    else if (column == LibraryColumn::name)
+    {
+        std::stable_sort (ids.begin(), ids.end(), [&index] (int a, int b)
+        {
+            return index.getKeyView (a) < index.getKeyView (b);
+        });
+    }
+    else if (column == LibraryColumn::category)
+    {
+        std::vector<int> rank ((size_t) categoryNames.size());
+        std::vector<int> byName (rank.size());
+        std::iota (byName.begin(), byName.end(), 0);
+        std::sort (byName.begin(), byName.end(), [this] (int a, int b)
+        {
+            return categoryNames[a].compareIgnoreCase (categoryNames[b]) < 0;
+        });
+
+        for (size_t i = 0; i < byName.size(); ++i)
+            rank[(size_t) byName[i]] = (int) i;
+
+        std::stable_sort (ids.begin(), ids.end(), [this, &rank] (int a, int b)
+        {
+            return rank[category[(size_t) a]] < rank[category[(size_t) b]];
+        });
+    }
+}
+
+void LibraryColumns::buildOrders (const LibraryIndex& index)
+{
+    for (int c = 0; c < numLibraryColumns; ++c)
+        buildOrder ((LibraryColumn) c, index);
+}
+
+void LibraryColumns::applyRange (LibraryColumn column, float minValue, float maxValue, std::vector<juce::uint8>& keep) const noexcept
+{
+    auto* values = getValues (column);
+
+    if (values == nullptr)
+        return;
+
+    const float* v = values->data();
+    juce::uint8* k = keep.data();
+    const size_t n = juce::jmin (keep.size(), values->size());
+
+    // NaN fails both comparisons, so unanalysed files never match a range.
+    for (size_t i = 0; i < n; ++i)
+        k[i] &= (juce::uint8) ((v[i] >= minValue) & (v[i] <= maxValue));
+}
+
+bool LibraryColumns::isUnknown (LibraryColumn column, int id) const noexcept
+{
+    auto* values = getValues (column);
+    return values != nullptr && std::isnan ((*values)[(size_t) id]);
+}
+
+bool LibraryColumns::isSameValue (LibraryColumn column, const LibraryIndex& index, int a, int b) const noexcept
+{
+    if (auto* values = getValues (column))
+    {
+        const float va = (*values)[(size_t) a], vb = (*values)[(size_t) b];
+        return va == vb || (std::isnan (va) && std::isnan (vb));
+    }
+
+    if (column == LibraryColumn::category)
+        return category[(size_t) a] == category[(size_t) b];
+
+    return index.getKeyView (a) == index.getKeyView (b);
+}
+
+int LibraryColumns::computeRanks (LibraryColumn column, const LibraryIndex& index, std::vector<juce::uint32>& ranks) const
+{
+    auto& ids = order[(int) column];
+    ranks.resize (ids.size());
+
+    juce::uint32 rank = 0;
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (i > 0 && ! isSameValue (column, index, ids[i - 1], ids[i]))
+            ++rank;
+
+        ranks[(size_t) ids[i]] = rank;
+    }
+
+    return ids.empty() ? 0 : (int) rank + 1;
+}
+
+std::vector<int> LibraryColumns::sortRows (const std::vector<juce::uint8>& keep, const std::vector<LibraryQuery::SortKey>& keys,
+                                           const LibraryIndex& index) const
+{
+    std::vector<int> rows;
+
+    if (keys.empty())
+    {
+        for (size_t i = 0; i < keep.size(); ++i)
+            if (keep[i] != 0)
+                rows.push_back ((int) i);
+
+        return rows;
+    }
+
+    // Least significant key: walk its permutation. Descending reverses it, but unknown values stay last.
+    {
+        const auto column = keys.back().column;
+        auto& ids = order[(int) column];
+        size_t known = ids.size();
+
+        while (known > 0 && isUnknown (column, ids[known - 1]))
+            --known;
+
+        auto add = [&] (int id) { if (keep[(size_t) id] != 0) rows.push_back (id); };
+
+        if (keys.back().ascending)
+            for (size_t i = 0; i < known; ++i)          add (ids[i]);
+        else
+            for (size_t i = known; i > 0; --i)          add (ids[i - 1]);
+
+        for (size_t i = known; i < ids.size(); ++i)     add (ids[i]);
+    }
+
+    // More significant keys: stable counting sorts on dense ranks.
+    std::vector<juce::uint32> ranks;
+    std::vector<int> counts, sorted (rows.size());
+
+    for (auto key = keys.rbegin() + 1; key != keys.rend(); ++key)
+    {
+        const auto column = key->column;
+        const int numRanks = computeRanks (column, index, ranks);
+        auto& ids = order[(int) column];
+        const bool unknownLast = ! ids.empty() && isUnknown (column, ids.back());
+        const int numKnown = numRanks - (unknownLast ? 1 : 0);    // 0 while a column is all unanalysed
+
+        auto rankOf = [&] (int id) -> juce::uint32
+        {
+            const auto r = ranks[(size_t) id];
+            return key->ascending || (int) r >= numKnown ? r : (juce::uint32) (numKnown - 1) - r;
+        };
+
+        counts.assign ((size_t) numRanks + 1, 0);
+
+        for (auto id : rows)
+            ++counts[(size_t) rankOf (id) + 1];
+
+        for (size_t r = 1; r < counts.size(); ++r)
+            counts[r] += counts[r - 1];
+
+        for (auto id : rows)
+            sorted[(size_t) counts[(size_t) rankOf (id)]++] = id;
+
+        rows.swap (sorted);
+    }
+
+    return rows;
+}
+
+//==============================================================================
+juce::String LibraryColumns::getColumnName (LibraryColumn column)
+{
+    switch (column)
+    {
+        case LibraryColumn::name:        return "Name";
+        case LibraryColumn::duration:    return "Duration";
+        case LibraryColumn::sampleRate:  return "Rate";
+        case LibraryColumn::channels:    return "Ch";
+        case LibraryColumn::loudness:    return "Loudness";
+        case LibraryColumn::category:    return "Category";
+        case LibraryColumn::date:        return "Date";
+        case LibraryColumn::numColumns:
+        default:                         return {};
+    }
+}
+
+juce::String LibraryColumns::formatValue (LibraryColumn column, const LibraryIndex& index, int id)
+{
+    auto& columns = index.columns;
+    const auto i = (size_t) id;
+
+    switch (column)
+    {
+        case LibraryColumn::name:        return index.getName (id);
+        case LibraryColumn::duration:    return juce::String (columns.duration[i], 2) + " s";
+        case LibraryColumn::sampleRate:  return juce::String (columns.sampleRate[i] / 1000.0f, 1) + " kHz";
+        case LibraryColumn::channels:    return juce::String ((int) columns.channels[i]);
+        case LibraryColumn::category:    return columns.categoryNames[columns.category[i]];
+        case LibraryColumn::date:        return juce::Time ((juce::int64) ((double) columns.date[i] * 86400000.0)).formatted ("%Y-%m-%d");
+        case LibraryColumn::loudness:
+            return std::isnan (columns.loudness[i]) ? juce::String ("-") : juce::String (columns.loudness[i], 1) + " LUFS";
+        case LibraryColumn::numColumns:
+        default:                         return {};
+    }
+}
+
+//==============================================================================
+namespace
+{
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+        double z1 = 0.0, z2 = 0.0;
+
+        double process (double x) noexcept
+        {
+            const double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    // The two K-weighting stages of BS.1770 for any sample rate (pre-filter shelf, then RLB high-pass).
+    void makeKWeighting (double sampleRate, Biquad& shelf, Biquad& highPass)
+    {
+        {
+            const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+            const double k = std::tan (juce::MathConstants<double>::pi * f0 / sampleRate);
+            const double vh = std::pow (10.0, gainDb / 20.0);
+            const double vb = std::pow (vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+
+            shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                      2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+
+        {
+            const double f0 = 38.13547087602444, q = 0.5003270373238773;
+            const double k = std::tan (juce::MathConstants<double>::pi * f0 / sampleRate);
+            const double a0 = 1.0 + k / q + k * k;
+
+            highPass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+    }
+}
+
+float LibraryColumns::measureLoudness (juce::AudioFormatReader& reader, std::vector<juce::uint32>* transients)
+{
+    if (reader.sampleRate <= 0.0 || reader.lengthInSamples <= 0)
+        return std::numeric_limits<float>::quiet_NaN();
+
+    const int numChannels = juce::jlimit (1, 2, (int) reader.numChannels);
+    const int stepLength = juce::jmax (1, juce::roundToInt (reader.sampleRate * 0.1));   // 100 ms
+
+    Biquad shelf[2], highPass[2];
+    for (int ch = 0; ch < numChannels; ++ch)
+        makeKWeighting (reader.sampleRate, shelf[ch], highPass[ch]);
+
+    // Energy of every 100 ms step; a 400 ms gating block is four consecutive steps.
+    std::vector<double> steps;
+    double stepEnergy = 0.0, totalEnergy = 0.0;
+    int stepFill = 0;
+
+    // Onsets: a hop at least 9 dB above the mean of the 80 ms before it, above -50 dB, 50 ms apart.
+    constexpr int historyLength = 8, minimumGap = 5;
+    constexpr double rise = 8.0, minimumEnergy = 1.0e-5;
+    const int hopLength = juce::jmax (1, juce::roundToInt (reader.sampleRate * transientHopSeconds));
+    double history[historyLength] {}, historySum = 0.0, hopEnergy = 0.0;
+    int hopFill = 0, hop = 0, lastOnset = -minimumGap;
+
+    juce::AudioBuffer<float> buffer (numChannels, 65536);
+
+    for (juce::int64 pos = 0; pos < reader.lengthInSamples; pos += buffer.getNumSamples())
+    {
+        const int n = (int) juce::jmin ((juce::int64) buffer.getNumSamples(), reader.lengthInSamples - pos);
+        reader.read (&buffer, 0, n, pos, true, numChannels > 1);
+
+        for (int i = 0; i < n; ++i)
+        {
+            double sum = 0.0;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const double y = highPass[ch].process (shelf[ch].process (buffer.getSample (ch, i)));
+                sum += y * y;
+            }
+
+            stepEnergy += sum;
+            totalEnergy += sum;
+
+            if (transients != nullptr)
+            {
+                hopEnergy += sum;
+
+                if (++hopFill == hopLength)
+                {
+                    const double mean = hopEnergy / hopLength;
+                    const double before = historySum / juce::jmax (1, juce::jmin (hop, historyLength));
+
+                    if (hop > 0 && mean > minimumEnergy && mean > rise * before && hop - lastOnset >= minimumGap
+                         && pos + i + 1 - hopLength <= (juce::int64) std::numeric_limits<juce::uint32>::max())
+                    {
+                        transients->push_back ((juce::uint32) (pos + i + 1 - hopLength));
+                        lastOnset = hop;
+                    }
+
+                    auto& oldest = history[hop % historyLength];
+                    historySum += mean - oldest;
+                    oldest = mean;
+
+                    hopEnergy = 0.0;
+                    hopFill = 0;
+                    ++hop;
+                }
+            }
+
+            if (++stepFill == stepLength)
+            {
+                steps.push_back (stepEnergy);
+                stepEnergy = 0.0;
+                stepFill = 0;
+            }
+        }
+    }
+
+    auto toLufs = [] (double meanSquare) { return -0.691 + 10.0 * std::log10 (meanSquare); };
+
+    // Shorter than one gating block: ungated mean over the whole file
+    if (steps.size() < 4)
+        return totalEnergy > 0.0 ? (float) toLufs (totalEnergy / (double) reader.lengthInSamples) : -std::numeric_limits<float>::infinity();
+
+    std::vector<double> blocks;
+    blocks.reserve (steps.size() - 3);
+
+    for (size_t i = 3; i < steps.size(); ++i)
+        blocks.push_back ((steps[i - 3] + steps[i - 2] + steps[i - 1] + steps[i]) / (4.0 * stepLength));
+
+    auto gatedMean = [&blocks, &toLufs] (double thresholdLufs)
+    {
+        double sum = 0.0;
+        int count = 0;
+
+        for (auto z : blocks)
+            if (z > 0.0 && toLufs (z) > thresholdLufs)
+            {
+                sum += z;
+                ++count;
+            }
+
+        return count > 0 ? sum / count : 0.0;
+    };
+
+    const double absoluteGated = gatedMean (-70.0);
+
+    if (absoluteGated <= 0.0)
+        return -std::numeric_limits<float>::infinity();
+
+    const double relativeGated = gatedMean (toLufs (absoluteGated) - 10.0);
+    return relativeGated > 0.0 ? (float) toLufs (relativeGated) : -std::numeric_limits<float>::infinity();
+}
+
+//==============================================================================
+namespace
+{
+    bool findColumn (const juce::String& name, LibraryColumn& column)
+    {
+        static const std::pair<const char*, LibraryColumn> aliases[] =
+        {
+            { "duration", LibraryColumn::duration }, { "length", LibraryColumn::duration }, { "dur", LibraryColumn::duration },
+            { "samplerate", LibraryColumn::sampleRate }, { "rate", LibraryColumn::sampleRate }, { "sr", LibraryColumn::sampleRate },
+            { "channels", LibraryColumn::channels }, { "ch", LibraryColumn::channels },
+            { "loudness", LibraryColumn::loudness }, { "lufs", LibraryColumn::loudness },
+            { "date", LibraryColumn::date }, { "modified", LibraryColumn::date }
+        };
+
+        for (auto& alias : aliases)
+            if (name.equalsIgnoreCase (alias.first))
+            {
+                column = alias.second;
+                return true;
+            }
+
+        return false;
+    }
+
+    // "duration<2s", "loudness>=-20lufs", "rate=48khz", "date>2024-01-01"
+    bool parseRange (const juce::String& expression, LibraryQuery::Range& range)
+    {
+        const int opStart = expression.indexOfAnyOf ("<>=");
+
+        if (opStart <= 0 || ! findColumn (expression.substring (0, opStart), range.column))
+            return false;
+
+        int opEnd = opStart + 1;
+        if (expression[opEnd] == '=')
+            ++opEnd;
+
+        const auto op = expression.substring (opStart, opEnd);
+        const auto valueText = expression.substring (opEnd).trim();
+
+        if (valueText.isEmpty())
+            return false;
+
+        double value;
+
+        if (range.column == LibraryColumn::date)
+        {
+            auto time = juce::Time::fromISO8601 (valueText);
+
+            if (time.toMilliseconds() == 0)
+                return false;
+
+            value = (double) time.toMilliseconds() / 86400000.0;
+        }
+        else
+        {
+            const auto number = valueText.initialSectionContainingOnly ("+-0123456789.");
+            const auto unit = valueText.substring (number.length()).trim().toLowerCase();
+
+            if (number.isEmpty() || ! number.containsAnyOf ("0123456789"))
+                return false;
+
+            value = number.getDoubleValue();
+
+            if (unit == "ms")                                   value /= 1000.0;
+            else if (unit == "khz")                             value *= 1000.0;
+            else if (unit.isNotEmpty() && ! juce::StringArray { "s", "sec", "hz", "lufs", "lu", "db" }.contains (unit))
+                return false;
+        }
+
+        const float v = (float) value;
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        if (op == "<")        range = { range.column, -infinity, std::nextafter (v, -infinity) };
+        else if (op == "<=")  range = { range.column, -infinity, v };
+        else if (op == ">")   range = { range.column, std::nextafter (v, infinity), infinity };
+        else if (op == ">=")  range = { range.column, v, infinity };
+        else if (op == "=")   range = { range.column, v, v };
+        else                  return false;
+
+        return true;
+    }
+
+    bool isUnitWord (const juce::String& token)
+    {
+        return juce::StringArray { "s", "sec", "ms", "hz", "khz", "lufs", "lu", "db" }.contains (token.toLowerCase());
+    }
+
+    // "tag:metal", "is:favourite", "rating:3", "-played"
+    bool parseFacet (const juce::String& token, LibraryQuery::Facet& facet)
+    {
+        auto word = token.toLowerCase();
+        facet.negated = word.startsWithChar ('-');
+
+        if (facet.negated)
+            word = word.substring (1);
+
+        if (word.startsWith ("is:"))
+            word = word.substring (3);
+
+        if (word.startsWith ("tag:") && word.length() > 4)
+        {
+            facet.kind = LibraryQuery::Facet::tag;
+            facet.tag = word.substring (4);
+            return true;
+        }
+
+        if (word.startsWith ("rating:") && word.substring (7).containsOnly ("012345") && word.length() > 7)
+        {
+            facet.kind = LibraryQuery::Facet::rating;
+            facet.minRating = juce::jlimit (1, 5, word.substring (7).getIntValue());
+            return true;
+        }
+
+        static const std::pair<const char*, LibraryQuery::Facet::Kind> keywords[] =
+        {
+            { "favourite", LibraryQuery::Facet::favourite }, { "favorite", LibraryQuery::Facet::favourite },
+            { "fav", LibraryQuery::Facet::favourite }, { "played", LibraryQuery::Facet::played },
+            { "used", LibraryQuery::Facet::used }, { "used-in-project", LibraryQuery::Facet::usedInProject }
+        };
+
+        for (auto& keyword : keywords)
+            if (word == keyword.first)
+            {
+                facet.kind = keyword.second;
+                return true;
+            }
+
+        return false;
+    }
+}
+
+LibraryQuery LibraryQuery::parse (const juce::String& searchText)
+{
+    LibraryQuery query;
+    juce::StringArray words;
+    auto tokens = juce::StringArray::fromTokens (searchText, " \t", "\"");
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens[i].equalsIgnoreCase ("and"))
+            continue;
+
+        Facet facet {};
+        const bool negate = tokens[i].equalsIgnoreCase ("not") && i + 1 < tokens.size();
+
+        if (parseFacet (tokens[negate ? i + 1 : i], facet))
+        {
+            facet.negated = facet.negated != negate;
+            query.facets.push_back (facet);
+            i += negate ? 1 : 0;
+            continue;
+        }
+
+        // The longest run of up to four tokens that reads as a range: "duration < 2 s"
+        Range range {};
+        int consumed = 0;
+        juce::String joined;
+
+        for (int n = 0; n < 4 && i + n < tokens.size(); ++n)
+        {
+            joined += tokens[i + n];
+            Range candidate {};
+
+            if (parseRange (joined, candidate))
+            {
+                range = candidate;
+                consumed = n + 1;
+            }
+        }
+
+        if (consumed == 0)
+        {
+            words.add (tokens[i]);
+            continue;
+        }
+
+        query.ranges.push_back (range);
+        i += consumed - 1;
+
+        if (i + 1 < tokens.size() && isUnitWord (tokens[i + 1]))
+            ++i;
+    }
+
+    query.text = words.joinIntoString (" ");
+    return query;
+}
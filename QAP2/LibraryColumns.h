@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    LibraryColumns.h
+    Per-file metadata of a LibraryIndex stored column by column (structure
+    of arrays), with one precomputed sort permutation per column, and the
+    query that filters, range-checks and sorts over them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+struct LibraryIndex;
+
+enum class LibraryColumn
+{
+    name,
+    duration,       // seconds
+    sampleRate,     // Hz
+    channels,
+    loudness,       // integrated LUFS, NaN until analysed
+    category,       // first folder below the library root
+    date,           // modification time, days since 1970
+    numColumns
+};
+
+static constexpr int numLibraryColumns = (int) LibraryColumn::numColumns;
+
+//==============================================================================
+// What the file list shows: text match, numeric ranges and facets (all must hold) and sort keys.
+struct LibraryQuery
+{
+    struct Range
+    {
+        LibraryColumn column;
+        float minValue, maxValue;       // inclusive; NaN values never match
+    };
+
+    // A LibraryDatabase facet: "tag:metal", "favourite", "played", "used", "used-in-project",
+    // "rating:3" (at least 3 stars), each optionally preceded by NOT.
+    struct Facet
+    {
+        enum Kind { tag, favourite, played, used, usedInProject, rating };
+
+        Kind kind;
+        juce::String tag;               // lower case, for `tag`
+        int minRating = 0;              // for `rating`
+        bool negated = false;
+    };
+
+    struct SortKey
+    {
+        LibraryColumn column;
+        bool ascending;
+    };
+
+    juce::String text;
+    std::vector<Range> ranges;
+    std::vector<Facet> facets;
+    juce::String project;               // whose "used-in-project" it is; set by the caller, not parsed
+    std::vector<SortKey> sortKeys;      // most significant first; empty: best text match first, else index order
+
+    // Splits search bar text such as "thunder duration < 2 s AND loudness > -20 LUFS AND NOT played"
+    // into the name text, the ranges and the facets. Sort keys are left empty.
+    static LibraryQuery parse (const juce::String& searchText);
+};
+
+//==============================================================================
+struct LibraryColumns
+{
+    // Indexed by file ID. Numeric columns are all float so one predicate loop serves them all.
+    std::vector<float> duration, sampleRate, channels, loudness, date;
+    std::vector<juce::uint16> category;     // index into categoryNames
+    juce::StringArray categoryNames;
+
+    // Transient jump points in sample frames, back to back: file i's are
+    // [transientOffsets[i], transientOffsets[i + 1]). Filled by the loudness analysis.
+    std::vector<juce::uint32> transients, transientOffsets { 0 };
+    std::vector<juce::uint32> getTransients (int id) const;
+
+    // File IDs in ascending order of each column, ties in ID order.
+    std::vector<int> order[numLibraryColumns];
+
+    const std::vector<float>* getValues (LibraryColumn column) const noexcept;
+
+    // Reads duration, rate and channels from the file header; category and date from the path.
+    void addFile (const juce::File& file, const juce::File& root, juce::AudioFormatManager* formats);
+
+    // Appends entry `id` of `source`. Category indices are copied as they are, so categoryNames
+    // must start with the source's names.
+    void addFrom (const LibraryColumns& source, int id);
+
+    void buildOrder (LibraryColumn column, const LibraryIndex& index);
+    void buildOrders (const LibraryIndex& index);
+
+    // Clears keep[id] for every file whose value lies outside the range. Branch-free, so the
+    // compiler turns it into a SIMD compare-and-mask over the column.
+    void applyRange (LibraryColumn column, float minValue, float maxValue, std::vector<juce::uint8>& keep) const noexcept;
+
+    // IDs with keep[id] set, ordered by the sort keys (most significant first): the least
+    // significant key walks its precomputed permutation, each further key is a stable
+    // counting sort on dense ranks, so the cost stays linear in the number of files.
+    std::vector<int> sortRows (const std::vector<juce::uint8>& keep, const std::vector<LibraryQuery::SortKey>& keys,
+                               const LibraryIndex& index) const;
+
+    static juce::String getColumnName (LibraryColumn column);
+    static juce::String formatValue (LibraryColumn column, const LibraryIndex& index, int id);
+
+    // Integrated loudness (ITU-R BS.1770, K-weighted and gated) of the whole file, NaN if unreadable.
+    // With `transients`, the same pass also appends the onsets: the start of every 10 ms hop whose
+    // K-weighted energy jumps well above the hops before it.
+    static float measureLoudness (juce::AudioFormatReader& reader, std::vector<juce::uint32>* transients = nullptr);
+
+    static constexpr double transientHopSeconds = 0.01;
+
+private:
+    bool isSameValue (LibraryColumn column, const LibraryIndex& index, int a, int b) const noexcept;
+    bool isUnknown (LibraryColumn column, int id) const noexcept;
+    int computeRanks (LibraryColumn column, const LibraryIndex& index, std::vector<juce::uint32>& ranks) const;
+};
@@ -0,0 +1,614 @@
+/*
+  ==============================================================================
+
+    LibraryDatabase.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryDatabase.h"
+#include "LibraryService.h"
+
+namespace
+{
+    constexpr juce::int32 fileMagic = 0x44504151;   // "QAPD"
+    constexpr juce::uint8 fileVersion = 1;
+
+    void setBit (LibraryFacets::Bitmap& bitmap, int id) noexcept
+    {
+        bitmap[(size_t) (id >> 6)] |= (juce::uint64) 1 << (id & 63);
+    }
+
+    void writeStrings (juce::OutputStream& out, const juce::StringArray& strings)
+    {
+        out.writeShort ((short) juce::jmin (strings.size(), 0xffff));
+
+        for (int i = 0; i < juce::jmin (strings.size(), 0xffff); ++i)
+            out.writeString (strings[i]);
+    }
+
+    juce::StringArray readStrings (juce::InputStream& in)
+    {
+        juce::StringArray strings;
+
+        for (int n = (juce::uint16) in.readShort(); n > 0 && ! in.isExhausted(); --n)
+            strings.add (in.readString());
+
+        return strings;
+    }
+
+    std::map<juce::String, LibraryDatabase::Record> readRecords (const juce::File& file)
+    {
+        std::map<juce::String, LibraryDatabase::Record> records;
+        auto in = file.createInputStream();
+
+        if (in == nullptr || in->getNumBytesRemaining() < 9 || in->readInt() != fileMagic || (juce::uint8) in->readByte() != fileVersion)
+            return records;
+
+        const auto numRecords = in->readInt();
+
+        for (int i = 0; i < numRecords && ! in->isExhausted(); ++i)
+        {
+            auto path = in->readString();
+            LibraryDatabase::Record record;
+            record.favourite = in->readBool();
+            record.rating = juce::jlimit (0, 5, (int) in->readByte());
+            record.playCount = juce::jmax (0, in->readInt());
+            record.lastPlayed = in->readInt64();
+            record.tags = readStrings (*in);
+            record.projects = readStrings (*in);
+
+            if (juce::File::isAbsolutePath (path) && ! record.isEmpty())
+                records[path] = std::move (record);
+        }
+
+        return records;
+    }
+}
+
+//==============================================================================
+void LibraryFacets::apply (const LibraryQuery& query, std::vector<juce::uint8>& keep) const
+{
+    if (query.facets.empty())
+        return;
+
+    const auto numWords = (keep.size() + 63) / 64;
+    Bitmap result (numWords, ~(juce::uint64) 0);
+
+    auto lookup = [] (const std::map<juce::String, SharedBitmap>& bitmaps, const juce::String& key) -> const Bitmap*
+    {
+        auto found = bitmaps.find (key);
+        return found != bitmaps.end() ? found->second.get() : nullptr;
+    };
+
+    for (auto& facet : query.facets)
+    {
+        const Bitmap* bits = nullptr;
+
+        switch (facet.kind)
+        {
+            case LibraryQuery::Facet::tag:              bits = lookup (tags, facet.tag); break;
+            case LibraryQuery::Facet::favourite:        bits = favourites.get(); break;
+            case LibraryQuery::Facet::played:           bits = played.get(); break;
+            case LibraryQuery::Facet::used:             bits = used.get(); break;
+            case LibraryQuery::Facet::usedInProject:    bits = lookup (projects, query.project); break;
+            case LibraryQuery::Facet::rating:           bits = ratings[juce::jlimit (1, 5, facet.minRating) - 1].get(); break;
+        }
+
+        // A missing bitmap (no such tag, nothing set) is all zeros.
+        for (size_t w = 0; w < numWords; ++w)
+        {
+            const auto word = bits != nullptr && w < bits->size() ? (*bits)[w] : 0;
+            result[w] &= facet.negated ? ~word : word;
+        }
+    }
+
+    for (size_t id = 0; id < keep.size(); ++id)
+        keep[id] &= (juce::uint8) ((result[id >> 6] >> (id & 63)) & 1);
+}
+
+//==============================================================================
+LibraryDatabase::LibraryDatabase (const juce::File& databaseFile)
+    : juce::Thread ("QAP library database"),
+      file (databaseFile)
+{
+    load();
+    startThread (juce::Thread::Priority::low);
+}
+
+LibraryDatabase::~LibraryDatabase()
+{
+    stopThread (10000);
+    applyQueued();
+
+    if (unsaved)
+        save();
+}
+
+juce::File LibraryDatabase::getDefaultFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("QAP")
+               .getChildFile ("LibraryDatabase.qapdb");
+}
+
+//==============================================================================
+void LibraryDatabase::queue (Change change)
+{
+    if (! juce::File::isAbsolutePath (change.path))
+        return;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (queueLock);
+        queued.push_back (std::move (change));
+    }
+
+    notify();
+}
+
+void LibraryDatabase::notePlayed (const juce::File& target)
+{
+    queue ({ Change::played, target.getFullPathName(), {} });
+}
+
+void LibraryDatabase::noteUsed (const juce::File& target, const juce::String& project)
+{
+    if (project.isNotEmpty())
+        queue ({ Change::used, target.getFullPathName(), project });
+}
+
+void LibraryDatabase::setFavourite (const juce::File& target, bool isFavourite)
+{
+    queue ({ Change::favourite, target.getFullPathName(), {}, isFavourite ? 1 : 0 });
+}
+
+void LibraryDatabase::setRating (const juce::File& target, int stars)
+{
+    queue ({ Change::rating, target.getFullPathName(), {}, juce::jlimit (0, 5, stars) });
+}
+
+void LibraryDatabase::setTag (const juce::File& target, const juce::String& tag, bool shouldHave)
+{
+    // Tags are single words in the search bar, "tag:metal".
+    auto word = tag.trim().toLowerCase().replaceCharacters (" \t", "--");
+
+    if (word.isNotEmpty())
+        queue ({ shouldHave ? Change::addTag : Change::removeTag, target.getFullPathName(), word });
+}
+
+LibraryDatabase::Record LibraryDatabase::getRecord (const juce::File& target) const
+{
+    const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+    auto found = records.find (target.getFullPathName());
+    return found != records.end() ? found->second : Record();
+}
+
+juce::StringArray LibraryDatabase::getTagNames() const
+{
+    juce::StringArray names;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+
+        for (auto& entry : records)
+            names.addArray (entry.second.tags);
+    }
+
+    names.removeDuplicates (false);
+    names.sort (true);
+    return names;
+}
+
+//==============================================================================
+void LibraryDatabase::run()
+{
+    while (! threadShouldExit())
+    {
+        if (applyQueued())
+            sendChangeMessage();
+
+        bool saveDue, pending;
+
+        {
+            const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+            pending = unsaved;
+            saveDue = unsaved && juce::Time::getMillisecondCounter() - lastChangeMs >= (juce::uint32) saveDelayMs;
+        }
+
+        // Saved once the changes settle, not on every click.
+        if (saveDue)
+            save();
+
+        wait (pending && ! saveDue ? saveDelayMs / 4 : -1);
+    }
+}
+
+bool LibraryDatabase::applyQueued()
+{
+    std::vector<Change> changes;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (queueLock);
+        changes.swap (queued);
+    }
+
+    if (changes.empty())
+        return false;
+
+    const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+    juce::StringArray changedPaths;
+
+    for (auto& change : changes)
+    {
+        if (apply (change))
+            changedPaths.addIfNotAlreadyThere (change.path);
+
+        unsavedPaths[change.path] += change.type == Change::played ? 1 : 0;
+    }
+
+    unsaved = true;
+    lastChangeMs = juce::Time::getMillisecondCounter();
+
+    if (changedPaths.isEmpty())
+        return false;
+
+    updateFacets (changedPaths);
+    return true;
+}
+
+bool LibraryDatabase::apply (const Change& change)
+{
+    auto& record = records[change.path];
+    bool facetsChanged = false;
+
+    switch (change.type)
+    {
+        case Change::played:
+            facetsChanged = record.playCount == 0;
+            ++record.playCount;
+            record.lastPlayed = juce::Time::currentTimeMillis();
+            break;
+
+        case Change::used:
+            facetsChanged = record.projects.addIfNotAlreadyThere (change.text);
+            break;
+
+        case Change::favourite:
+            facetsChanged = record.favourite != (change.value != 0);
+            record.favourite = change.value != 0;
+            break;
+
+        case Change::rating:
+            facetsChanged = record.rating != change.value;
+            record.rating = change.value;
+            break;
+
+        case Change::addTag:
+            facetsChanged = record.tags.addIfNotAlreadyThere (change.text);
+            break;
+
+        case Change::removeTag:
+            facetsChanged = record.tags.contains (change.text);
+            record.tags.removeString (change.text);
+            break;
+    }
+
+    if (record.isEmpty())
+        records.erase (change.path);
+
+    return facetsChanged;
+}
+
+//==============================================================================
+std::shared_ptr<const LibraryFacets> LibraryDatabase::getFacets (const std::shared_ptr<const LibraryIndex>& index)
+{
+    if (index == nullptr)
+        return {};
+
+    const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+
+    entries.erase (std::remove_if (entries.begin(), entries.end(), [] (const IndexEntry& entry) { return entry.index.expired(); }),
+                   entries.end());
+
+    auto entry = std::find_if (entries.begin(), entries.end(), [&index] (const IndexEntry& e) { return e.index.lock() == index; });
+
+    if (entry == entries.end())
+    {
+        entries.push_back ({});
+        entry = entries.end() - 1;
+        entry->index = index;
+    }
+
+    if (entry->facets == nullptr || entry->generation != generation)
+    {
+        entry->facets = buildFacets (*entry, *index);
+        entry->generation = generation;
+    }
+
+    return entry->facets;
+}
+
+void LibraryDatabase::updateFacets (const juce::StringArray& changedPaths)
+{
+    const auto previous = generation++;
+
+    for (auto& entry : entries)
+    {
+        if (auto index = entry.index.lock())
+        {
+            // Facets already at the previous generation only need the changed files' bits.
+            entry.facets = entry.facets != nullptr && entry.generation == previous ? patchFacets (entry, *index, changedPaths)
+                                                                                    : buildFacets (entry, *index);
+            entry.generation = generation;
+        }
+    }
+}
+
+void LibraryDatabase::resolveIds (IndexEntry& entry, const LibraryIndex& index, const juce::StringArray& paths)
+{
+    // Records are matched to file IDs once per index, all new ones in a single pass over its paths.
+    juce::Array<juce::File> unresolved;
+
+    for (auto& path : paths)
+        if (entry.ids.count (path) == 0)
+            unresolved.add (juce::File (path));
+
+    if (! unresolved.isEmpty())
+    {
+        auto ids = index.paths.indexOf (unresolved);
+
+        for (int i = 0; i < unresolved.size(); ++i)
+            entry.ids[unresolved.getReference (i).getFullPathName()] = ids[(size_t) i];
+    }
+}
+
+std::shared_ptr<const LibraryFacets> LibraryDatabase::buildFacets (IndexEntry& entry, const LibraryIndex& index)
+{
+    juce::StringArray paths;
+
+    for (auto& record : records)
+        paths.add (record.first);
+
+    resolveIds (entry, index, paths);
+
+    const auto numWords = ((size_t) index.size() + 63) / 64;
+    std::shared_ptr<LibraryFacets::Bitmap> favourites, played, used, ratings[5];
+    std::map<juce::String, std::shared_ptr<LibraryFacets::Bitmap>> tags, projects;
+
+    auto setIn = [numWords] (std::shared_ptr<LibraryFacets::Bitmap>& bitmap, int id)
+    {
+        if (bitmap == nullptr)
+            bitmap = std::make_shared<LibraryFacets::Bitmap> (numWords, 0);
+
+        setBit (*bitmap, id);
+    };
+
+    for (auto& item : records)
+    {
+        auto& record = item.second;
+        auto found = entry.ids.find (item.first);
+        const int id = found != entry.ids.end() ? found->second : -1;
+
+        if (! juce::isPositiveAndBelow (id, index.size()))
+            continue;
+
+        if (record.favourite)               setIn (favourites, id);
+        if (record.playCount > 0)           setIn (played, id);
+        if (! record.projects.isEmpty())    setIn (used, id);
+
+        for (int stars = 0; stars < record.rating; ++stars)
+            setIn (ratings[stars], id);
+
+        for (auto& tag : record.tags)
+            setIn (tags[tag], id);
+
+        for (auto& project : record.projects)
+            setIn (projects[project], id);
+    }
+
+    auto facets = std::make_shared<LibraryFacets>();
+    facets->numFiles = index.size();
+    facets->favourites = favourites;
+    facets->played = played;
+    facets->used = used;
+
+    for (int stars = 0; stars < 5; ++stars)
+        facets->ratings[stars] = ratings[stars];
+
+    for (auto& item : tags)
+        facets->tags[item.first] = item.second;
+
+    for (auto& item : projects)
+        facets->projects[item.first] = item.second;
+
+    return facets;
+}
+
+std::shared_ptr<const LibraryFacets> LibraryDatabase::patchFacets (IndexEntry& entry, const LibraryIndex& index,
+                                                                   const juce::StringArray& changedPaths)
+{
+    resolveIds (entry, index, changedPaths);
+
+    // A copy shares every bitmap with the previous facets; only a bitmap whose bit flips is copied.
+    auto facets = std::make_shared<LibraryFacets> (*entry.facets);
+    const auto numWords = ((size_t) index.size() + 63) / 64;
+
+    auto assign = [numWords] (LibraryFacets::SharedBitmap& bitmap, int id, bool value)
+    {
+        if (LibraryFacets::test (bitmap, id) == value)
+            return;
+
+        auto copy = bitmap != nullptr ? std::make_shared<LibraryFacets::Bitmap> (*bitmap)
+                                      : std::make_shared<LibraryFacets::Bitmap> (numWords, 0);
+        (*copy)[(size_t) (id >> 6)] ^= (juce::uint64) 1 << (id & 63);
+        bitmap = std::move (copy);
+    };
+
+    const Record none;
+
+    for (auto& path : changedPaths)
+    {
+        const int id = entry.ids[path];
+
+        if (! juce::isPositiveAndBelow (id, index.size()))
+            continue;
+
+        auto found = records.find (path);
+        const auto& record = found != records.end() ? found->second : none;
+
+        assign (facets->favourites, id, record.favourite);
+        assign (facets->played, id, record.playCount > 0);
+        assign (facets->used, id, ! record.projects.isEmpty());
+
+        for (int stars = 0; stars < 5; ++stars)
+            assign (facets->ratings[stars], id, stars < record.rating);
+
+        for (auto& item : facets->tags)
+            assign (item.second, id, record.tags.contains (item.first));
+
+        for (auto& tag : record.tags)
+            assign (facets->tags[tag], id, true);
+
+        for (auto& item : facets->projects)
+            assign (item.second, id, record.projects.contains (item.first));
+
+        for (auto& project : record.projects)
+            assign (facets->projects[project], id, true);
+    }
+
+    return facets;
+}
+
+//==============================================================================
+void LibraryDatabase::flush()
+{
+    if (applyQueued())
+        sendChangeMessage();
+
+    save();
+}
+
+void LibraryDatabase::load()
+{
+    const juce::InterProcessLock::ScopedLockType processLock (fileLock);
+    records = readRecords (file);
+    fileTime = file.getLastModificationTime();
+}
+
+void LibraryDatabase::merge (std::map<juce::String, Record> onDisk)
+{
+    // Another process saved since we last read the file. Our unsaved records win, with the
+    // plays made here added to its counts; everything else is taken from disk.
+    for (auto& item : onDisk)
+    {
+        auto ours = unsavedPaths.find (item.first);
+
+        if (ours == unsavedPaths.end())
+            continue;
+
+        auto local = records.find (item.first);
+
+        if (local != records.end())
+        {
+            local->second.playCount = item.second.playCount + ours->second;
+            local->second.lastPlayed = juce::jmax (local->second.lastPlayed, item.second.lastPlayed);
+            item.second = local->second;
+        }
+        else
+        {
+            item.second = {};   // removed here
+        }
+    }
+
+    for (auto& item : records)
+        if (unsavedPaths.count (item.first) != 0 && onDisk.count (item.first) == 0)
+            onDisk[item.first] = item.second;
+
+    for (auto item = onDisk.begin(); item != onDisk.end();)
+        item = item->second.isEmpty() ? onDisk.erase (item) : std::next (item);
+
+    records = std::move (onDisk);
+
+    // The other process may have changed anything, so the facets are rebuilt from scratch.
+    ++generation;
+
+    for (auto& entry : entries)
+        if (auto index = entry.index.lock())
+            entry.facets = buildFacets (entry, *index);
+
+    for (auto& entry : entries)
+        entry.generation = generation;
+}
+
+bool LibraryDatabase::save()
+{
+    const juce::InterProcessLock::ScopedLockType processLock (fileLock);
+
+    const auto diskTime = file.getLastModificationTime();
+    std::map<juce::String, Record> onDisk;
+    const bool diskChanged = diskTime != fileTime && file.existsAsFile();
+
+    if (diskChanged)
+        onDisk = readRecords (file);
+
+    juce::MemoryOutputStream data;
+    std::map<juce::String, int> saving;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+
+        if (diskChanged)
+            merge (std::move (onDisk));
+
+        data.writeInt (fileMagic);
+        data.writeByte ((char) fileVersion);
+        data.writeInt ((int) records.size());
+
+        for (auto& item : records)
+        {
+            auto& record = item.second;
+            data.writeString (item.first);
+            data.writeBool (record.favourite);
+            data.writeByte ((char) record.rating);
+            data.writeInt (record.playCount);
+            data.writeInt64 (record.lastPlayed);
+            writeStrings (data, record.tags);
+            writeStrings (data, record.projects);
+        }
+
+        saving.swap (unsavedPaths);
+        unsaved = false;
+    }
+
+    if (diskChanged)
+        sendChangeMessage();
+
+    // Written next to the target and renamed over it, as the preset bank is.
+    file.getParentDirectory().createDirectory();
+    juce::TemporaryFile temp (file);
+
+    if (auto out = temp.getFile().createOutputStream())
+    {
+        out->write (data.getData(), data.getDataSize());
+        out->flush();
+
+        if (out->getStatus().wasOk())
+        {
+            out.reset();
+
+            if (temp.overwriteTargetFileWithTemporary())
+            {
+                fileTime = file.getLastModificationTime();
+                return true;
+            }
+        }
+    }
+
+    const RealtimeCheckedLock::ScopedLockType sl (recordLock);
+    unsaved = true;     // retried after the next change
+
+    for (auto& item : saving)
+        unsavedPaths[item.first] += item.second;
+
+    return false;
+}
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    LibraryDatabase.h
+    What the user has told us about library files, kept between sessions:
+    tags, favourites, ratings, play counts and the projects a file was
+    dragged into. Changes are queued from any thread and applied on the
+    database's own thread, which patches the facets of the files they touch
+    and saves the file once they settle. Queries read LibraryFacets, one
+    bitmap per facet over the IDs of an index, so combining them costs a few
+    word operations per 64 files however many files are tagged.
+
+    Records are keyed by full path: a file moved or renamed outside QAP
+    starts again with an empty record. Several processes can share the file.
+    A save merges what is on disk under an inter-process lock: records this
+    process changed win, play counts add up, and the rest is taken from disk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LibraryColumns.h"
+#include "PerformanceMonitor.h"
+#include <map>
+#include <memory>
+
+struct LibraryIndex;
+
+//==============================================================================
+// Immutable facet bitmaps of one LibraryIndex, bit `id` for file ID `id`. The bitmaps are
+// shared between generations, a change copies only the ones whose bits it flips.
+struct LibraryFacets
+{
+    using Bitmap = std::vector<juce::uint64>;
+    using SharedBitmap = std::shared_ptr<const Bitmap>;     // nullptr for all zeros
+
+    int numFiles = 0;
+    SharedBitmap favourites, played, used;
+    SharedBitmap ratings[5];                        // ratings[n]: rated n + 1 stars or more
+    std::map<juce::String, SharedBitmap> tags;      // by lower-case tag
+    std::map<juce::String, SharedBitmap> projects;  // dragged into a project, by project ID
+
+    static bool test (const SharedBitmap& bitmap, int id) noexcept
+    {
+        return bitmap != nullptr && (size_t) (id >> 6) < bitmap->size() && (((*bitmap)[(size_t) (id >> 6)] >> (id & 63)) & 1) != 0;
+    }
+
+    bool isFavourite (int id) const noexcept    { return test (favourites, id); }
+
+    // Clears keep[id] for every file the query's facets rule out: the facets are combined word
+    // by word first, then expanded once.
+    void apply (const LibraryQuery& query, std::vector<juce::uint8>& keep) const;
+};
+
+//==============================================================================
+class LibraryDatabase  : public juce::ChangeBroadcaster,
+                         private juce::Thread
+{
+public:
+    explicit LibraryDatabase (const juce::File& file = getDefaultFile());
+    ~LibraryDatabase() override;
+
+    static juce::File getDefaultFile();
+
+    struct Record
+    {
+        juce::StringArray tags;                 // lower case
+        bool favourite = false;
+        int rating = 0;                         // stars, 0 for none
+        int playCount = 0;
+        juce::int64 lastPlayed = 0;             // ms since 1970
+        juce::StringArray projects;             // IDs of the projects it was dragged into
+
+        bool isEmpty() const noexcept   { return tags.isEmpty() && ! favourite && rating == 0 && playCount == 0 && projects.isEmpty(); }
+    };
+
+    //==============================================================================
+    // Any thread, never waits for the database thread.
+    void notePlayed (const juce::File& file);
+    void noteUsed (const juce::File& file, const juce::String& project);
+    void setFavourite (const juce::File& file, bool isFavourite);
+    void setRating (const juce::File& file, int stars);
+    void setTag (const juce::File& file, const juce::String& tag, bool shouldHave);
+
+    // As of the last change applied.
+    Record getRecord (const juce::File& file) const;
+    juce::StringArray getTagNames() const;
+
+    // Facets of `index`, built when it is first seen and patched by the database thread when a
+    // change alters them. Listeners are told when they are; a repeated play changes no facet.
+    std::shared_ptr<const LibraryFacets> getFacets (const std::shared_ptr<const LibraryIndex>& index);
+
+    // Applies the queued changes and saves (merging with the file) now. For tests and tools.
+    void flush();
+
+    static constexpr int saveDelayMs = 2000;
+
+private:
+    struct Change
+    {
+        enum Type { played, used, favourite, rating, addTag, removeTag };
+
+        Type type;
+        juce::String path, text;
+        int value = 0;
+    };
+
+    struct IndexEntry
+    {
+        std::weak_ptr<const LibraryIndex> index;
+        std::map<juce::String, int> ids;        // record path -> file ID in the index, -1 if absent
+        std::shared_ptr<const LibraryFacets> facets;
+        juce::uint64 generation = 0;
+    };
+
+    void run() override;
+    void queue (Change change);
+    bool applyQueued();                         // true if the facets changed
+    bool apply (const Change& change);          // under recordLock, true if the record's facets changed
+    void updateFacets (const juce::StringArray& changedPaths);                                           // under recordLock
+    void resolveIds (IndexEntry& entry, const LibraryIndex& index, const juce::StringArray& paths);     // under recordLock
+    std::shared_ptr<const LibraryFacets> buildFacets (IndexEntry& entry, const LibraryIndex& index);     // under recordLock
+    std::shared_ptr<const LibraryFacets> patchFacets (IndexEntry& entry, const LibraryIndex& index,
+                                                      const juce::StringArray& changedPaths);           // under recordLock
+    void load();
+    bool save();
+    void merge (std::map<juce::String, Record> onDisk);                                                  // under recordLock
+
+    const juce::File file;
+
+    RealtimeCheckedLock queueLock;
+    std::vector<Change> queued;
+
+    mutable RealtimeCheckedLock recordLock;
+    std::map<juce::String, Record> records;     // by full path
+    std::map<juce::String, int> unsavedPaths;   // changed since the last save -> plays since then
+    juce::uint64 generation = 1;
+    std::vector<IndexEntry> entries;
+    bool unsaved = false;
+    juce::uint32 lastChangeMs = 0;
+
+    juce::InterProcessLock fileLock { "QAPLibraryDatabase" };
+    juce::Time fileTime;                        // of the file as last read or written, database thread
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryDatabase)
+};
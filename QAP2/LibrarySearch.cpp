@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    LibrarySearch.cpp
+
+  ==============================================================================
+*/
+
+#include "LibrarySearch.h"
+#include "LibraryService.h"
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+    // BM25 as usual, and how much the other kinds of match count against a word in the name
+    constexpr float k1 = 1.2f, b = 0.75f;
+    constexpr float prefixWeight = 0.7f, oneEditWeight = 0.6f, twoEditsWeight = 0.4f;
+    constexpr float folderWeight = 0.5f;
+    constexpr float substringScore = 0.05f;
+
+    bool isNumber (const std::string& word)
+    {
+        return std::all_of (word.begin(), word.end(), [] (char c) { return c >= '0' && c <= '9'; });
+    }
+
+    // Counting sort of (term, item) pairs into per-term lists. The pairs come in item order, so
+    // each list is sorted and repeats are next to each other; `counts` gets how often each repeats.
+    void buildPostings (const std::vector<std::pair<juce::uint32, juce::uint32>>& pairs, size_t numTerms,
+                        std::vector<juce::uint32>& offsets, std::vector<juce::uint32>& postings,
+                        std::vector<juce::uint8>* counts)
+    {
+        std::vector<juce::uint32> starts (numTerms + 1, 0);
+
+        for (auto& pair : pairs)
+            ++starts[pair.first + 1];
+
+        std::partial_sum (starts.begin(), starts.end(), starts.begin());
+
+        std::vector<juce::uint32> sorted (pairs.size());
+        auto next = starts;
+
+        for (auto& pair : pairs)
+            sorted[next[pair.first]++] = pair.second;
+
+        offsets.assign (1, 0);
+        postings.clear();
+
+        for (size_t term = 0; term < numTerms; ++term)
+        {
+            for (auto i = starts[term]; i < starts[term + 1]; ++i)
+            {
+                const bool repeat = i > starts[term] && sorted[i] == sorted[i - 1];
+
+                if (repeat && counts != nullptr)
+                    counts->back() = (juce::uint8) juce::jmin (255, counts->back() + 1);
+                else if (! repeat)
+                {
+                    postings.push_back (sorted[i]);
+
+                    if (counts != nullptr)
+                        counts->push_back (1);
+                }
+            }
+
+            offsets.push_back ((juce::uint32) postings.size());
+        }
+    }
+}
+
+//==============================================================================
+void LibrarySearch::tokenize (std::string_view text, std::vector<std::string>& words)
+{
+    enum Kind { other, lower, upper, digit };
+
+    // Bytes of multi-byte UTF-8 characters count as lower-case letters.
+    auto kindOf = [] (unsigned char c)
+    {
+        if (c >= '0' && c <= '9')                   return digit;
+        if ((c >= 'a' && c <= 'z') || c >= 0x80)    return lower;
+        if (c >= 'A' && c <= 'Z')                   return upper;
+        return other;
+    };
+
+    words.clear();
+    std::string word;
+    Kind previous = other;
+
+    for (auto ch : text)
+    {
+        const auto c = (unsigned char) ch;
+        const auto kind = kindOf (c);
+        const bool split = kind == other
+                            || (previous != other && ((kind == digit) != (previous == digit) || (kind == upper && previous == lower)));
+
+        if (split && ! word.empty())
+        {
+            words.push_back (word);
+            word.clear();
+        }
+
+        if (kind != other)
+            word += (char) (kind == upper ? c + ('a' - 'A') : c);
+
+        previous = kind;
+    }
+
+    if (! word.empty())
+        words.push_back (word);
+}
+
+int LibrarySearch::getEditDistance (std::string_view a, std::string_view b) noexcept
+{
+    a = a.substr (0, maxTermLength);
+    b = b.substr (0, maxTermLength);
+
+    std::array<int, maxTermLength + 1> previous, current;
+
+    for (size_t j = 0; j <= b.size(); ++j)
+        previous[j] = (int) j;
+
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        current[0] = (int) i;
+
+        for (size_t j = 1; j <= b.size(); ++j)
+            current[j] = std::min ({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (a[i - 1] != b[j - 1] ? 1 : 0) });
+
+        std::swap (previous, current);
+    }
+
+    return previous[b.size()];
+}
+
+std::string_view LibrarySearch::getTerm (juce::uint32 term) const noexcept
+{
+    const auto start = termOffsets[term];
+    return { termArena.data() + start, termOffsets[term + 1] - start };
+}
+
+//==============================================================================
+void LibrarySearch::build (const LibraryIndex& index)
+{
+    *this = LibrarySearch();
+
+    const int numFiles = index.size();
+    auto& paths = index.paths;
+
+    std::unordered_map<std::string, juce::uint32> ids;
+    std::vector<std::string> terms, words;
+    std::vector<std::pair<juce::uint32, juce::uint32>> namePairs, folderPairs;     // (term, file or folder)
+
+    auto addWords = [&] (std::vector<std::pair<juce::uint32, juce::uint32>>& pairs, juce::uint32 item)
+    {
+        for (auto& word : words)
+        {
+            if (isNumber (word))
+                continue;
+
+            auto added = ids.emplace (word, (juce::uint32) terms.size());
+
+            if (added.second)
+                terms.push_back (word);
+
+            pairs.push_back ({ added.first->second, item });
+        }
+    };
+
+    // File names without their extension
+    nameLengths.resize ((size_t) numFiles);
+    size_t totalLength = 0;
+
+    for (int id = 0; id < numFiles; ++id)
+    {
+        auto name = index.getNameView (id);
+        const auto dot = name.rfind ('.');
+        tokenize (dot != std::string_view::npos && dot > 0 ? name.substr (0, dot) : name, words);
+
+        nameLengths[(size_t) id] = (juce::uint16) juce::jmin ((size_t) 0xffff, words.size());
+        totalLength += words.size();
+        addWords (namePairs, (juce::uint32) id);
+    }
+
+    averageNameLength = numFiles > 0 ? juce::jmax (1.0f, (float) totalLength / (float) numFiles) : 1.0f;
+
+    // Folder names below the root; the folders above it are shared by every file and say nothing.
+    const auto numFolders = (size_t) paths.getNumDirectories();
+    const int rootFolder = paths.findDirectory (index.root);
+    belowRoot.assign (numFolders, 0);
+
+    for (juce::uint32 d = 0; d < (juce::uint32) numFolders; ++d)
+    {
+        const auto parent = paths.getParent (d);
+
+        if (parent == PathStore::noParent || ((int) parent != rootFolder && belowRoot[parent] == 0))
+            continue;
+
+        belowRoot[d] = 1;
+        tokenize (paths.getSegment (d), words);
+        addWords (folderPairs, d);
+    }
+
+    // Sorted, so the words with a prefix are a range
+    std::vector<juce::uint32> order (terms.size());
+    std::iota (order.begin(), order.end(), 0u);
+    std::sort (order.begin(), order.end(), [&terms] (juce::uint32 x, juce::uint32 y) { return terms[x] < terms[y]; });
+
+    std::vector<juce::uint32> rankOf (terms.size());
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        rankOf[order[i]] = (juce::uint32) i;
+        auto& term = terms[order[i]];
+        termArena.insert (termArena.end(), term.begin(), term.end());
+        termOffsets.push_back ((juce::uint32) termArena.size());
+    }
+
+    for (auto* pairs : { &namePairs, &folderPairs })
+        for (auto& pair : *pairs)
+            pair.first = rankOf[pair.first];
+
+    buildPostings (namePairs, terms.size(), namePostingOffsets, namePostings, &nameCounts);
+    buildPostings (folderPairs, terms.size(), folderPostingOffsets, folderPostings, nullptr);
+
+    // Files below each folder, for the document frequency of folder words
+    std::vector<juce::uint32> filesBelow (numFolders, 0);
+
+    for (int id = 0; id < numFiles; ++id)
+        ++filesBelow[paths.getDirectory (id)];
+
+    for (auto d = numFolders; d-- > 0;)
+        if (paths.getParent ((juce::uint32) d) != PathStore::noParent)
+            filesBelow[paths.getParent ((juce::uint32) d)] += filesBelow[d];
+
+    documentFrequency.resize (terms.size());
+
+    for (size_t term = 0; term < terms.size(); ++term)
+    {
+        auto count = (juce::uint64) (namePostingOffsets[term + 1] - namePostingOffsets[term]);
+
+        for (auto i = folderPostingOffsets[term]; i < folderPostingOffsets[term + 1]; ++i)
+            count += filesBelow[folderPostings[i]];
+
+        documentFrequency[term] = (juce::uint32) juce::jmin ((juce::uint64) numFiles, count);
+    }
+
+    for (juce::uint32 term = 0; term < (juce::uint32) terms.size(); ++term)
+        if (getTerm (term).size() <= maxTermLength)
+            addToTree (term);
+}
+
+void LibrarySearch::addToTree (juce::uint32 term)
+{
+    if (tree.empty())
+    {
+        tree.push_back ({ term, none, none, 0 });
+        return;
+    }
+
+    for (juce::uint32 node = 0;;)
+    {
+        const int distance = getEditDistance (getTerm (term), getTerm (tree[node].term));
+
+        if (distance == 0)
+            return;
+
+        auto child = tree[node].firstChild;
+
+        while (child != none && tree[child].distance != distance)
+            child = tree[child].nextSibling;
+
+        if (child == none)
+        {
+            tree.push_back ({ term, none, tree[node].firstChild, distance });
+            tree[node].firstChild = (juce::uint32) tree.size() - 1;
+            return;
+        }
+
+        node = child;
+    }
+}
+
+void LibrarySearch::findTerms (std::string_view word, std::vector<Match>& matches) const
+{
+    matches.clear();
+
+    // The word itself and every word it starts
+    const auto numTerms = (juce::uint32) getNumTerms();
+    juce::uint32 low = 0, high = numTerms;
+
+    while (low < high)
+    {
+        const auto middle = (low + high) / 2;
+
+        if (getTerm (middle) < word)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    const auto first = low;
+    auto last = first;
+
+    for (; last < numTerms && getTerm (last).substr (0, word.size()) == word; ++last)
+        matches.push_back ({ last, getTerm (last).size() == word.size() ? 1.0f : prefixWeight });
+
+    // Words within a typo or two, found through the BK-tree: by the triangle inequality only the
+    // children whose distance to their parent is within maxEdits of ours can hold any.
+    const int maxEdits = getMaxEdits (word.size());
+
+    if (maxEdits == 0 || tree.empty())
+        return;
+
+    std::vector<juce::uint32> pending { 0 };
+
+    while (! pending.empty())
+    {
+        const auto& node = tree[pending.back()];
+        pending.pop_back();
+
+        const int distance = getEditDistance (word, getTerm (node.term));
+
+        if (distance > 0 && distance <= maxEdits && (node.term < first || node.term >= last))
+            matches.push_back ({ node.term, distance == 1 ? oneEditWeight : twoEditsWeight });
+
+        for (auto child = node.firstChild; child != none; child = tree[child].nextSibling)
+            if (std::abs (tree[child].distance - distance) <= maxEdits)
+                pending.push_back (child);
+    }
+}
+
+//==============================================================================
+std::vector<int> LibrarySearch::rank (const juce::String& text, const LibraryIndex& index, std::vector<juce::uint8>& keep,
+                                      size_t numRanked) const
+{
+    const int numFiles = index.size();
+    auto& paths = index.paths;
+
+    std::vector<std::string> words;
+    tokenize (std::string_view (text.toRawUTF8(), text.getNumBytesAsUTF8()), words);
+    std::sort (words.begin(), words.end());
+    words.erase (std::unique (words.begin(), words.end()), words.end());
+
+    // Only punctuation: what the names contain is all there is to go by.
+    if (words.empty())
+    {
+        const auto lower = text.toLowerCase();
+        words.push_back (std::string (lower.toRawUTF8(), lower.getNumBytesAsUTF8()));
+    }
+
+    std::vector<float> total ((size_t) numFiles, 0.0f), wordScore ((size_t) numFiles, 0.0f);
+    std::vector<juce::uint8> hits ((size_t) numFiles, 0);
+    std::vector<float> folderScore (belowRoot.size(), 0.0f);
+    std::vector<int> touched;
+    std::vector<Match> matches;
+
+    auto score = [&] (int id, float value)
+    {
+        if (wordScore[(size_t) id] == 0.0f)
+            touched.push_back (id);
+
+        wordScore[(size_t) id] = juce::jmax (wordScore[(size_t) id], value);
+    };
+
+    for (auto& word : words)
+    {
+        // A file scores the best of the ways it matches the word.
+        touched.clear();
+        matches.clear();
+
+        if (! isNumber (word))
+            findTerms (word, matches);
+
+        bool anyFolder = false;
+
+        for (auto& match : matches)
+        {
+            const auto frequency = (float) documentFrequency[match.term];
+            const auto idf = std::log (1.0f + ((float) numFiles - frequency + 0.5f) / (frequency + 0.5f));
+
+            for (auto i = namePostingOffsets[match.term]; i < namePostingOffsets[match.term + 1]; ++i)
+            {
+                const auto id = (int) namePostings[i];
+
+                if (keep[(size_t) id] == 0)
+                    continue;
+
+                const auto tf = (float) nameCounts[i];
+                const auto norm = 1.0f - b + b * (float) nameLengths[(size_t) id] / averageNameLength;
+                score (id, match.weight * idf * tf * (k1 + 1.0f) / (tf + k1 * norm));
+            }
+
+            for (auto i = folderPostingOffsets[match.term]; i < folderPostingOffsets[match.term + 1]; ++i)
+            {
+                auto& folder = folderScore[folderPostings[i]];
+                folder = juce::jmax (folder, folderWeight * match.weight * idf);
+                anyFolder = true;
+            }
+        }
+
+        if (anyFolder)
+        {
+            // Parents come before their children, so one pass hands a folder's score down the tree.
+            for (juce::uint32 d = 0; d < (juce::uint32) folderScore.size(); ++d)
+                if (belowRoot[d] != 0 && belowRoot[paths.getParent (d)] != 0)
+                    folderScore[d] = juce::jmax (folderScore[d], folderScore[paths.getParent (d)]);
+
+            for (int id = 0; id < numFiles; ++id)
+                if (keep[(size_t) id] != 0 && folderScore[paths.getDirectory (id)] > 0.0f)
+                    score (id, folderScore[paths.getDirectory (id)]);
+
+            std::fill (folderScore.begin(), folderScore.end(), 0.0f);
+        }
+
+        // What the plain substring search found before still matches, below the words.
+        for (int id = 0; id < numFiles; ++id)
+            if (keep[(size_t) id] != 0 && index.getKeyView (id).find (word) != std::string_view::npos)
+                score (id, substringScore);
+
+        for (auto id : touched)
+        {
+            ++hits[(size_t) id];
+            total[(size_t) id] += wordScore[(size_t) id];
+            wordScore[(size_t) id] = 0.0f;
+        }
+    }
+
+    std::vector<int> rows;
+
+    for (int id = 0; id < numFiles; ++id)
+    {
+        if (keep[(size_t) id] != 0 && hits[(size_t) id] == (juce::uint8) juce::jmin ((size_t) 255, words.size()))
+            rows.push_back (id);
+        else
+            keep[(size_t) id] = 0;
+    }
+
+    const auto ranked = std::min (numRanked, rows.size());
+    std::partial_sort (rows.begin(), rows.begin() + (long) ranked, rows.end(), [&total] (int x, int y)
+    {
+        return total[(size_t) x] != total[(size_t) y] ? total[(size_t) x] > total[(size_t) y] : x < y;
+    });
+    std::sort (rows.begin() + (long) ranked, rows.end());
+
+    return rows;
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LibrarySearch.h
+    Ranked, typo-tolerant name search for a LibraryIndex. The words of the
+    file names and of the folders below the root form a sorted dictionary
+    with postings; a query word matches dictionary words exactly, as a
+    prefix, or within one or two edits through a BK-tree, and files are
+    ranked by BM25 over the words they matched. Plain substring matches
+    still count, below any word match.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LibraryIndex;
+
+class LibrarySearch
+{
+public:
+    // After the index's paths and keys are complete.
+    void build (const LibraryIndex& index);
+
+    // Clears keep[id] for the files that do not match every word of `text` and returns the others:
+    // the `numRanked` best scores first, then the rest in ID order, so the list never sorts more
+    // than it shows at once.
+    std::vector<int> rank (const juce::String& text, const LibraryIndex& index, std::vector<juce::uint8>& keep,
+                           size_t numRanked = defaultNumRanked) const;
+
+    static constexpr size_t defaultNumRanked = 1000;
+    static constexpr size_t maxTermLength = 32;     // longer words are only matched exactly or by prefix
+
+    // Typos forgiven in a word of `length` bytes: none for short words, which would match everything.
+    static int getMaxEdits (size_t length) noexcept     { return length < 4 ? 0 : (length < 8 ? 1 : 2); }
+
+    // Levenshtein distance of the first maxTermLength bytes of each.
+    static int getEditDistance (std::string_view a, std::string_view b) noexcept;
+
+    // Lower-case words of `text`, split at anything but letters and digits, between letters and
+    // digits, and before a capital that follows a lower-case letter: "MetalHit_02" is metal, hit, 02.
+    static void tokenize (std::string_view text, std::vector<std::string>& words);
+
+    int getNumTerms() const noexcept    { return (int) termOffsets.size() - 1; }
+
+private:
+    struct Match
+    {
+        juce::uint32 term;
+        float weight;       // 1 exact, less for a prefix or a typo
+    };
+
+    struct Node
+    {
+        juce::uint32 term, firstChild, nextSibling;
+        int distance;       // to the parent's term
+    };
+
+    static constexpr juce::uint32 none = 0xffffffff;
+
+    std::string_view getTerm (juce::uint32 term) const noexcept;
+    void findTerms (std::string_view word, std::vector<Match>& matches) const;
+    void addToTree (juce::uint32 term);
+
+    // Dictionary words in byte order, so the words with a given prefix are one range.
+    // Numbers are not words: they are found as substrings.
+    std::vector<char> termArena;
+    std::vector<juce::uint32> termOffsets { 0 };
+
+    // Per term: the files whose name has it (with the count) and the folders whose name has it
+    std::vector<juce::uint32> namePostingOffsets { 0 }, namePostings;
+    std::vector<juce::uint8> nameCounts;
+    std::vector<juce::uint32> folderPostingOffsets { 0 }, folderPostings;
+    std::vector<juce::uint32> documentFrequency;    // files that have the term, through either
+
+    std::vector<juce::uint16> nameLengths;          // words per file name
+    float averageNameLength = 1.0f;
+    std::vector<juce::uint8> belowRoot;             // per PathStore directory
+
+    std::vector<Node> tree;                         // BK-tree over the terms, node 0 is its root
+};
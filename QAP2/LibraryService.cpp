@@ -0,0 +1,683 @@
+/*
+  ==============================================================================
+
+    LibraryService.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryService.h"
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    // Keeps the cached file data alive for as long as a reader streams from it,
+    // even if the preview cache evicts the entry in the meantime.
+    struct SharedBlockInputStream  : public juce::MemoryInputStream
+    {
+        explicit SharedBlockInputStream (std::shared_ptr<const juce::MemoryBlock> source)
+            : juce::MemoryInputStream (source->getData(), source->getSize(), false),
+              block (std::move (source))
+        {
+        }
+
+        std::shared_ptr<const juce::MemoryBlock> block;
+    };
+}
+
+//==============================================================================
+std::string_view LibraryIndex::getNameView (int id) const noexcept
+{
+    return paths.getName (id);
+}
+
+std::string_view LibraryIndex::getKeyView (int id) const noexcept
+{
+    const auto start = keyOffsets[(size_t) id];
+    return { keyArena.data() + start, keyOffsets[(size_t) id + 1] - start };
+}
+
+juce::String LibraryIndex::getName (int id) const
+{
+    auto view = getNameView (id);
+    return juce::String::fromUTF8 (view.data(), (int) view.size());
+}
+
+int LibraryIndex::indexOf (const juce::String& name) const
+{
+    auto utf8 = name.toRawUTF8();
+    auto found = byName.find (std::string_view (utf8, name.getNumBytesAsUTF8()));
+    return found != byName.end() ? found->second : -1;
+}
+
+juce::File LibraryIndex::getFile (const juce::String& name) const
+{
+    auto index = indexOf (name);
+    return index >= 0 ? paths.getFile (index) : juce::File();
+}
+
+size_t LibraryIndex::getNameMemoryBytes() const noexcept
+{
+    // A hash node holds the view, the ID, the cached hash and the next pointer.
+    return paths.getMemoryBytes() + keyArena.capacity() + keyOffsets.capacity() * sizeof (juce::uint32)
+         + byName.bucket_count() * sizeof (void*)
+         + byName.size() * (sizeof (std::pair<const std::string_view, int>) + sizeof (size_t) + sizeof (void*));
+}
+
+std::vector<int> LibraryIndex::findMatches (const juce::String& searchText) const
+{
+    LibraryQuery query;
+    query.text = searchText;
+    return runQuery (query);
+}
+
+std::vector<int> LibraryIndex::runQuery (const LibraryQuery& query, const LibraryFacets* facets) const
+{
+    std::vector<juce::uint8> keep ((size_t) size(), 1);
+
+    for (auto& range : query.ranges)
+        columns.applyRange (range.column, range.minValue, range.maxValue, keep);
+
+    if (! query.facets.empty())
+    {
+        const LibraryFacets none;
+        (facets != nullptr ? *facets : none).apply (query, keep);
+    }
+
+    // Text last, so only the files the filters left are scored.
+    if (query.text.isNotEmpty())
+    {
+        auto ranked = search.rank (query.text, *this, keep);
+
+        if (query.sortKeys.empty())
+            return ranked;
+    }
+
+    return columns.sortRows (keep, query.sortKeys, *this);
+}
+
+namespace
+{
+    void appendToArena (std::vector<char>& arena, std::vector<juce::uint32>& offsets, std::string_view text)
+    {
+        arena.insert (arena.end(), text.begin(), text.end());
+        offsets.push_back ((juce::uint32) arena.size());
+    }
+
+    void appendToArena (std::vector<char>& arena, std::vector<juce::uint32>& offsets, const juce::String& text)
+    {
+        appendToArena (arena, offsets, std::string_view (text.toRawUTF8(), text.getNumBytesAsUTF8()));
+    }
+}
+
+std::shared_ptr<const LibraryIndex> LibraryIndex::scan (const juce::File& folder, const juce::String& wildcard,
+                                                        juce::AudioFormatManager* formats)
+{
+    auto index = std::make_shared<LibraryIndex>();
+    index->root = folder;
+
+    auto files = folder.findChildFiles (juce::File::findFiles, true, wildcard);
+
+    const auto numFiles = (size_t) files.size();
+    index->paths.reserve (numFiles);
+    index->keyOffsets.reserve (numFiles + 1);
+    index->keyOffsets.push_back (0);
+
+    for (auto& path : files)
+    {
+        index->paths.add (path);
+        appendToArena (index->keyArena, index->keyOffsets, path.getFileName().toLowerCase());
+        index->columns.addFile (path, folder, formats);
+    }
+
+    index->rebuildNameLookup();
+    index->columns.buildOrders (*index);
+    index->search.build (*index);
+
+    return index;
+}
+
+void LibraryIndex::rebuildNameLookup()
+{
+    // Only once the arena no longer moves, the map points into it.
+    byName.clear();
+    byName.reserve ((size_t) size());
+
+    for (int i = 0; i < size(); ++i)
+        byName.emplace (getNameView (i), i);
+}
+
+std::shared_ptr<const LibraryIndex> LibraryIndex::withChanges (const LibraryChanges& changes, juce::AudioFormatManager& formats) const
+{
+    // Rewritten files are dropped too and come back with fresh metadata.
+    std::vector<juce::uint8> keep ((size_t) size(), 1);
+    juce::Array<juce::File> changed;
+
+    for (auto& path : changes.removed)  changed.add (juce::File (path));
+    for (auto& path : changes.added)    changed.add (juce::File (path));
+
+    for (auto id : paths.indexOf (changed))
+        if (id >= 0)
+            keep[(size_t) id] = 0;
+
+    if (! changes.removedFolders.isEmpty())
+    {
+        // Parents are interned before their children, so one pass in ID order marks every subfolder.
+        std::vector<juce::uint8> removedDirectories ((size_t) paths.getNumDirectories(), 0);
+
+        for (auto& folder : changes.removedFolders)
+        {
+            const auto directory = paths.findDirectory (folder);
+
+            if (directory >= 0)
+                removedDirectories[(size_t) directory] = 1;
+        }
+
+        for (juce::uint32 d = 0; d < (juce::uint32) removedDirectories.size(); ++d)
+            if (paths.getParent (d) != PathStore::noParent && removedDirectories[paths.getParent (d)] != 0)
+                removedDirectories[d] = 1;
+
+        for (int id = 0; id < size(); ++id)
+            if (removedDirectories[paths.getDirectory (id)] != 0)
+                keep[(size_t) id] = 0;
+    }
+
+    auto index = std::make_shared<LibraryIndex>();
+    index->root = root;
+    index->columns.categoryNames = columns.categoryNames;
+
+    const auto capacity = (size_t) size() + changes.added.size();
+    index->paths = paths.withDirectoriesOnly();
+    index->paths.reserve (capacity);
+    index->keyArena.reserve (keyArena.size());
+    index->keyOffsets.reserve (capacity + 1);
+    index->keyOffsets.push_back (0);
+
+    // Kept entries are copied by ID, metadata included: no paths are built and no disk is read.
+    for (int id = 0; id < size(); ++id)
+    {
+        if (keep[(size_t) id] == 0)
+            continue;
+
+        index->paths.addFrom (paths, id);
+        appendToArena (index->keyArena, index->keyOffsets, getKeyView (id));
+        index->columns.addFrom (columns, id);
+    }
+
+    // In path order, so the same changes give the same IDs.
+    std::vector<juce::String> added (changes.added.begin(), changes.added.end());
+    std::sort (added.begin(), added.end());
+
+    for (auto& path : added)
+    {
+        const juce::File file (path);
+
+        if (! file.existsAsFile() || file.isHidden() || ! file.isAChildOf (root)
+             || formats.findFormatForFileExtension (file.getFileExtension()) == nullptr)
+            continue;
+
+        index->paths.add (file);
+        appendToArena (index->keyArena, index->keyOffsets, file.getFileName().toLowerCase());
+        index->columns.addFile (file, root, &formats);
+    }
+
+    // The sort orders and search postings are rebuilt over the result: in-memory work that grows
+    // with the index, but nothing compared with reading it from disk again.
+    index->rebuildNameLookup();
+    index->columns.buildOrders (*index);
+    index->search.build (*index);
+    return index;
+}
+
+std::shared_ptr<const LibraryIndex> LibraryIndex::withAnalysis (std::vector<float> loudness,
+                                                               const std::vector<std::vector<juce::uint32>>& transients) const
+{
+    auto copy = std::make_shared<LibraryIndex> (*this);
+    copy->rebuildNameLookup();   // the copied views still point into our arena
+    copy->columns.loudness = std::move (loudness);
+    copy->columns.buildOrder (LibraryColumn::loudness, *copy);
+
+    auto& columns = copy->columns;
+    columns.transients.clear();
+    columns.transientOffsets.assign (1, 0);
+
+    for (auto& points : transients)
+    {
+        columns.transients.insert (columns.transients.end(), points.begin(), points.end());
+        columns.transientOffsets.push_back ((juce::uint32) columns.transients.size());
+    }
+
+    return copy;
+}
+
+//==============================================================================
+LibraryService::LibraryService()
+{
+    formatManager.registerBasicFormats();
+}
+
+LibraryService::~LibraryService()
+{
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (watcherLock);
+        watchers.clear();
+    }
+
+    scanPool.removeAllJobs (true, 10000);
+    analysisPool.removeAllJobs (true, 10000);
+    *alive = false;
+}
+
+std::shared_ptr<const LibraryIndex> LibraryService::getEmptyIndex()
+{
+    static const auto empty = std::make_shared<const LibraryIndex>();
+    return empty;
+}
+
+std::shared_ptr<const LibraryIndex> LibraryService::acquireIndex (const juce::File& folder, bool forceRescan)
+{
+    const auto key = folder.getFullPathName();
+
+    if (! forceRescan)
+    {
+        const juce::ScopedReadLock sl (indexLock);
+
+        auto found = indexes.find (key);
+        if (found != indexes.end())
+            if (auto existing = found->second.lock())
+                return existing;
+    }
+
+    std::shared_ptr<const LibraryIndex> index;
+
+    {
+        // Only one scan at a time: a second instance asking for the same folder
+        // waits here and then picks up the index the first one built.
+        const RealtimeCheckedLock::ScopedLockType scanGuard (scanLock);
+
+        if (! forceRescan)
+        {
+            const juce::ScopedReadLock sl (indexLock);
+
+            auto found = indexes.find (key);
+            if (found != indexes.end())
+                if (auto existing = found->second.lock())
+                    return existing;
+        }
+
+        index = LibraryIndex::scan (folder, formatManager.getWildcardForAllFormats(), &formatManager);
+
+        const juce::ScopedWriteLock sl (indexLock);
+        indexes[key] = index;
+    }
+
+    sendChangeMessage();
+    startWatching (folder);
+    analyseLoudness (index);
+    return index;
+}
+
+bool LibraryService::isCurrent (const LibraryIndex& index)
+{
+    const juce::ScopedReadLock sl (indexLock);
+
+    auto found = indexes.find (index.root.getFullPathName());
+    return found != indexes.end() && found->second.lock().get() == &index;
+}
+
+bool LibraryService::publish (const std::shared_ptr<const LibraryIndex>& previous, std::shared_ptr<const LibraryIndex> next)
+{
+    {
+        const juce::ScopedWriteLock sl (indexLock);
+
+        auto& slot = indexes[previous->root.getFullPathName()];
+
+        if (slot.lock() != previous)
+            return false;
+
+        slot = next;
+    }
+
+    // The map only holds a weak reference: keep the new index alive until the listeners have it.
+    juce::MessageManager::callAsync ([this, next, alive = alive]
+    {
+        if (*alive)
+            sendSynchronousChangeMessage();
+    });
+
+    return true;
+}
+
+void LibraryService::analyseLoudness (std::shared_ptr<const LibraryIndex> index)
+{
+    auto& loudness = index->columns.loudness;
+
+    if (std::none_of (loudness.begin(), loudness.end(), [] (float value) { return std::isnan (value); }))
+        return;
+
+    analysisPool.addJob ([this, index]() mutable
+    {
+        auto measured = index->columns.loudness;
+        std::vector<std::vector<juce::uint32>> transients ((size_t) index->size());
+
+        // Kept from before an incremental update
+        for (int id = 0; id < index->size(); ++id)
+            if (! std::isnan (measured[(size_t) id]))
+                transients[(size_t) id] = index->columns.getTransients (id);
+
+        // Under the scan lock, so a watcher update cannot slip in between the check and the swap.
+        auto publishMeasured = [this, &index, &measured, &transients]
+        {
+            const RealtimeCheckedLock::ScopedLockType scanGuard (scanLock);
+
+            if (! isCurrent (*index))
+                return false;
+
+            auto next = index->withAnalysis (measured, transients);
+            publish (index, next);
+            index = std::move (next);
+            return true;
+        };
+
+        auto lastPublished = juce::Time::getMillisecondCounter();
+        bool unpublished = false;
+
+        for (int id = 0; id < index->size(); ++id)
+        {
+            if ((id % 64) == 0)
+            {
+                // Give up once the folder was rescanned, changed, closed, or we are shutting down. What
+                // was published so far is carried into the next index, and its job starts from there.
+                if (juce::ThreadPoolJob::getCurrentThreadPoolJob()->shouldExit() || ! isCurrent (*index))
+                    return;
+
+                if (unpublished && juce::Time::getMillisecondCounter() - lastPublished >= (juce::uint32) publishIntervalMs)
+                {
+                    if (! publishMeasured())
+                        return;
+
+                    lastPublished = juce::Time::getMillisecondCounter();
+                    unpublished = false;
+                }
+            }
+
+            if (! std::isnan (measured[(size_t) id]))
+                continue;
+
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (index->getFile (id)));
+
+            if (reader != nullptr)
+            {
+                measured[(size_t) id] = LibraryColumns::measureLoudness (*reader, &transients[(size_t) id]);
+                unpublished = true;
+            }
+        }
+
+        if (unpublished)
+            publishMeasured();
+    });
+}
+
+//==============================================================================
+void LibraryService::startWatching (const juce::File& folder)
+{
+    if (! LibraryWatcher::isSupported())
+        return;
+
+    std::vector<std::unique_ptr<LibraryWatcher>> stale;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (watcherLock);
+
+        // Folders no instance shows any more are not worth watching.
+        for (auto it = watchers.begin(); it != watchers.end();)
+        {
+            bool inUse = false;
+
+            {
+                const juce::ScopedReadLock rl (indexLock);
+                auto found = indexes.find (it->first);
+                inUse = found != indexes.end() && ! found->second.expired();
+            }
+
+            if (inUse)
+            {
+                ++it;
+            }
+            else
+            {
+                stale.push_back (std::move (it->second));
+                it = watchers.erase (it);
+            }
+        }
+
+        auto& watcher = watchers[folder.getFullPathName()];
+
+        if (watcher == nullptr)
+            watcher = std::make_unique<LibraryWatcher> (folder, [this, folder] (const LibraryChanges& changes)
+            {
+                applyChanges (folder, changes);
+            });
+    }
+
+    // Stopped outside the lock: a watcher may be inside applyChanges right now.
+    stale.clear();
+}
+
+void LibraryService::applyChanges (const juce::File& folder, const LibraryChanges& changes)
+{
+    std::shared_ptr<const LibraryIndex> updated;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType scanGuard (scanLock);
+        std::shared_ptr<const LibraryIndex> current;
+
+        {
+            const juce::ScopedReadLock sl (indexLock);
+
+            auto found = indexes.find (folder.getFullPathName());
+            if (found != indexes.end())
+                current = found->second.lock();
+        }
+
+        if (current == nullptr)
+            return;
+
+        if (changes.rescan)
+            updated = LibraryIndex::scan (folder, formatManager.getWildcardForAllFormats(), &formatManager);
+        else
+            updated = current->withChanges (changes, formatManager);
+
+        if (! publish (current, updated))
+            return;
+    }
+
+    analyseLoudness (updated);
+}
+
+void LibraryService::acquireIndexAsync (const juce::File& folder, IndexCallback onLoaded, bool forceRescan)
+{
+    scanPool.addJob ([this, folder, forceRescan, onLoaded = std::move (onLoaded)]
+    {
+        auto index = acquireIndex (folder, forceRescan);
+
+        juce::MessageManager::callAsync ([index, onLoaded] { onLoaded (index); });
+    });
+}
+
+//==============================================================================
+std::unique_ptr<juce::AudioFormatReader> LibraryService::createReaderFor (const juce::File& file)
+{
+    auto source = file;
+
+    if (pcmCache.needsDecoding (file))
+    {
+        auto decoded = pcmCache.getCachedFile (file);
+
+        // Decoded live this time, from the cache next time. Read from disk rather than the preview
+        // cache, so the audition engine's read-ahead thread runs the decoder, not the audio thread.
+        if (! decoded.existsAsFile())
+        {
+            pcmCache.requestDecode (file);
+            return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (file));
+        }
+
+        source = decoded;
+    }
+
+    if (auto data = getPreviewData (source))
+        return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (std::make_unique<SharedBlockInputStream> (data)));
+
+    return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (source));
+}
+
+std::shared_ptr<const juce::MemoryBlock> LibraryService::getPreviewData (const juce::File& file)
+{
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (previewLock);
+
+        if (auto* data = previewCache.find (file))
+        {
+            auto found = *data;
+            budget->noteHit (MemoryBudget::previews);
+            trimPreviewCache();     // other pools may have grown since
+            return found;
+        }
+    }
+
+    const auto size = file.getSize();
+
+    if (size <= 0 || size > maxPreviewFileBytes)
+        return {};
+
+    budget->noteMiss (MemoryBudget::previews);
+    auto loaded = std::make_unique<juce::MemoryBlock>();
+
+    if (! file.loadFileAsData (*loaded))
+        return {};
+
+    // Counted until the last holder lets go, which may be a reader long after the cache evicted it.
+    const auto bytes = (juce::int64) loaded->getSize();
+    budget->add (MemoryBudget::previews, bytes);
+
+    std::shared_ptr<const juce::MemoryBlock> data (loaded.release(), [owner = budget] (const juce::MemoryBlock* block)
+    {
+        owner->add (MemoryBudget::previews, -(juce::int64) block->getSize());
+        delete block;
+    });
+
+    const RealtimeCheckedLock::ScopedLockType sl (previewLock);
+
+    // Another thread may have loaded it meanwhile
+    if (previewCache.find (file) == nullptr)
+    {
+        previewCache.insert (file, data, bytes, budget->getLimit (MemoryBudget::previews));
+        trimPreviewCache();
+    }
+
+    return data;
+}
+
+void LibraryService::trimPreviewCache()
+{
+    // What readers hold beyond the cache (evicted blocks, the audition engine's read-ahead) is
+    // in the pool too; the cache makes room for it.
+    const auto heldElsewhere = budget->getBytes (MemoryBudget::previews) - previewCache.getBytes();
+    previewCache.trim (juce::jmax ((juce::int64) 0, budget->getLimit (MemoryBudget::previews) - heldElsewhere));
+}
+
+//==============================================================================
+ThumbnailCache::ThumbnailCache (MemoryBudget& memoryBudget)
+    : juce::AudioThumbnailCache (4096),     // the budget limits it long before this
+      budget (memoryBudget)
+{
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    budget.add (MemoryBudget::thumbnails, -bytes);
+}
+
+void ThumbnailCache::show (juce::AudioThumbnail& thumbnail, const juce::File& file)
+{
+    auto source = std::make_unique<juce::FileInputSource> (file);
+    const auto hashCode = source->hashCode();
+    std::vector<juce::int64> victims;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (entryLock);
+
+        auto entry = std::find_if (entries.begin(), entries.end(), [hashCode] (const Entry& e) { return e.hashCode == hashCode; });
+
+        if (entry != entries.end())
+        {
+            entry->lastUsed = ++clock;
+            budget.noteHit (MemoryBudget::thumbnails);
+        }
+        else
+        {
+            budget.noteMiss (MemoryBudget::thumbnails);
+        }
+
+        victims = takeVictims (hashCode);
+    }
+
+    for (auto victim : victims)
+        removeThumb (victim);
+
+    thumbnail.setSource (source.release());
+}
+
+void ThumbnailCache::saveNewlyFinishedThumbnail (const juce::AudioThumbnailBase& thumbnail, juce::int64 hashCode)
+{
+    // What the base class stored for it, measured the same way
+    juce::MemoryOutputStream data;
+    thumbnail.saveTo (data);
+    const auto size = (juce::int64) data.getDataSize();
+
+    std::vector<juce::int64> victims;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (entryLock);
+
+        auto entry = std::find_if (entries.begin(), entries.end(), [hashCode] (const Entry& e) { return e.hashCode == hashCode; });
+
+        if (entry == entries.end())
+            entry = entries.insert (entries.end(), { hashCode, 0, 0 });
+
+        bytes += size - entry->bytes;
+        budget.add (MemoryBudget::thumbnails, size - entry->bytes);
+        entry->bytes = size;
+        entry->lastUsed = ++clock;
+
+        victims = takeVictims (hashCode);
+    }
+
+    for (auto victim : victims)
+        removeThumb (victim);
+}
+
+std::vector<juce::int64> ThumbnailCache::takeVictims (juce::int64 keep)
+{
+    std::vector<juce::int64> victims;
+
+    while (budget.isOverLimit (MemoryBudget::thumbnails) && entries.size() > 1)
+    {
+        auto oldest = entries.end();
+
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->hashCode != keep && (oldest == entries.end() || it->lastUsed < oldest->lastUsed))
+                oldest = it;
+
+        if (oldest == entries.end())
+            break;
+
+        bytes -= oldest->bytes;
+        budget.add (MemoryBudget::thumbnails, -oldest->bytes);
+        victims.push_back (oldest->hashCode);
+        entries.erase (oldest);
+    }
+
+    return victims;
+}
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    LibraryService.h
+    Process-wide sound library shared by every QAPAudioProcessor instance.
+    Use it through juce::SharedResourcePointer<LibraryService> so it lives
+    exactly as long as at least one plugin instance does.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PerformanceMonitor.h"
+#include "PcmCache.h"
+#include "LibraryColumns.h"
+#include "LibraryDatabase.h"
+#include "LibrarySearch.h"
+#include "LibraryWatcher.h"
+#include "MemoryBudget.h"
+#include "PathStore.h"
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+//==============================================================================
+// Immutable snapshot of one scanned library folder. Once published it is never
+// modified, so any thread holding the shared_ptr can read it without locking.
+// Files are identified by their position in `paths` (their ID).
+struct LibraryIndex
+{
+    juce::File root;
+    PathStore paths;            // directories and file names, each stored once
+
+    // The lower-cased names that search runs over, as UTF-8 back to back: key i is
+    // [keyOffsets[i], keyOffsets[i + 1]).
+    std::vector<char> keyArena;
+    std::vector<juce::uint32> keyOffsets;
+    std::unordered_map<std::string_view, int> byName;   // views into `paths`, first file with a given name
+
+    LibraryColumns columns;     // metadata, one entry per ID
+    LibrarySearch search;       // words of the names and folders, for ranked text queries
+
+    int size() const noexcept   { return paths.size(); }
+    std::string_view getNameView (int id) const noexcept;
+    std::string_view getKeyView (int id) const noexcept;
+    juce::String getName (int id) const;
+    int indexOf (const juce::String& name) const;
+    juce::File getFile (const juce::String& name) const;
+    juce::File getFile (int id) const           { return paths.getFile (id); }
+
+    // What the paths, the search keys and byName cost, without the columns and the search words.
+    size_t getNameMemoryBytes() const noexcept;
+
+    // IDs of the files that match every word of `searchText`, best match first (see LibrarySearch).
+    std::vector<int> findMatches (const juce::String& searchText) const;
+
+    // IDs that match the query's text, ranges and facets, in the query's sort order; without sort
+    // keys, text queries come best match first. Without `facets` (from LibraryDatabase::getFacets
+    // for this index), no file has any facet.
+    std::vector<int> runQuery (const LibraryQuery& query, const LibraryFacets* facets = nullptr) const;
+
+    // `wildcard` is a semicolon-separated list, e.g. AudioFormatManager::getWildcardForAllFormats().
+    // With `formats`, file headers are read for the duration, rate and channel columns.
+    static std::shared_ptr<const LibraryIndex> scan (const juce::File& folder, const juce::String& wildcard = "*.wav",
+                                                     juce::AudioFormatManager* formats = nullptr);
+
+    // A copy with the loudness column and the transients replaced, for publishing analysis results.
+    std::shared_ptr<const LibraryIndex> withAnalysis (std::vector<float> loudness,
+                                                      const std::vector<std::vector<juce::uint32>>& transients) const;
+
+    // A copy with `changes` applied. Unchanged entries are copied with their metadata and only
+    // the added files are read from disk; files that do not match `formats` are ignored. The
+    // column orders and the search are rebuilt over the whole result, which is why LibraryWatcher
+    // delivers at most one batch per interval.
+    std::shared_ptr<const LibraryIndex> withChanges (const LibraryChanges& changes, juce::AudioFormatManager& formats) const;
+
+private:
+    void rebuildNameLookup();
+};
+
+//==============================================================================
+// AudioThumbnailCache that keeps its finished thumbnails within the budget's thumbnail pool,
+// evicting the least recently shown first.
+class ThumbnailCache  : public juce::AudioThumbnailCache
+{
+public:
+    explicit ThumbnailCache (MemoryBudget& budget);
+    ~ThumbnailCache() override;
+
+    // Message thread: shows `file` in `thumbnail`, counting whether it was still cached.
+    void show (juce::AudioThumbnail& thumbnail, const juce::File& file);
+
+protected:
+    void saveNewlyFinishedThumbnail (const juce::AudioThumbnailBase& thumbnail, juce::int64 hashCode) override;
+
+private:
+    struct Entry
+    {
+        juce::int64 hashCode = 0, bytes = 0;
+        juce::uint32 lastUsed = 0;
+    };
+
+    // Takes the victims out under our lock, so removeThumb is never called while holding it.
+    std::vector<juce::int64> takeVictims (juce::int64 keep);
+
+    MemoryBudget& budget;
+    RealtimeCheckedLock entryLock;
+    std::vector<Entry> entries;
+    juce::int64 bytes = 0;
+    juce::uint32 clock = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailCache)
+};
+
+//==============================================================================
+class LibraryService  : public juce::ChangeBroadcaster
+{
+public:
+    LibraryService();
+    ~LibraryService() override;
+
+    // Returns the shared index for `folder`, scanning it only if no instance
+    // holds it yet or if `forceRescan` is set. Safe to call from any thread.
+    std::shared_ptr<const LibraryIndex> acquireIndex (const juce::File& folder, bool forceRescan = false);
+
+    // Same as acquireIndex, but runs on the service's background thread and
+    // delivers the index on the message thread. Used when restoring sessions
+    // and by the "Load Library" button.
+    using IndexCallback = std::function<void (std::shared_ptr<const LibraryIndex>)>;
+    void acquireIndexAsync (const juce::File& folder, IndexCallback onLoaded, bool forceRescan = false);
+
+    static std::shared_ptr<const LibraryIndex> getEmptyIndex();
+
+    juce::AudioFormatManager& getFormatManager() noexcept     { return formatManager; }
+    ThumbnailCache& getThumbnailCache() noexcept              { return thumbnailCache; }
+    PcmCache& getPcmCache() noexcept                          { return pcmCache; }
+    LibraryDatabase& getDatabase() noexcept                   { return database; }
+
+    // Opens a reader for `file`, served from the in-memory preview cache when possible. It may
+    // read the whole file into that cache, so call it from a background thread (the audition
+    // loader, the export thread), never the message or audio thread.
+    // Compressed files are read from their decoded copy once the PCM cache has one,
+    // and decoded from disk while they are queued for decoding otherwise.
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor (const juce::File& file);
+
+    // Previews and thumbnails are held within this budget's pools
+    MemoryBudget& getMemoryBudget() noexcept                  { return *budget; }
+
+    static constexpr juce::int64 maxPreviewFileBytes  = 8 * 1024 * 1024;
+
+private:
+    std::shared_ptr<const juce::MemoryBlock> getPreviewData (const juce::File& file);
+    void trimPreviewCache();    // under previewLock
+
+    // Measures the loudness and transients of files that have none yet in the background and
+    // publishes the results as new indexes, every publishIntervalMs while it runs and at the end.
+    void analyseLoudness (std::shared_ptr<const LibraryIndex> index);
+    static constexpr int publishIntervalMs = 2000;
+    bool isCurrent (const LibraryIndex& index);
+
+    // Replaces `previous` by `next` if it is still the current index of its folder, and tells the listeners.
+    bool publish (const std::shared_ptr<const LibraryIndex>& previous, std::shared_ptr<const LibraryIndex> next);
+
+    void startWatching (const juce::File& folder);
+    void applyChanges (const juce::File& folder, const LibraryChanges& changes);
+
+    juce::SharedResourcePointer<MemoryBudget> budget;
+    juce::AudioFormatManager formatManager;
+    ThumbnailCache thumbnailCache { *budget };
+    PcmCache pcmCache { formatManager };
+    LibraryDatabase database;
+
+    juce::ThreadPool scanPool { 1 };
+    juce::ThreadPool analysisPool { 1 };
+    std::shared_ptr<bool> alive = std::make_shared<bool> (true);    // read and cleared on the message thread
+    juce::ReadWriteLock indexLock;
+    RealtimeCheckedLock scanLock;
+    std::map<juce::String, std::weak_ptr<const LibraryIndex>> indexes;
+
+    RealtimeCheckedLock watcherLock;
+    std::map<juce::String, std::unique_ptr<LibraryWatcher>> watchers;     // one per folder in `indexes`
+
+    struct FileHash
+    {
+        size_t operator() (const juce::File& file) const noexcept   { return file.getFullPathName().hash(); }
+    };
+
+    // Blocks count against the previews pool from load until their last holder (the cache or a
+    // reader streaming from it) lets go, so the cache gets what the readers leave.
+    RealtimeCheckedLock previewLock;
+    ArcCache<juce::File, std::shared_ptr<const juce::MemoryBlock>, FileHash> previewCache;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryService)
+};
@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+    LibraryWatcher.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryWatcher.h"
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+void LibraryChanges::addFile (const juce::File& file)
+{
+    const auto path = file.getFullPathName();
+    removed.erase (path);
+    added.insert (path);
+}
+
+void LibraryChanges::removeFile (const juce::File& file)
+{
+    const auto path = file.getFullPathName();
+    added.erase (path);
+    removed.insert (path);
+}
+
+void LibraryChanges::removeFolder (const juce::File& folder)
+{
+    const auto prefix = folder.getFullPathName() + juce::File::getSeparatorString();
+
+    for (auto it = added.begin(); it != added.end();)
+        it = it->startsWith (prefix) ? added.erase (it) : std::next (it);
+
+    removedFolders.addIfNotAlreadyThere (folder);
+}
+
+//==============================================================================
+LibraryWatcher::LibraryWatcher (const juce::File& rootFolder, Callback callback)
+    : juce::Thread ("QAP library watcher"), root (rootFolder), onChanges (std::move (callback))
+{
+   #if JUCE_LINUX
+    fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        watchTree (root, nullptr);
+        startThread();
+    }
+   #endif
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    stopThread (2000);
+
+   #if JUCE_LINUX
+    if (fd >= 0)
+        close (fd);     // also drops every watch
+   #endif
+}
+
+bool LibraryWatcher::isSupported() noexcept
+{
+   #if JUCE_LINUX
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+#if JUCE_LINUX
+void LibraryWatcher::watchTree (const juce::File& folder, LibraryChanges* addFilesTo)
+{
+    // Files are reported on IN_CLOSE_WRITE, once written; IN_CREATE only matters for folders.
+    constexpr auto mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+
+    const auto wd = inotify_add_watch (fd, folder.getFullPathName().toRawUTF8(), mask);
+
+    // Out of watches (fs.inotify.max_user_watches) or the folder went away already: what changed
+    // in it is unknown, so the next update is a full scan. The first scan is one already.
+    if (wd >= 0)
+        folders[wd] = folder;
+    else if (addFilesTo != nullptr)
+        addFilesTo->rescan = true;
+
+    // A folder that appears with content (moved in, unpacked) reports none of it, so pick it up here.
+    for (const auto& entry : juce::RangedDirectoryIterator (folder, false, "*", juce::File::findFilesAndDirectories))
+    {
+        if (entry.isDirectory())
+            watchTree (entry.getFile(), addFilesTo);
+        else if (addFilesTo != nullptr)
+            addFilesTo->addFile (entry.getFile());
+    }
+}
+
+void LibraryWatcher::unwatchTree (const juce::File& folder)
+{
+    for (auto it = folders.begin(); it != folders.end();)
+    {
+        if (it->second == folder || it->second.isAChildOf (folder))
+        {
+            inotify_rm_watch (fd, it->first);
+            it = folders.erase (it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void LibraryWatcher::readEvents (LibraryChanges& pending)
+{
+    alignas (inotify_event) char buffer[16384];
+
+    for (;;)
+    {
+        const auto length = read (fd, buffer, sizeof (buffer));
+
+        if (length <= 0)
+            return;
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto& event = *reinterpret_cast<const inotify_event*> (buffer + offset);
+            offset += (ssize_t) (sizeof (inotify_event) + event.len);
+
+            // The kernel queue overflowed and dropped events.
+            if ((event.mask & IN_Q_OVERFLOW) != 0)
+            {
+                pending.rescan = true;
+                continue;
+            }
+
+            auto folder = folders.find (event.wd);
+
+            if (folder == folders.end())
+                continue;
+
+            if ((event.mask & IN_DELETE_SELF) != 0)
+            {
+                unwatchTree (folder->second);
+                continue;
+            }
+
+            if ((event.mask & IN_IGNORED) != 0)
+            {
+                folders.erase (folder);
+                continue;
+            }
+
+            if (event.len == 0)
+                continue;
+
+            const auto file = folder->second.getChildFile (juce::String::fromUTF8 (event.name));
+            const bool isFolder = (event.mask & IN_ISDIR) != 0;
+
+            if ((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+            {
+                if (isFolder)
+                {
+                    // A folder moved elsewhere keeps its watches, which would report under the old
+                    // path; moved within the tree, IN_MOVED_TO watches it again under the new one.
+                    unwatchTree (file);
+                    pending.removeFolder (file);
+                }
+                else
+                {
+                    pending.removeFile (file);
+                }
+            }
+            else if (isFolder && (event.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+            {
+                watchTree (file, &pending);
+            }
+            else if (! isFolder && (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+            {
+                pending.addFile (file);
+            }
+        }
+    }
+}
+#endif
+
+void LibraryWatcher::run()
+{
+   #if JUCE_LINUX
+    LibraryChanges pending;
+    auto lastEvent = juce::Time::getMillisecondCounter();
+    auto firstPending = lastEvent;
+    auto lastDelivery = lastEvent - (juce::uint32) batchIntervalMs;
+
+    while (! threadShouldExit())
+    {
+        pollfd request { fd, POLLIN, 0 };
+        const bool ready = poll (&request, 1, 50) > 0;
+        const auto now = juce::Time::getMillisecondCounter();
+
+        if (ready)
+        {
+            if (pending.isEmpty())
+                firstPending = now;
+
+            readEvents (pending);
+            lastEvent = now;
+        }
+
+        // Deliver once the burst is over, so copying a folder of 500 files is one update, not 500; a
+        // burst that never settles is delivered anyway once it is a batch interval old.
+        const bool settled = now - lastEvent >= (juce::uint32) settleMs || now - firstPending >= (juce::uint32) batchIntervalMs;
+
+        if (! pending.isEmpty() && settled && now - lastDelivery >= (juce::uint32) batchIntervalMs)
+        {
+            onChanges (pending);
+            pending = {};
+            lastDelivery = juce::Time::getMillisecondCounter();
+        }
+    }
+   #endif
+}
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    LibraryWatcher.h
+    Watches a library folder tree and reports files that were added, removed
+    or renamed, in small batches, so the index can be patched instead of
+    rescanned. Uses inotify on Linux; on other platforms it reports nothing
+    and "Load Library" remains the way to refresh.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <unordered_set>
+
+// One batch of filesystem changes below a library root. A rename shows up
+// as a removal of the old path and an addition of the new one.
+struct LibraryChanges
+{
+    std::unordered_set<juce::String> added;     // full paths of new or rewritten files
+    std::unordered_set<juce::String> removed;   // full paths of deleted files
+    juce::Array<juce::File> removedFolders;     // everything below these is gone
+    bool rescan = false;                        // events were lost: only a full scan is right
+
+    bool isEmpty() const noexcept   { return ! rescan && added.empty() && removed.empty() && removedFolders.isEmpty(); }
+
+    void addFile (const juce::File& file);
+    void removeFile (const juce::File& file);
+    void removeFolder (const juce::File& folder);
+};
+
+//==============================================================================
+class LibraryWatcher  : private juce::Thread
+{
+public:
+    // Called on the watcher thread once events have settled for `settleMs`, and at most once per
+    // `batchIntervalMs`: each batch rebuilds the index's orders and search, so a steady trickle of
+    // files is gathered into one update a second instead of one per file.
+    using Callback = std::function<void (const LibraryChanges&)>;
+
+    LibraryWatcher (const juce::File& root, Callback onChanges);
+    ~LibraryWatcher() override;
+
+    static bool isSupported() noexcept;
+
+    static constexpr int settleMs = 200;
+    static constexpr int batchIntervalMs = 1000;
+
+private:
+    void run() override;
+
+   #if JUCE_LINUX
+    void watchTree (const juce::File& folder, LibraryChanges* addFilesTo);
+    void unwatchTree (const juce::File& folder);
+    void readEvents (LibraryChanges& pending);
+
+    int fd = -1;
+    std::map<int, juce::File> folders;          // watch descriptor -> folder
+   #endif
+
+    const juce::File root;
+    Callback onChanges;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryWatcher)
+};
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    MemoryBudget.cpp
+
+  ==============================================================================
+*/
+
+#include "MemoryBudget.h"
+
+MemoryBudget::MemoryBudget()
+    : cap (getCapForChoice (defaultCapChoice))
+{
+}
+
+void MemoryBudget::addClient (const void* client, juce::int64 bytes)
+{
+    const juce::SpinLock::ScopedLockType sl (requestLock);
+    requests[client] = bytes;
+    applyRequests();
+}
+
+void MemoryBudget::requestCap (const void* client, juce::int64 bytes) noexcept
+{
+    const juce::SpinLock::ScopedLockType sl (requestLock);
+    auto found = requests.find (client);
+
+    if (found == requests.end())
+        return;
+
+    found->second = bytes;
+    applyRequests();
+}
+
+void MemoryBudget::removeClient (const void* client)
+{
+    const juce::SpinLock::ScopedLockType sl (requestLock);
+    requests.erase (client);
+
+    // The last one gone leaves the cap where it was, for whatever outlives it.
+    if (! requests.empty())
+        applyRequests();
+}
+
+void MemoryBudget::applyRequests() noexcept
+{
+    juce::int64 largest = 0;
+
+    for (auto& request : requests)
+        largest = juce::jmax (largest, request.second);
+
+    setCap (largest);
+}
+
+juce::int64 MemoryBudget::getTotalBytes() const noexcept
+{
+    juce::int64 total = 0;
+
+    for (auto& pool : pools)
+        total += pool.bytes.load (std::memory_order_relaxed);
+
+    return total;
+}
+
+juce::int64 MemoryBudget::getLimit (Pool pool) const noexcept
+{
+    const auto capBytes = getCap();
+    const auto others = getTotalBytes() - getBytes (pool);
+    const auto quota = (juce::int64) ((double) capBytes * getQuota (pool));
+
+    return juce::jmax (quota, capBytes - others);
+}
+
+//==============================================================================
+MemoryBudget::Stats MemoryBudget::getStats() const noexcept
+{
+    Stats stats;
+    stats.cap = getCap();
+    stats.total = getTotalBytes();
+
+    for (int i = 0; i < numPools; ++i)
+    {
+        auto& s = stats.pools[i];
+        s.name   = getPoolName ((Pool) i);
+        s.bytes  = getBytes ((Pool) i);
+        s.limit  = getLimit ((Pool) i);
+        s.quota  = (juce::int64) ((double) stats.cap * getQuota ((Pool) i));
+        s.hits   = pools[i].hits.load (std::memory_order_relaxed);
+        s.misses = pools[i].misses.load (std::memory_order_relaxed);
+    }
+
+    return stats;
+}
+
+juce::String MemoryBudget::toJSON (const Stats& stats)
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("capBytes", stats.cap);
+    root->setProperty ("totalBytes", stats.total);
+
+    auto* pools = new juce::DynamicObject();
+
+    for (auto& s : stats.pools)
+    {
+        auto* pool = new juce::DynamicObject();
+        pool->setProperty ("bytes", s.bytes);
+        pool->setProperty ("limit", s.limit);
+        pool->setProperty ("quota", s.quota);
+        pool->setProperty ("hits", (juce::int64) s.hits);
+        pool->setProperty ("misses", (juce::int64) s.misses);
+        pool->setProperty ("hitRate", s.getHitRate());
+        pools->setProperty (s.name, juce::var (pool));
+    }
+
+    root->setProperty ("pools", juce::var (pools));
+    return juce::JSON::toString (juce::var (root), true);
+}
+
+//==============================================================================
+const char* MemoryBudget::getPoolName (Pool pool) noexcept
+{
+    switch (pool)
+    {
+        case previews:      return "previews";
+        case thumbnails:    return "thumbnails";
+        case sampleBanks:   return "sampleBanks";
+        case granularBeds:  return "granularBeds";
+        case numPools:
+        default:            return "";
+    }
+}
+
+float MemoryBudget::getQuota (Pool pool) noexcept
+{
+    switch (pool)
+    {
+        case previews:      return 0.25f;
+        case thumbnails:    return 0.05f;
+        case sampleBanks:   return 0.45f;
+        case granularBeds:  return 0.25f;
+        case numPools:
+        default:            return 0.0f;
+    }
+}
+
+juce::StringArray MemoryBudget::getCapNames()
+{
+    return { "128 MB", "256 MB", "512 MB", "1 GB", "2 GB" };
+}
+
+juce::int64 MemoryBudget::getCapForChoice (int choice) noexcept
+{
+    return (juce::int64) 128 * megabyte << juce::jlimit (0, numCapChoices - 1, choice);
+}
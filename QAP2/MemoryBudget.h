@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    MemoryBudget.h
+    One RAM budget for every cache of audio data in the process, shared by
+    all plugin instances through juce::SharedResourcePointer. Each pool has
+    a quota, the share of the cap it can always use, and may grow past it
+    into memory the other pools leave free. Caches account their bytes here
+    and trim themselves, on their own threads, whenever their pool is over
+    its limit: the budget itself never frees anything.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <unordered_map>
+
+class MemoryBudget
+{
+public:
+    enum Pool
+    {
+        previews,       // LibraryService: whole files kept in memory for audition; AuditionEngine read-ahead
+        thumbnails,     // LibraryService: finished waveform thumbnails
+        sampleBanks,    // SampleBank variations of every model in every instance
+        granularBeds,   // GranularBed sources
+        numPools
+    };
+
+    static constexpr juce::int64 megabyte = 1024 * 1024;
+    static constexpr const char* capParameterId = "memoryCap";
+
+    MemoryBudget();
+
+    //==============================================================================
+    // Any thread, lock-free
+    void setCap (juce::int64 bytes) noexcept                { cap.store (juce::jmax ((juce::int64) 0, bytes), std::memory_order_relaxed); }
+    juce::int64 getCap() const noexcept                     { return cap.load (std::memory_order_relaxed); }
+
+    // The cap as the instances ask for it: the largest request of the clients alive. A client is
+    // added on the message thread; requestCap only updates its entry, so it never allocates.
+    void addClient (const void* client, juce::int64 bytes);
+    void requestCap (const void* client, juce::int64 bytes) noexcept;
+    void removeClient (const void* client);
+
+    void add (Pool pool, juce::int64 bytes) noexcept        { pools[pool].bytes.fetch_add (bytes, std::memory_order_relaxed); }
+    juce::int64 getBytes (Pool pool) const noexcept         { return pools[pool].bytes.load (std::memory_order_relaxed); }
+    juce::int64 getTotalBytes() const noexcept;
+
+    // What `pool` may hold now: its quota, or more while the other pools leave room.
+    juce::int64 getLimit (Pool pool) const noexcept;
+    bool canGrow (Pool pool, juce::int64 bytes) const noexcept  { return getBytes (pool) + bytes <= getLimit (pool); }
+    bool isOverLimit (Pool pool) const noexcept                 { return getBytes (pool) > getLimit (pool); }
+
+    void noteHit (Pool pool) noexcept                       { pools[pool].hits.fetch_add (1, std::memory_order_relaxed); }
+    void noteMiss (Pool pool) noexcept                      { pools[pool].misses.fetch_add (1, std::memory_order_relaxed); }
+
+    //==============================================================================
+    struct PoolStats
+    {
+        const char* name = nullptr;
+        juce::int64 bytes = 0, limit = 0, quota = 0;
+        juce::uint64 hits = 0, misses = 0;
+
+        double getHitRate() const noexcept  { return hits + misses > 0 ? (double) hits / (double) (hits + misses) : 0.0; }
+    };
+
+    struct Stats
+    {
+        juce::int64 cap = 0, total = 0;
+        PoolStats pools[numPools];
+    };
+
+    Stats getStats() const noexcept;
+    static juce::String toJSON (const Stats& stats);
+
+    static const char* getPoolName (Pool pool) noexcept;
+    static float getQuota (Pool pool) noexcept;
+
+    // Choices of the non-automatable "Memory" parameter. Each instance asks for one; the cap is
+    // the largest one a live instance asks for, so no instance shrinks the budget under another.
+    static juce::StringArray getCapNames();
+    static juce::int64 getCapForChoice (int choice) noexcept;
+    static constexpr int numCapChoices = 5, defaultCapChoice = 2;
+
+private:
+    struct PoolState
+    {
+        std::atomic<juce::int64> bytes { 0 };
+        std::atomic<juce::uint64> hits { 0 }, misses { 0 };
+    };
+
+    void applyRequests() noexcept;     // under requestLock
+
+    std::atomic<juce::int64> cap;
+    PoolState pools[numPools];
+
+    juce::SpinLock requestLock;
+    std::map<const void*, juce::int64> requests;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MemoryBudget)
+};
+
+//==============================================================================
+// Adaptive replacement cache (Megiddo and Modha), sized in bytes. Entries seen once (t1) and
+// entries seen again (t2) share the limit; ghost lists of recently evicted keys tell which of
+// the two would have hit, and the split moves towards it. Stepping through a folder once does
+// not flush the files that are auditioned over and over. Every key, resident or ghost, is found
+// through one hash map, so each call costs the same however many entries there are.
+// Not thread-safe.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ArcCache
+{
+public:
+    ArcCache() = default;
+
+    // Nullptr on a miss. A hit moves the entry to the frequent list.
+    const Value* find (const Key& key)
+    {
+        auto found = locations.find (key);
+
+        if (found == locations.end() || ! isResident (found->second.list))
+            return nullptr;
+
+        auto& location = found->second;
+
+        if (location.list == &t1)
+        {
+            t1Bytes -= location.entry->bytes;
+            t2Bytes += location.entry->bytes;
+        }
+
+        t2.splice (t2.end(), *location.list, location.entry);
+        location.list = &t2;
+        return &location.entry->value;
+    }
+
+    // After a miss. A remembered key adapts the split and goes straight to the frequent list.
+    // Call trim() afterwards.
+    void insert (const Key& key, Value value, juce::int64 bytes, juce::int64 limit)
+    {
+        auto found = locations.find (key);
+        bool frequent = false;
+
+        if (found != locations.end())
+        {
+            auto& location = found->second;
+            jassert (! isResident (location.list));     // only after a miss
+
+            if (location.list == &b1)
+            {
+                target = juce::jmin (limit, target + (juce::int64) ((double) bytes * juce::jmax (1.0, (double) b2Bytes / (double) b1Bytes)));
+                b1Bytes -= location.entry->bytes;
+            }
+            else
+            {
+                target = juce::jmax ((juce::int64) 0, target - (juce::int64) ((double) bytes * juce::jmax (1.0, (double) b1Bytes / (double) b2Bytes)));
+                b2Bytes -= location.entry->bytes;
+            }
+
+            location.list->erase (location.entry);
+            locations.erase (found);
+            frequent = true;
+        }
+
+        auto& list = frequent ? t2 : t1;
+        list.push_back ({ key, std::move (value), bytes });
+        (frequent ? t2Bytes : t1Bytes) += bytes;
+        locations[key] = { &list, std::prev (list.end()) };
+    }
+
+    // Evicts until the entries fit in `limit`, keeping the ghosts to about the same size.
+    void trim (juce::int64 limit)
+    {
+        while (t1Bytes + t2Bytes > limit && ! (t1.empty() && t2.empty()))
+        {
+            const bool fromRecent = ! t1.empty() && (t1Bytes > target || t2.empty());
+            auto& from = fromRecent ? t1 : t2;
+            auto& ghosts = fromRecent ? b1 : b2;
+            const auto bytes = from.front().bytes;
+
+            (fromRecent ? t1Bytes : t2Bytes) -= bytes;
+            (fromRecent ? b1Bytes : b2Bytes) += bytes;
+            from.front().value = {};
+            locations[from.front().key].list = &ghosts;
+            ghosts.splice (ghosts.end(), from, from.begin());
+        }
+
+        while (! b1.empty() && t1Bytes + b1Bytes > limit)
+            popGhost (b1, b1Bytes);
+
+        while (! b2.empty() && t1Bytes + t2Bytes + b1Bytes + b2Bytes > 2 * limit)
+            popGhost (b2, b2Bytes);
+    }
+
+    juce::int64 getBytes() const noexcept   { return t1Bytes + t2Bytes; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;            // empty in the ghost lists
+        juce::int64 bytes;
+    };
+
+    using List = std::list<Entry>;  // least recently used first
+
+    // List iterators survive splicing, so an entry keeps its location as it moves between lists.
+    struct Location
+    {
+        List* list;
+        typename List::iterator entry;
+    };
+
+    bool isResident (const List* list) const noexcept   { return list == &t1 || list == &t2; }
+
+    void popGhost (List& list, juce::int64& bytes)
+    {
+        bytes -= list.front().bytes;
+        locations.erase (list.front().key);
+        list.pop_front();
+    }
+
+    List t1, t2, b1, b2;
+    std::unordered_map<Key, Location, Hash> locations;
+    juce::int64 t1Bytes = 0, t2Bytes = 0, b1Bytes = 0, b2Bytes = 0;
+    juce::int64 target = 0;         // bytes t1 should hold
+
+    JUCE_DECLARE_NON_COPYABLE (ArcCache)    // locations point at its own lists
+};
@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    ModelPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "ModelPanel.h"
+#include "PluginEditor.h"
+
+ModelPanel::TakeHandle::TakeHandle (QAPAudioProcessor& p, ProceduralModel& m)
+    : processor (p), model (m)
+{
+    setMouseCursor(juce::MouseCursor::DraggingHandCursor);
+    setTooltip("Drag a rendered take into the DAW");
+}
+
+ModelPanel::TakeHandle::~TakeHandle()
+{
+    if (! handedOut)
+        take.deleteFile();
+}
+
+void ModelPanel::TakeHandle::paint (juce::Graphics& g)
+{
+    g.setColour(findColour(juce::TextButton::buttonColourId));
+    g.fillRoundedRectangle(getLocalBounds().toFloat(), 4.0f);
+    g.setColour(findColour(juce::TextButton::textColourOffId));
+    g.drawText(rendering ? "Rendering take..." : "Drag take", getLocalBounds(), juce::Justification::centred);
+}
+
+std::vector<float> ModelPanel::TakeHandle::getValues() const
+{
+    std::vector<float> values (model.getParameterSpecs().size());
+
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = model.getParameter((int) i);
+
+    return values;
+}
+
+void ModelPanel::TakeHandle::prepareTake()
+{
+    if (rendering || (take.existsAsFile() && takeValues == getValues()))
+        return;
+
+    rendering = true;
+    repaint();
+
+    processor.renderTakeAsync(model.getId(), [safeThis = juce::Component::SafePointer<TakeHandle> (this), values = getValues()] (juce::File file)
+        {
+        if (auto* handle = safeThis.getComponent())
+            handle->takeRendered(file, values);
+        else
+            file.deleteFile();
+        });
+}
+
+void ModelPanel::TakeHandle::takeRendered (const juce::File& file, std::vector<float> values)
+{
+    if (! handedOut)
+        take.deleteFile();
+
+    take = file;
+    takeValues = std::move(values);
+    rendering = false;
+    handedOut = false;
+    repaint();
+
+    // The sliders moved while it rendered.
+    if (isMouseOver() && takeValues != getValues())
+        prepareTake();
+}
+
+void ModelPanel::TakeHandle::mouseEnter (const juce::MouseEvent&)
+{
+    prepareTake();
+}
+
+void ModelPanel::TakeHandle::mouseDown (const juce::MouseEvent&)
+{
+    prepareTake();
+}
+
+void ModelPanel::TakeHandle::mouseDrag (const juce::MouseEvent& e)
+{
+    // Until the take is ready the drag waits; the next move after that starts it.
+    if (dragging || rendering || e.getDistanceFromDragStart() < 6 || ! take.existsAsFile())
+        return;
+
+    dragging = true;
+
+    QAPAudioProcessorEditor::dragFilesOut({ take.getFullPathName() }, *this,
+                                          [safeThis = juce::Component::SafePointer<TakeHandle> (this), dropped = take]
+        {
+        if (auto* handle = safeThis.getComponent())
+            if (handle->take == dropped)
+                handle->handedOut = true;
+        });
+}
+
+void ModelPanel::TakeHandle::mouseUp (const juce::MouseEvent&)
+{
+    dragging = false;
+}
+
+//==============================================================================
+ModelPanel::ModelPanel (QAPAudioProcessor& processor, ProceduralModel& m)
+    : model (m), group (juce::String (m.getId()) + "Panel", m.getDisplayName()),
+      takeHandle (processor, m)
+{
+    addAndMakeVisible(group);
+
+    addAndMakeVisible(triggerButton);
+    triggerButton.setButtonText(model.getTriggerLabel());
+    triggerButton.onClick = [&processor, id = juce::String (model.getId())]() { processor.triggerModel(id); };
+
+    addAndMakeVisible(sequenceText);
+    sequenceText.setTextToShowWhenEmpty("every 1.5 s", juce::Colours::grey);
+    sequenceText.setTooltip("Repeat the trigger: \"every 1.5 s\", \"bar 3 beat 2 every 1.5 s x 8\" (synced to the host)");
+
+    addAndMakeVisible(takeHandle);
+
+    addAndMakeVisible(sequenceButton);
+    sequenceButton.setClickingTogglesState(true);
+    sequenceButton.onClick = [this, &processor, id = juce::String (model.getId())]()
+        {
+        processor.stopSequences(id);
+
+        if (sequenceButton.getToggleState())
+            processor.startSequence(id, TriggerScheduler::Sequence::parse(sequenceText.getText()));
+        };
+
+    for (auto& spec : model.getParameterSpecs())
+    {
+        if (! spec.showInPanel)
+            continue;
+
+        auto* slider = sliders.add(new juce::Slider());
+        slider->setSliderStyle(juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
+        addAndMakeVisible(slider);
+
+        auto* label = labels.add(new juce::Label({}, spec.name));
+        label->attachToComponent(slider, true);
+
+        attachments.add(new juce::AudioProcessorValueTreeState::SliderAttachment(processor.parameters, spec.id, *slider));
+    }
+}
+
+void ModelPanel::resized()
+{
+    const int sliderH   = 40;
+    const int spacing   = 16;
+    const int labelW    = 70;
+
+    group.setBounds(getLocalBounds());
+
+    int y = 30;
+    triggerButton.setBounds(10, y, getWidth() - 20, sliderH);
+    y += sliderH + spacing;
+
+    sequenceButton.setBounds(getWidth() - 80, y, 70, 24);
+    sequenceText.setBounds(10, y, sequenceButton.getX() - 20, 24);
+    y += 24 + spacing;
+
+    takeHandle.setBounds(10, y, getWidth() - 20, 24);
+    y += 24 + spacing;
+
+    for (auto* slider : sliders)
+    {
+        slider->setBounds(10 + labelW, y, getWidth() - 20 - labelW, sliderH);
+        y += sliderH + spacing;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    ModelPanel.h
+    Editor panel generated from a ProceduralModel's description: a trigger
+    button, a repeating-sequence row, a handle to drag a rendered take out
+    to the DAW and one attached slider per parameter marked showInPanel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class ModelPanel  : public juce::Component
+{
+public:
+    ModelPanel (QAPAudioProcessor& processor, ProceduralModel& model);
+
+    const ProceduralModel& getModel() const noexcept    { return model; }
+
+    void resized() override;
+
+private:
+    // Renders a take in the background as soon as the mouse comes over the handle, and lets it
+    // be dragged to the OS once the file is ready. A take is re-rendered when the sliders moved.
+    class TakeHandle  : public juce::Component,
+                        public juce::SettableTooltipClient
+    {
+    public:
+        TakeHandle (QAPAudioProcessor& processor, ProceduralModel& model);
+        ~TakeHandle() override;
+
+        void paint (juce::Graphics&) override;
+        void mouseEnter (const juce::MouseEvent&) override;
+        void mouseDown (const juce::MouseEvent&) override;
+        void mouseDrag (const juce::MouseEvent&) override;
+        void mouseUp (const juce::MouseEvent&) override;
+
+    private:
+        std::vector<float> getValues() const;
+        void prepareTake();
+        void takeRendered (const juce::File& file, std::vector<float> values);
+
+        QAPAudioProcessor& processor;
+        ProceduralModel& model;
+        juce::File take;                    // the latest take, if any
+        std::vector<float> takeValues;      // slider values it was rendered with
+        bool rendering = false, dragging = false;
+        bool handedOut = false;             // `take` was dropped somewhere, so it is not ours to delete
+    };
+
+    ProceduralModel& model;
+
+    juce::GroupComponent group;
+    juce::TextButton triggerButton;
+    juce::TextEditor sequenceText;          // e.g. "bar 3 beat 2 every 1.5 s", see TriggerScheduler::Sequence::parse
+    juce::TextButton sequenceButton {"Repeat"};
+    TakeHandle takeHandle;
+    juce::OwnedArray<juce::Slider> sliders;
+    juce::OwnedArray<juce::Label> labels;
+    juce::OwnedArray<juce::AudioProcessorValueTreeState::SliderAttachment> attachments;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModelPanel)
+};
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    ModelRegistry.cpp
+
+  ==============================================================================
+*/
+
+#include "ModelRegistry.h"
+#include "ProceduralModels.h"
+
+ModelRegistry::ModelRegistry()
+{
+    add (std::make_unique<ExplosionModel>());
+    add (std::make_unique<FireModel>());
+}
+
+void ModelRegistry::add (std::unique_ptr<ProceduralModel> model)
+{
+    jassert (model != nullptr && size() < maxModels);
+    jassert (indexOf (model->getId()) < 0); // model IDs must be unique
+
+    model->slot = size();
+    models.add (model.release());
+}
+
+int ModelRegistry::indexOf (const juce::String& id) const noexcept
+{
+    for (int i = 0; i < models.size(); ++i)
+        if (id == models.getUnchecked (i)->getId())
+            return i;
+
+    return -1;
+}
+
+ProceduralModel* ModelRegistry::find (const juce::String& id) const noexcept
+{
+    auto index = indexOf (id);
+    return index >= 0 ? models.getUnchecked (index) : nullptr;
+}
+
+void ModelRegistry::addParametersTo (std::vector<std::unique_ptr<juce::RangedAudioParameter>>& layout) const
+{
+    for (auto* model : models)
+        for (auto& spec : model->getParameterSpecs())
+            layout.push_back (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { spec.id, 1 }, spec.name,
+                                                                           spec.minValue, spec.maxValue, spec.defaultValue));
+
+    layout.push_back (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { bakedParameterId, 1 }, "Baked Models", false,
+                                                                  juce::AudioParameterBoolAttributes().withAutomatable (false)));
+
+    layout.push_back (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { oversamplingParameterId, 1 }, "Oversampling",
+                                                                    Oversampler::getFactorNames(), 0,
+                                                                    juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+    layout.push_back (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { renderQualityParameterId, 1 }, "Render Quality",
+                                                                    Oversampler::getFactorNames(), 3,
+                                                                    juce::AudioParameterChoiceAttributes().withAutomatable (false)));
+}
+
+int ModelRegistry::getOversamplingFactor (const juce::AudioProcessorValueTreeState& state, bool nonRealtime)
+{
+    auto* choice = state.getRawParameterValue (nonRealtime ? renderQualityParameterId : oversamplingParameterId);
+    return choice != nullptr ? Oversampler::factorForChoice (juce::roundToInt (choice->load())) : 1;
+}
+
+void ModelRegistry::bindParameters (juce::AudioProcessorValueTreeState& state)
+{
+    for (auto* model : models)
+    {
+        model->boundParameters.clear();
+
+        for (auto& spec : model->getParameterSpecs())
+        {
+            auto* value = state.getRawParameterValue (spec.id);
+            jassert (value != nullptr);
+            model->boundParameters.push_back (value);
+        }
+
+        model->bakedFlag = state.getRawParameterValue (bakedParameterId);
+    }
+}
+
+void ModelRegistry::prepare (double sampleRate, int maximumBlockSize, int newOversampling)
+{
+    oversampling = newOversampling;
+
+    for (auto* model : models)
+    {
+        model->oversampler.prepare (oversampling, ProceduralModel::numChannels, juce::jmax (ProceduralRenderer::subBlockSize, maximumBlockSize));
+        model->prepare (sampleRate, maximumBlockSize);
+    }
+}
+
+void ModelRegistry::release()
+{
+    for (auto* model : models)
+        model->release();
+}
+
+void ModelRegistry::bakedModeChanged()
+{
+    for (auto* model : models)
+        model->bakedModeChanged();
+}
+
+double ModelRegistry::getLongestTailSeconds() const
+{
+    double tail = 0.0;
+
+    for (auto* model : models)
+        tail = juce::jmax (tail, model->getTailSeconds());
+
+    return tail;
+}
+
+int ModelRegistry::collectAwake (const ActivityTracker& activity) noexcept
+{
+    int numAwake = 0;
+
+    for (auto* model : models)
+        if (activity.isAwake (model->getActivitySource()))
+            awake[(size_t) numAwake++] = model;
+
+    return numAwake;
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    ModelRegistry.h
+    Every procedural model (Explosion, Fire, ...) declares its parameters,
+    its panel and its render callback once, by implementing ProceduralModel.
+    The processor, the parameter layout and the editor are all driven from
+    the registry, so adding a model means adding one class.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "ProceduralRenderer.h"
+#include "ActivityTracker.h"
+
+struct ModelParameterSpec
+{
+    const char* id;
+    const char* name;
+    float minValue;
+    float maxValue;
+    float defaultValue;
+    bool showInPanel;
+};
+
+//==============================================================================
+class ProceduralModel
+{
+public:
+    virtual ~ProceduralModel() = default;
+
+    // Description, used for the parameter layout, the editor panel and the assistant
+    virtual const char* getId() const = 0;
+    virtual juce::String getDisplayName() const = 0;
+    virtual juce::String getTriggerLabel() const = 0;
+    virtual juce::String getAssistantText() const = 0;
+    virtual juce::StringArray getSearchKeywords() const = 0;
+    virtual const std::vector<ModelParameterSpec>& getParameterSpecs() const = 0;
+
+    // Audio thread, at the sample the TriggerScheduler placed the event on.
+    virtual void trigger() = 0;
+
+    // How far each event of a repeating sequence may stray from its slot, as a
+    // fraction of half the interval.
+    virtual float getSequenceJitter() const noexcept    { return 0.0f; }
+
+    // How long the model can keep sounding after it was last triggered.
+    virtual double getTailSeconds() const   { return 0.0; }
+
+    virtual void prepare (double sampleRate, int maximumBlockSize) = 0;
+    virtual void release() {}
+
+    // Audio thread
+    virtual bool isActive() = 0;
+    virtual float render (ProceduralRenderer& renderer, juce::AudioBuffer<float>& output, int startSample, int numSamples) = 0;
+
+    // True while a continuous model plays until it is stopped. Such a model is never put to
+    // sleep for being silent (its sliders may bring it back); it skips its own work instead.
+    virtual bool isSustained() const noexcept   { return false; }
+
+    // Message thread: renders one take with the current slider values on a private instance,
+    // streaming it into `writer` chunk by chunk at `oversampling` times the rate. Continuous
+    // models play `seconds` and fade out; one-shots ring out. False if there is no take to give.
+    virtual bool renderTake (juce::AudioFormatWriter&, double /*sampleRate*/, int /*oversampling*/, double /*seconds*/)  { return false; }
+
+    // Baked mode: models that can play pre-rendered material instead of rendering live
+    // report here whether it is complete for the current slider values.
+    virtual bool isBakedReady() const noexcept      { return false; }
+
+    // Any thread: the baked-mode switch moved. Models with a render thread wake it here; it
+    // sleeps while the mode is off and nothing it rendered is left.
+    virtual void bakedModeChanged() {}
+
+    //==============================================================================
+    int getSlot() const noexcept                    { return slot; }
+    int getActivitySource() const noexcept          { return ActivityTracker::firstModel + slot; }
+    float getParameter (int specIndex) const noexcept   { return boundParameters[(size_t) specIndex]->load (std::memory_order_relaxed); }
+    bool isBakedModeOn() const noexcept     { return bakedFlag != nullptr && bakedFlag->load (std::memory_order_relaxed) >= 0.5f; }
+
+    // fillBuffer is always handed this many channels, live, baking and for takes alike, whatever
+    // the host's layout. The models are mono: channel 0 is their output.
+    static constexpr int numChannels = 2;
+
+    // Models initialise at the host rate times this and render through getOversampler().
+    int getOversampling() const noexcept            { return oversampler.getFactor(); }
+    Oversampler& getOversampler() noexcept          { return oversampler; }
+
+private:
+    friend class ModelRegistry;
+
+    int slot = -1;
+    std::vector<std::atomic<float>*> boundParameters;
+    const std::atomic<float>* bakedFlag = nullptr;
+    Oversampler oversampler;
+};
+
+//==============================================================================
+class ModelRegistry
+{
+public:
+    static constexpr int maxModels = ActivityTracker::maxSources - ActivityTracker::firstModel;
+
+    // Switches every model that supports it between live rendering and baked playback.
+    static constexpr const char* bakedParameterId = "bakedModels";
+
+    // Oversampling of the live models: one factor while playing, a higher one for offline renders.
+    static constexpr const char* oversamplingParameterId = "oversampling";
+    static constexpr const char* renderQualityParameterId = "renderQuality";
+    static int getOversamplingFactor (const juce::AudioProcessorValueTreeState& state, bool nonRealtime);
+
+    // Registers the built-in models (see ProceduralModels.cpp).
+    ModelRegistry();
+
+    void add (std::unique_ptr<ProceduralModel> model);
+
+    int size() const noexcept                               { return models.size(); }
+    ProceduralModel& operator[] (int index) const noexcept  { return *models.getUnchecked (index); }
+    int indexOf (const juce::String& id) const noexcept;
+    ProceduralModel* find (const juce::String& id) const noexcept;
+
+    void addParametersTo (std::vector<std::unique_ptr<juce::RangedAudioParameter>>& layout) const;
+    void bindParameters (juce::AudioProcessorValueTreeState& state);
+    void prepare (double sampleRate, int maximumBlockSize, int oversampling);
+    void release();
+    void bakedModeChanged();
+    int getOversampling() const noexcept                    { return oversampling; }
+    double getLongestTailSeconds() const;
+
+    // Audio thread: gathers the awake models into a small contiguous array, so
+    // the render loop only touches models that actually produce sound.
+    int collectAwake (const ActivityTracker& activity) noexcept;
+    ProceduralModel* getAwake (int index) const noexcept    { return awake[(size_t) index]; }
+
+private:
+    juce::OwnedArray<ProceduralModel> models;
+    std::array<ProceduralModel*, (size_t) maxModels> awake {};
+    int oversampling = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModelRegistry)
+};
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    Oversampler.cpp
+
+  ==============================================================================
+*/
+
+#include "Oversampler.h"
+
+namespace
+{
+    // Zeroth-order modified Bessel function, for the Kaiser window.
+    double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+void HalfbandDecimator::design (int halfLength, float kaiserBeta)
+{
+    // h[n], n = 0 .. 4K-2, centred on M = 2K-1: h[M] = 1/2, zero at even distances from M,
+    // windowed sinc at odd ones. Those odd-distance taps sit at even n: the even branch.
+    const int centre = 2 * halfLength - 1;
+    const double denominator = besselI0 (kaiserBeta);
+
+    evenTaps.resize ((size_t) (2 * halfLength));
+    double sum = 0.0;
+
+    for (int j = 0; j < 2 * halfLength; ++j)
+    {
+        const int distance = 2 * j - centre;
+        const double x = juce::MathConstants<double>::pi * distance / 2.0;
+        const double ratio = (double) distance / (double) centre;
+        const double window = besselI0 (kaiserBeta * std::sqrt (juce::jmax (0.0, 1.0 - ratio * ratio))) / denominator;
+        const double tap = 0.5 * std::sin (x) / x * window;
+
+        evenTaps[(size_t) j] = (float) tap;
+        sum += tap;
+    }
+
+    // Unity gain at DC: the even branch sums to 1/2, the centre tap is the other half.
+    for (auto& tap : evenTaps)
+        tap = (float) (tap * 0.5 / sum);
+
+    evenLine.assign (evenTaps.size() * 2, 0.0f);
+    oddLine.assign ((size_t) halfLength, 0.0f);
+    reset();
+}
+
+void HalfbandDecimator::reset() noexcept
+{
+    std::fill (evenLine.begin(), evenLine.end(), 0.0f);
+    std::fill (oddLine.begin(), oddLine.end(), 0.0f);
+    evenPos = oddPos = 0;
+}
+
+void HalfbandDecimator::process (float* data, int numOutput) noexcept
+{
+    const int length = (int) evenTaps.size();
+    const int delay = (int) oddLine.size();
+    const float* taps = evenTaps.data();
+
+    for (int m = 0; m < numOutput; ++m)
+    {
+        // Newest first, so the taps line up with one contiguous read.
+        evenPos = (evenPos == 0 ? length : evenPos) - 1;
+        evenLine[(size_t) evenPos] = evenLine[(size_t) (evenPos + length)] = data[2 * m];
+
+        const float* line = evenLine.data() + evenPos;
+        float sum = 0.0f;
+
+        for (int j = 0; j < length; ++j)
+            sum += taps[j] * line[j];
+
+        const float delayed = oddLine[(size_t) oddPos];
+        oddLine[(size_t) oddPos] = data[2 * m + 1];
+        oddPos = (oddPos + 1 == delay) ? 0 : oddPos + 1;
+
+        data[m] = sum + 0.5f * delayed;
+    }
+}
+
+//==============================================================================
+void Oversampler::prepare (int newFactor, int numChannels, int maximumBlockSize)
+{
+    factor = juce::jlimit (1, maxFactor, juce::nextPowerOfTwo (juce::jmax (1, newFactor)));
+    capacity = juce::jmax (1, maximumBlockSize);
+    stages.clear();
+
+    if (factor == 1)
+    {
+        buffer.setSize (0, 0);
+        channelPointers.clear();
+        return;
+    }
+
+    // The last stage, down to the host rate, needs the steep transition band. The ones
+    // above it only have to keep their top quarter from folding onto the host band.
+    for (int rate = factor; rate > 1; rate /= 2)
+    {
+        HalfbandDecimator stage;
+
+        if (rate == 2)
+            stage.design (lastStageHalfLength, 8.0f);      // 47 taps, about -80 dB
+        else
+            stage.design (upperStageHalfLength, 8.0f);     // 23 taps
+
+        stages.push_back (std::move (stage));
+    }
+
+    buffer.setSize (juce::jmax (1, numChannels), capacity * factor);
+    channelPointers.resize ((size_t) buffer.getNumChannels());
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        channelPointers[(size_t) ch] = buffer.getWritePointer (ch);
+}
+
+double Oversampler::getLatencySamples (int factor) noexcept
+{
+    double latency = 0.0;
+
+    for (int rate = factor; rate > 1; rate /= 2)
+        latency += HalfbandDecimator::getDelay (rate == 2 ? lastStageHalfLength : upperStageHalfLength) / (double) rate;
+
+    return latency;
+}
+
+void Oversampler::release()
+{
+    stages.clear();
+    buffer.setSize (0, 0);
+    channelPointers.clear();
+    factor = 1;
+    capacity = 0;
+}
+
+float** Oversampler::getInput (int numSamples) noexcept
+{
+    jassert (numSamples <= capacity);
+    buffer.clear (0, numSamples * factor);
+    return channelPointers.data();
+}
+
+void Oversampler::decimate (float* output, int numSamples) noexcept
+{
+    auto* data = channelPointers[0];
+    int length = numSamples * factor;
+
+    for (auto& stage : stages)
+    {
+        length /= 2;
+        stage.process (data, length);
+    }
+
+    juce::FloatVectorOperations::copy (output, data, numSamples);
+}
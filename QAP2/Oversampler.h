@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    Oversampler.h
+    Runs a procedural model at 2x, 4x or 8x the host rate and brings it back
+    down through a cascade of polyphase halfband FIR decimators, so the
+    models' nonlinear stages (grit, crackle) do not alias. The models only
+    generate, so there is no upsampling half.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// One 2:1 stage: a linear-phase halfband FIR, split into its two polyphase
+// branches. Every other tap is zero and the odd branch is a single tap, so a
+// stage costs about half a multiply-add per tap and output sample.
+class HalfbandDecimator
+{
+public:
+    // `halfLength` nonzero taps per side: 4 * halfLength - 1 taps in total.
+    void design (int halfLength, float kaiserBeta);
+    void reset() noexcept;
+
+    // Reads 2 * numOutput samples from `data` and writes numOutput back to its start.
+    void process (float* data, int numOutput) noexcept;
+
+    // Group delay in input samples: the centre tap of a linear-phase filter.
+    static int getDelay (int halfLength) noexcept       { return 2 * halfLength - 1; }
+
+private:
+    std::vector<float> evenTaps;        // the even branch, 2 * halfLength coefficients
+    std::vector<float> evenLine;        // twice as long, so the taps read it without wrapping
+    std::vector<float> oddLine;         // the odd branch is a pure delay of halfLength
+    int evenPos = 0, oddPos = 0;
+};
+
+//==============================================================================
+class Oversampler
+{
+public:
+    static constexpr int maxFactor = 8;
+
+    // Choices of the oversampling parameters, in order.
+    static juce::StringArray getFactorNames()           { return { "Off", "2x", "4x", "8x" }; }
+    static int factorForChoice (int choice) noexcept    { return 1 << juce::jlimit (0, 3, choice); }
+
+    // Delay the decimators add at `factor`, in host samples: 11.5 at 2x, 14.25 at 4x, 15.625 at 8x.
+    static double getLatencySamples (int factor) noexcept;
+
+    // Message thread. `maximumBlockSize` is at the host rate.
+    void prepare (int factor, int numChannels, int maximumBlockSize);
+    void release();
+
+    int getFactor() const noexcept                      { return factor; }
+
+    //==============================================================================
+    // Audio thread: cleared channels for numSamples * factor samples of the model...
+    float** getInput (int numSamples) noexcept;
+
+    // ...and channel 0 of them decimated into `output`, numSamples at the host rate.
+    void decimate (float* output, int numSamples) noexcept;
+
+private:
+    // Nonzero taps per side of the last stage, down to the host rate, and of the ones above it
+    static constexpr int lastStageHalfLength = 12, upperStageHalfLength = 6;
+
+    int factor = 1;
+    int capacity = 0;
+    juce::AudioBuffer<float> buffer;
+    std::vector<float*> channelPointers;
+    std::vector<HalfbandDecimator> stages;      // highest rate first
+};
@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    PathStore.cpp
+
+  ==============================================================================
+*/
+
+#include "PathStore.h"
+
+namespace
+{
+    void appendUTF8 (std::vector<char>& arena, std::vector<juce::uint32>& offsets, const juce::String& text)
+    {
+        arena.insert (arena.end(), text.toRawUTF8(), text.toRawUTF8() + text.getNumBytesAsUTF8());
+        offsets.push_back ((juce::uint32) arena.size());
+    }
+
+    void appendPart (juce::String& path, std::string_view part)
+    {
+        if (path.isNotEmpty() && ! path.endsWith (juce::File::getSeparatorString()))
+            path << juce::File::getSeparatorString();
+
+        path << juce::String::fromUTF8 (part.data(), (int) part.size());
+    }
+}
+
+//==============================================================================
+void PathStore::reserve (size_t numFiles)
+{
+    nameOffsets.reserve (numFiles + 1);
+    fileDirectories.reserve (numFiles);
+}
+
+int PathStore::add (const juce::File& file)
+{
+    const auto directory = internDirectory (file.getParentDirectory());
+    appendUTF8 (nameArena, nameOffsets, file.getFileName());
+    fileDirectories.push_back (directory);
+    directoryFiles[directory].push_back ((juce::uint32) size() - 1);
+    return size() - 1;
+}
+
+PathStore PathStore::withDirectoriesOnly() const
+{
+    PathStore copy;
+    copy.segmentArena = segmentArena;
+    copy.segmentOffsets = segmentOffsets;
+    copy.directoryParents = directoryParents;
+    copy.directoryIds = directoryIds;
+    copy.directoryFiles.resize (directoryFiles.size());
+    return copy;
+}
+
+int PathStore::addFrom (const PathStore& source, int id)
+{
+    const auto name = source.getName (id);
+    nameArena.insert (nameArena.end(), name.begin(), name.end());
+    nameOffsets.push_back ((juce::uint32) nameArena.size());
+    fileDirectories.push_back (source.getDirectory (id));
+    directoryFiles[source.getDirectory (id)].push_back ((juce::uint32) size() - 1);
+    return size() - 1;
+}
+
+juce::uint32 PathStore::internDirectory (const juce::File& directory)
+{
+    auto path = directory.getFullPathName();
+    auto found = directoryIds.find (path);
+
+    if (found != directoryIds.end())
+        return found->second;
+
+    // A root is its own parent.
+    auto parentDirectory = directory.getParentDirectory();
+    const bool isTop = parentDirectory == directory;
+    const auto parent = isTop ? noParent : internDirectory (parentDirectory);
+
+    appendUTF8 (segmentArena, segmentOffsets, isTop ? path : directory.getFileName());
+    directoryParents.push_back (parent);
+    directoryFiles.emplace_back();
+
+    const auto id = (juce::uint32) directoryParents.size() - 1;
+    directoryIds.emplace (path, id);
+    return id;
+}
+
+int PathStore::findDirectory (const juce::File& directory) const
+{
+    auto found = directoryIds.find (directory.getFullPathName());
+    return found != directoryIds.end() ? (int) found->second : -1;
+}
+
+//==============================================================================
+std::string_view PathStore::getName (int id) const noexcept
+{
+    const auto start = nameOffsets[(size_t) id];
+    return { nameArena.data() + start, nameOffsets[(size_t) id + 1] - start };
+}
+
+std::string_view PathStore::getSegment (juce::uint32 directory) const noexcept
+{
+    const auto start = segmentOffsets[directory];
+    return { segmentArena.data() + start, segmentOffsets[directory + 1] - start };
+}
+
+void PathStore::appendSegments (juce::String& path, juce::uint32 directory) const
+{
+    if (directoryParents[directory] != noParent)
+        appendSegments (path, directoryParents[directory]);
+
+    appendPart (path, getSegment (directory));
+}
+
+juce::String PathStore::getDirectoryPath (juce::uint32 directory) const
+{
+    juce::String path;
+    appendSegments (path, directory);
+    return path;
+}
+
+juce::String PathStore::getPath (int id) const
+{
+    auto path = getDirectoryPath (getDirectory (id));
+    appendPart (path, getName (id));
+    return path;
+}
+
+int PathStore::indexOf (const juce::File& file) const
+{
+    const auto directory = findDirectory (file.getParentDirectory());
+
+    if (directory < 0)
+        return -1;
+
+    const auto name = file.getFileName();
+    const std::string_view key (name.toRawUTF8(), name.getNumBytesAsUTF8());
+
+    for (auto id : directoryFiles[(size_t) directory])
+        if (getName ((int) id) == key)
+            return (int) id;
+
+    return -1;
+}
+
+std::vector<int> PathStore::indexOf (const juce::Array<juce::File>& files) const
+{
+    std::vector<int> ids ((size_t) files.size(), -1);
+    std::vector<juce::String> names ((size_t) files.size());
+    std::map<std::pair<juce::uint32, std::string_view>, size_t> wanted;
+    std::vector<bool> wantedDirectories (directoryParents.size(), false);
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        const auto directory = findDirectory (files.getReference (i).getParentDirectory());
+
+        if (directory < 0)
+            continue;
+
+        auto& name = names[(size_t) i] = files.getReference (i).getFileName();
+        wanted.emplace (std::make_pair ((juce::uint32) directory, std::string_view (name.toRawUTF8(), name.getNumBytesAsUTF8())), (size_t) i);
+        wantedDirectories[(size_t) directory] = true;
+    }
+
+    // Most files are skipped on their directory alone.
+    for (int id = 0; id < size() && ! wanted.empty(); ++id)
+    {
+        const auto directory = fileDirectories[(size_t) id];
+
+        if (! wantedDirectories[directory])
+            continue;
+
+        auto found = wanted.find ({ directory, getName (id) });
+
+        if (found != wanted.end() && ids[found->second] < 0)
+            ids[found->second] = id;
+    }
+
+    return ids;
+}
+
+size_t PathStore::getMemoryBytes() const noexcept
+{
+    size_t bytes = segmentArena.capacity() + nameArena.capacity()
+                 + (segmentOffsets.capacity() + directoryParents.capacity()
+                     + nameOffsets.capacity() + fileDirectories.capacity()) * sizeof (juce::uint32);
+
+    for (auto& entry : directoryIds)
+        bytes += sizeof (entry) + entry.first.getNumBytesAsUTF8() + 32;     // about what a map node costs
+
+    for (auto& files : directoryFiles)
+        bytes += sizeof (files) + files.capacity() * sizeof (juce::uint32);
+
+    return bytes;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    PathStore.h
+    File paths of a LibraryIndex without a juce::File per file. Directories
+    are interned in a trie, each node one path segment and its parent, so a
+    folder shared by a thousand files is stored once; a file is its
+    directory's ID plus its name in an arena, and its ID in its directory's
+    file list for lookups: the name bytes and three 32-bit words, however
+    deep the tree.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <string_view>
+#include <vector>
+
+class PathStore
+{
+public:
+    static constexpr juce::uint32 noParent = 0xffffffff;
+
+    // Appends `file` and returns its ID. Its directories are interned on the way.
+    int add (const juce::File& file);
+    void reserve (size_t numFiles);
+
+    // A store with these directories and no files, and a copy of file `id` of the store it was
+    // made from, directory ID and all: for keeping a subset of the files without building paths.
+    PathStore withDirectoriesOnly() const;
+    int addFrom (const PathStore& source, int id);
+
+    int size() const noexcept                       { return (int) fileDirectories.size(); }
+
+    // The file name as UTF-8, a view into the arena.
+    std::string_view getName (int id) const noexcept;
+    juce::uint32 getDirectory (int id) const noexcept   { return fileDirectories[(size_t) id]; }
+
+    // Builds the full path from the directory segments: one allocation per call.
+    juce::String getPath (int id) const;
+    juce::File getFile (int id) const               { return juce::File (getPath (id)); }
+
+    // ID of `file`, or -1. Looks the directory up, then compares names only among its files.
+    int indexOf (const juce::File& file) const;
+
+    // IDs of `files`, -1 for those not in the store, in one pass over the store.
+    std::vector<int> indexOf (const juce::Array<juce::File>& files) const;
+
+    int getNumDirectories() const noexcept          { return (int) directoryParents.size(); }
+    juce::uint32 getParent (juce::uint32 directory) const noexcept  { return directoryParents[directory]; }
+    std::string_view getSegment (juce::uint32 directory) const noexcept;
+    int findDirectory (const juce::File& directory) const;     // -1 if no file is below it
+    juce::String getDirectoryPath (juce::uint32 directory) const;
+
+    size_t getMemoryBytes() const noexcept;
+
+private:
+    juce::uint32 internDirectory (const juce::File& directory);
+    void appendSegments (juce::String& path, juce::uint32 directory) const;
+
+    // Directory d is [segmentOffsets[d], segmentOffsets[d + 1]) of the segment arena. Top-level
+    // directories (a filesystem root) have no parent and hold their whole path.
+    std::vector<char> segmentArena;
+    std::vector<juce::uint32> segmentOffsets { 0 }, directoryParents;
+
+    // File i is name [nameOffsets[i], nameOffsets[i + 1]) in directory fileDirectories[i].
+    std::vector<char> nameArena;
+    std::vector<juce::uint32> nameOffsets { 0 }, fileDirectories;
+
+    // Building and lookup only: the directories by path, and the file IDs of each directory.
+    std::map<juce::String, juce::uint32> directoryIds;
+    std::vector<std::vector<juce::uint32>> directoryFiles;
+};
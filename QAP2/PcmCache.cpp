@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    PcmCache.cpp
+
+  ==============================================================================
+*/
+
+#include "PcmCache.h"
+
+PcmCache::PcmCache (juce::AudioFormatManager& formats, const juce::File& cacheFolder, juce::int64 maximumBytes)
+    : formatManager (formats), folder (cacheFolder), maxBytes (maximumBytes)
+{
+}
+
+PcmCache::~PcmCache()
+{
+    decodePool.removeAllJobs (true, 10000);
+}
+
+juce::File PcmCache::getDefaultFolder()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("QAP")
+               .getChildFile ("PcmCache");
+}
+
+bool PcmCache::needsDecoding (const juce::File& source) const
+{
+    auto* format = formatManager.findFormatForFileExtension (source.getFileExtension());
+    return format != nullptr && format->isCompressed();
+}
+
+juce::File PcmCache::getCacheFileFor (const juce::File& source) const
+{
+    // Keyed on path, size and modification time, so an edited file is decoded again.
+    const auto key = source.getFullPathName()
+                   + "|" + juce::String (source.getSize())
+                   + "|" + juce::String (source.getLastModificationTime().toMilliseconds());
+
+    return folder.getChildFile (juce::String::toHexString (key.hashCode64()) + ".wav");
+}
+
+juce::File PcmCache::getCachedFile (const juce::File& source)
+{
+    auto cached = getCacheFileFor (source);
+
+    if (! cached.existsAsFile())
+        return {};
+
+    const RealtimeCheckedLock::ScopedLockType sl (entryLock);
+    loadEntries();
+
+    auto& entry = entries[cached.getFullPathName()];
+
+    // Decoded by another process since we listed the folder.
+    if (entry.lastUsed == 0)
+    {
+        entry.bytes = cached.getSize();
+        totalBytes += entry.bytes;
+    }
+
+    entry.lastUsed = ++useClock;
+    return cached;
+}
+
+juce::int64 PcmCache::getTotalBytes()
+{
+    const RealtimeCheckedLock::ScopedLockType sl (entryLock);
+    loadEntries();
+    return totalBytes;
+}
+
+void PcmCache::loadEntries()
+{
+    if (entriesLoaded)
+        return;
+
+    entriesLoaded = true;
+
+    // Oldest decode first: without a record of uses, that is the best guess at the order.
+    auto files = folder.findChildFiles (juce::File::findFiles, false, "*.wav");
+
+    std::sort (files.begin(), files.end(), [] (const juce::File& a, const juce::File& b)
+    {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (auto& file : files)
+    {
+        auto& entry = entries[file.getFullPathName()];
+        entry.bytes = file.getSize();
+        entry.lastUsed = ++useClock;
+        totalBytes += entry.bytes;
+    }
+}
+
+void PcmCache::requestDecode (const juce::File& source)
+{
+    auto target = getCacheFileFor (source);
+
+    if (target.existsAsFile())
+        return;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (pendingLock);
+
+        if (! pending.insert (target.getFullPathName()).second)
+            return;
+    }
+
+    decodePool.addJob ([this, source, target]
+    {
+        decode (source, target);
+
+        if (target.existsAsFile())
+        {
+            const RealtimeCheckedLock::ScopedLockType sl (entryLock);
+            loadEntries();
+
+            auto& entry = entries[target.getFullPathName()];
+            totalBytes += target.getSize() - entry.bytes;
+            entry.bytes = target.getSize();
+            entry.lastUsed = ++useClock;
+
+            if (totalBytes > maxBytes)
+                trim();
+        }
+
+        const RealtimeCheckedLock::ScopedLockType sl (pendingLock);
+        pending.erase (target.getFullPathName());
+    });
+}
+
+void PcmCache::waitForPendingDecodes (int timeoutMs)
+{
+    const auto end = juce::Time::getMillisecondCounter() + (juce::uint32) timeoutMs;
+
+    while (decodePool.getNumJobs() > 0 && juce::Time::getMillisecondCounter() < end)
+        juce::Thread::sleep (5);
+}
+
+void PcmCache::decode (const juce::File& source, const juce::File& target)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (source));
+
+    if (reader == nullptr || ! folder.createDirectory())
+        return;
+
+    // Written next to the target and renamed over it, so a reader never sees a half-decoded file.
+    juce::TemporaryFile temp (target);
+    juce::WavAudioFormat wav;
+
+    // Compressed formats hold integer samples, 24 bits at most: nothing is lost at the source's
+    // depth, and the copy is half (16-bit) or three quarters (24-bit) the size of a float one.
+    const int bitsPerSample = reader->bitsPerSample > 16 ? 24 : 16;
+
+    {
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (temp.getFile().createOutputStream().release(),
+                                                                              reader->sampleRate, reader->numChannels,
+                                                                              bitsPerSample, {}, 0));
+
+        if (writer == nullptr || ! writer->writeFromAudioReader (*reader, 0, -1))
+            return;
+    }
+
+    temp.overwriteTargetFileWithTemporary();
+}
+
+void PcmCache::trim()
+{
+    // Only runs once a decode took the total over the limit, so sorting here is rare.
+    std::vector<std::pair<juce::uint64, juce::String>> byUse;
+    byUse.reserve (entries.size());
+
+    for (auto& entry : entries)
+        byUse.emplace_back (entry.second.lastUsed, entry.first);
+
+    std::sort (byUse.begin(), byUse.end());
+
+    for (auto& used : byUse)
+    {
+        if (totalBytes <= maxBytes)
+            break;
+
+        auto entry = entries.find (used.second);
+        totalBytes -= entry->second.bytes;
+        entries.erase (entry);
+        juce::File (used.second).deleteFile();
+    }
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    PcmCache.h
+    Bounded on-disk cache of decoded PCM for compressed library files (FLAC,
+    Ogg, ...). Files are decoded on a background pool the first time they
+    are auditioned or pre-opened; after that, previews read the decoded WAV
+    and cost the same as an uncompressed file. Copies keep the source's
+    bit depth (16 or 24-bit) so they stay as small as a WAV of it would be.
+    Use order and sizes are kept in memory, so opening a copy writes nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PerformanceMonitor.h"
+#include <set>
+#include <unordered_map>
+
+class PcmCache
+{
+public:
+    static constexpr juce::int64 defaultMaxBytes = (juce::int64) 1024 * 1024 * 1024;
+
+    PcmCache (juce::AudioFormatManager& formats, const juce::File& folder = getDefaultFolder(),
+              juce::int64 maxBytes = defaultMaxBytes);
+    ~PcmCache();
+
+    static juce::File getDefaultFolder();
+
+    // True for files whose format has to be decoded to be read (see AudioFormat::isCompressed).
+    bool needsDecoding (const juce::File& source) const;
+
+    // The decoded copy of `source`, or an invalid File if it has not been decoded (yet).
+    // Counts as a use for the least-recently-used order.
+    juce::File getCachedFile (const juce::File& source);
+
+    // Queues `source` for background decoding unless it is cached or queued already.
+    void requestDecode (const juce::File& source);
+
+    // Blocks until the queued decodes are done. For tests and tools.
+    void waitForPendingDecodes (int timeoutMs);
+
+    // Bytes of decoded copies, as tracked since the folder was first listed.
+    juce::int64 getTotalBytes();
+
+private:
+    struct Entry
+    {
+        juce::int64 bytes = 0;
+        juce::uint64 lastUsed = 0;
+    };
+
+    juce::File getCacheFileFor (const juce::File& source) const;
+    void decode (const juce::File& source, const juce::File& target);
+    void loadEntries();         // under entryLock
+    void trim();                // under entryLock
+
+    juce::AudioFormatManager& formatManager;
+    const juce::File folder;
+    const juce::int64 maxBytes;
+
+    // Copies by full path. Listed once from the folder, oldest first, then kept up to date.
+    RealtimeCheckedLock entryLock;
+    std::unordered_map<juce::String, Entry> entries;
+    juce::int64 totalBytes = 0;
+    juce::uint64 useClock = 0;
+    bool entriesLoaded = false;
+
+    juce::ThreadPool decodePool { 2 };
+    RealtimeCheckedLock pendingLock;
+    std::set<juce::String> pending;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PcmCache)
+};
@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+
+    PerformanceMonitor.cpp
+
+  ==============================================================================
+*/
+
+#include "PerformanceMonitor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    // The monitor whose processBlock is running on this thread, if any.
+    thread_local PerformanceMonitor* activeMonitor = nullptr;
+    thread_local juce::uint32 pendingAllocations = 0;
+    thread_local juce::uint32 pendingLocks = 0;
+}
+
+#if QAP_DETECT_RT_ALLOCATIONS
+void* operator new (std::size_t size)
+{
+    PerformanceMonitor::noteAllocation();
+
+    if (auto* p = std::malloc (size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)                  { return operator new (size); }
+void operator delete (void* p) noexcept                  { std::free (p); }
+void operator delete[] (void* p) noexcept                { std::free (p); }
+void operator delete (void* p, std::size_t) noexcept     { std::free (p); }
+void operator delete[] (void* p, std::size_t) noexcept   { std::free (p); }
+#endif
+
+//==============================================================================
+void PerformanceMonitor::setStageName (int stage, const char* name) noexcept
+{
+    if (juce::isPositiveAndBelow (stage, (int) numStages))
+        stageNames[stage] = name;
+}
+
+juce::uint64 PerformanceMonitor::readCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64) __rdtsc();
+   #else
+    return (juce::uint64) juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+bool PerformanceMonitor::isAudioThread() noexcept
+{
+    return activeMonitor != nullptr;
+}
+
+void PerformanceMonitor::noteAllocation() noexcept
+{
+    if (activeMonitor != nullptr)
+        ++pendingAllocations;
+}
+
+void PerformanceMonitor::noteLockAcquired() noexcept
+{
+    if (activeMonitor != nullptr)
+        ++pendingLocks;
+}
+
+//==============================================================================
+void PerformanceMonitor::StageAccumulator::reset() noexcept
+{
+    minCycles = maxCycles = sumCycles = 0;
+    count = 0;
+    std::fill (std::begin (histogram), std::end (histogram), 0u);
+}
+
+int PerformanceMonitor::StageAccumulator::getBin (juce::uint64 cycles) noexcept
+{
+    // Four bins per octave: good enough for a p99 and needs no floating point.
+    if (cycles < 4)
+        return (int) cycles;
+
+    int msb = 0;
+    for (auto v = cycles; v > 1; v >>= 1)
+        ++msb;
+
+    return msb * 4 + (int) ((cycles >> (msb - 2)) & 3);
+}
+
+juce::uint64 PerformanceMonitor::StageAccumulator::getBinFloor (int bin) noexcept
+{
+    if (bin < 4)
+        return (juce::uint64) bin;
+
+    const int msb = bin / 4;
+    return (juce::uint64) (4 + bin % 4) << (msb - 2);
+}
+
+void PerformanceMonitor::StageAccumulator::add (juce::uint64 cycles) noexcept
+{
+    minCycles = count == 0 ? cycles : juce::jmin (minCycles, cycles);
+    maxCycles = juce::jmax (maxCycles, cycles);
+    sumCycles += cycles;
+    ++count;
+    ++histogram[juce::jmin (getBin (cycles), numBins - 1)];
+}
+
+PerformanceMonitor::StageStats PerformanceMonitor::StageAccumulator::getStats() const noexcept
+{
+    StageStats stats;
+
+    if (count == 0)
+        return stats;
+
+    stats.minCycles  = minCycles;
+    stats.maxCycles  = maxCycles;
+    stats.meanCycles = sumCycles / count;
+    stats.count      = count;
+
+    const auto target = count - count / 100;   // first bin reaching 99% of the samples
+    juce::uint32 seen = 0;
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        seen += histogram[bin];
+
+        if (seen >= target)
+        {
+            stats.p99Cycles = juce::jlimit (minCycles, maxCycles, getBinFloor (bin));
+            break;
+        }
+    }
+
+    return stats;
+}
+
+//==============================================================================
+void PerformanceMonitor::prepare (double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = juce::jmax (1, maximumBlockSize);
+
+    // One snapshot roughly every 250 ms of audio.
+    blocksPerWindow = juce::jmax (1, juce::roundToInt (sampleRate * 0.25 / currentBlockSize));
+
+    for (auto& accumulator : accumulators)
+        accumulator.reset();
+
+    windowBlocks = windowMisses = 0;
+    windowWorstLoad = 0.0;
+}
+
+void PerformanceMonitor::beginBlock (int numSamples) noexcept
+{
+    activeMonitor = this;
+    pendingAllocations = pendingLocks = 0;
+
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+    blockDeadlineTicks = (juce::int64) ((double) numSamples / currentSampleRate
+                                          * (double) juce::Time::getHighResolutionTicksPerSecond());
+    blockStartCycles = readCycleCounter();
+}
+
+void PerformanceMonitor::endBlock() noexcept
+{
+    addStageCycles (total, readCycleCounter() - blockStartCycles);
+
+    const auto elapsedTicks = juce::Time::getHighResolutionTicks() - blockStartTicks;
+    const auto load = blockDeadlineTicks > 0 ? (double) elapsedTicks / (double) blockDeadlineTicks : 0.0;
+
+    if (load > 1.0)
+        ++windowMisses;
+
+    windowWorstLoad = juce::jmax (windowWorstLoad, load);
+    windowAllocations.fetch_add (pendingAllocations, std::memory_order_relaxed);
+    windowLocks.fetch_add (pendingLocks, std::memory_order_relaxed);
+    activeMonitor = nullptr;
+
+    if (++windowBlocks >= (juce::uint32) blocksPerWindow)
+        publishWindow();
+}
+
+void PerformanceMonitor::addStageCycles (int stage, juce::uint64 cycles) noexcept
+{
+    accumulators[stage].add (cycles);
+}
+
+void PerformanceMonitor::publishWindow() noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        auto& snapshot = ring[start1];
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            snapshot.stages[i] = accumulators[i].getStats();
+            snapshot.stageNames[i] = stageNames[i];
+        }
+
+        snapshot.blocks           = windowBlocks;
+        snapshot.deadlineMisses   = windowMisses;
+        snapshot.allocations      = windowAllocations.exchange (0, std::memory_order_relaxed);
+        snapshot.lockAcquisitions = windowLocks.exchange (0, std::memory_order_relaxed);
+        snapshot.worstBlockLoad   = windowWorstLoad;
+        snapshot.sampleRate       = currentSampleRate;
+        snapshot.blockSize        = currentBlockSize;
+        snapshot.timeMs           = (juce::int64) juce::Time::getMillisecondCounter();
+
+        fifo.finishedWrite (1);
+    }
+    else
+    {
+        // Nobody is reading (editor closed): drop the window rather than wait.
+        droppedSnapshots.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    for (auto& accumulator : accumulators)
+        accumulator.reset();
+
+    windowBlocks = windowMisses = 0;
+    windowWorstLoad = 0.0;
+}
+
+bool PerformanceMonitor::popSnapshot (Snapshot& dest) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    dest = ring[start1];
+    fifo.finishedRead (1);
+    return true;
+}
+
+//==============================================================================
+juce::String PerformanceMonitor::toJSON (const Snapshot& snapshot)
+{
+    auto* root = new juce::DynamicObject();
+
+   #if JUCE_INTEL
+    root->setProperty ("counter", "tsc");
+   #else
+    root->setProperty ("counter", "hiResTicks");
+   #endif
+    root->setProperty ("timeMs", snapshot.timeMs);
+    root->setProperty ("sampleRate", snapshot.sampleRate);
+    root->setProperty ("blockSize", snapshot.blockSize);
+    root->setProperty ("blocks", (int) snapshot.blocks);
+    root->setProperty ("deadlineMisses", (int) snapshot.deadlineMisses);
+    root->setProperty ("worstBlockLoad", snapshot.worstBlockLoad);
+    root->setProperty ("allocations", (int) snapshot.allocations);
+    root->setProperty ("lockAcquisitions", (int) snapshot.lockAcquisitions);
+
+    auto* stages = new juce::DynamicObject();
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        if (snapshot.stageNames[i] == nullptr)
+            continue;
+
+        auto& s = snapshot.stages[i];
+        auto* stage = new juce::DynamicObject();
+        stage->setProperty ("count", (int) s.count);
+        stage->setProperty ("min", (juce::int64) s.minCycles);
+        stage->setProperty ("mean", (juce::int64) s.meanCycles);
+        stage->setProperty ("p99", (juce::int64) s.p99Cycles);
+        stage->setProperty ("max", (juce::int64) s.maxCycles);
+        stages->setProperty (snapshot.stageNames[i], juce::var (stage));
+    }
+
+    root->setProperty ("stages", juce::var (stages));
+    return juce::JSON::toString (juce::var (root));
+}
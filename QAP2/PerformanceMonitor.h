@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    PerformanceMonitor.h
+    Lock-free timing and realtime-safety counters for processBlock.
+
+    The audio thread accumulates per-stage cycle counts for a short window,
+    then pushes a Snapshot into a wait-free single-producer/single-consumer
+    ring. The editor's diagnostics overlay pops snapshots from the message
+    thread; nothing on the audio side ever waits for the reader.
+
+    Build flags:
+      QAP_DETECT_RT_ALLOCATIONS  count heap allocations made inside processBlock
+                                 (replaces global operator new, debug builds only)
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+#ifndef QAP_DETECT_RT_ALLOCATIONS
+ #define QAP_DETECT_RT_ALLOCATIONS 0
+#endif
+
+class PerformanceMonitor
+{
+public:
+    // Procedural model N is timed as stage firstModel + N.
+    enum Stage
+    {
+        transport = 0,
+        mix,
+        total,
+        firstModel,
+        numStages = firstModel + 8
+    };
+
+    // Names must be string literals (or otherwise outlive the monitor).
+    void setStageName (int stage, const char* name) noexcept;
+    const char* getStageName (int stage) const noexcept   { return stageNames[stage]; }
+
+    struct StageStats
+    {
+        juce::uint64 minCycles  = 0;
+        juce::uint64 meanCycles = 0;
+        juce::uint64 p99Cycles  = 0;
+        juce::uint64 maxCycles  = 0;
+        juce::uint32 count      = 0;
+    };
+
+    struct Snapshot
+    {
+        StageStats stages[numStages];
+        const char* stageNames[numStages] {};   // nullptr for unused stages
+        juce::uint32 blocks          = 0;
+        juce::uint32 deadlineMisses  = 0;   // blocks that took longer than their own duration
+        juce::uint32 allocations     = 0;   // heap allocations on the audio thread (see QAP_DETECT_RT_ALLOCATIONS)
+        juce::uint32 lockAcquisitions = 0;  // RealtimeCheckedLock entered on the audio thread
+        double worstBlockLoad = 0.0;        // longest block as a fraction of its deadline
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        juce::int64 timeMs = 0;
+    };
+
+    PerformanceMonitor() = default;
+
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    //==============================================================================
+    // Audio thread
+    void beginBlock (int numSamples) noexcept;
+    void endBlock() noexcept;
+
+    struct ScopedStage
+    {
+        ScopedStage (PerformanceMonitor& m, int s) noexcept : monitor (m), stage (s), start (readCycleCounter()) {}
+        ~ScopedStage() noexcept   { monitor.addStageCycles (stage, readCycleCounter() - start); }
+
+        PerformanceMonitor& monitor;
+        int stage;
+        juce::uint64 start;
+    };
+
+    // For work that was timed elsewhere, e.g. on a render pool worker.
+    void addStageCycles (int stage, juce::uint64 cycles) noexcept;
+
+    //==============================================================================
+    // Reader side (single consumer, normally the editor's message thread)
+    bool popSnapshot (Snapshot& dest) noexcept;
+    juce::uint32 getDroppedSnapshots() const noexcept  { return droppedSnapshots.load (std::memory_order_relaxed); }
+
+    static juce::String toJSON (const Snapshot& snapshot);
+
+    //==============================================================================
+    // Hooks for the realtime-safety checks
+    static bool isAudioThread() noexcept;
+    static void noteAllocation() noexcept;
+    static void noteLockAcquired() noexcept;
+
+    static juce::uint64 readCycleCounter() noexcept;
+
+private:
+    struct StageAccumulator
+    {
+        static constexpr int numBins = 256;
+
+        void reset() noexcept;
+        void add (juce::uint64 cycles) noexcept;
+        StageStats getStats() const noexcept;
+
+        static int getBin (juce::uint64 cycles) noexcept;
+        static juce::uint64 getBinFloor (int bin) noexcept;
+
+        juce::uint64 minCycles = 0, maxCycles = 0, sumCycles = 0;
+        juce::uint32 count = 0;
+        juce::uint32 histogram[numBins] {};
+    };
+
+    void publishWindow() noexcept;
+
+    StageAccumulator accumulators[numStages];
+    const char* stageNames[numStages] { "transport", "mix", "total" };
+
+    static constexpr int ringSize = 32;
+    juce::AbstractFifo fifo { ringSize };
+    Snapshot ring[ringSize];
+    std::atomic<juce::uint32> droppedSnapshots { 0 };
+
+    double currentSampleRate = 44100.0;
+    int currentBlockSize = 512;
+    int blocksPerWindow = 20;
+
+    juce::uint64 blockStartCycles = 0;
+    juce::int64 blockStartTicks = 0;
+    juce::int64 blockDeadlineTicks = 0;
+
+    juce::uint32 windowBlocks = 0, windowMisses = 0;
+    double windowWorstLoad = 0.0;
+    std::atomic<juce::uint32> windowAllocations { 0 }, windowLocks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PerformanceMonitor)
+};
+
+//==============================================================================
+// CriticalSection that reports when it is entered from inside processBlock.
+// Use it for locks that the audio thread must never take.
+class RealtimeCheckedLock  : public juce::CriticalSection
+{
+public:
+    void enter() const noexcept
+    {
+        if (PerformanceMonitor::isAudioThread())
+        {
+            PerformanceMonitor::noteLockAcquired();
+            jassertfalse; // a lock is being taken on the audio thread
+        }
+
+        juce::CriticalSection::enter();
+    }
+
+    using ScopedLockType = juce::GenericScopedLock<RealtimeCheckedLock>;
+};
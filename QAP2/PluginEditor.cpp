@@ -8,28 +8,80 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "ExplosionImpl.h"
-#include "FireImpl.h"
 //==============================================================================
 QAPAudioProcessorEditor::QAPAudioProcessorEditor (QAPAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p),thumbnail(512, audioProcessor.formatManager, thumbnailCache)
+    : AudioProcessorEditor (&p),
+      bakedAttachment (p.parameters, ModelRegistry::bakedParameterId, bakedButton),
+      audioProcessor (p),thumbnail(512, audioProcessor.library->getFormatManager(), audioProcessor.library->getThumbnailCache())
 {
     addAndMakeVisible(wavFileList);
     wavFileList.setModel(this);
+    wavFileList.addMouseListener(&rowDragger, true);
+
+    auto& header = wavFileList.getHeader();
+    for (int column = 0; column < numLibraryColumns; ++column)
+        header.addColumn(LibraryColumns::getColumnName((LibraryColumn) column), column + 1,
+                         column == (int) LibraryColumn::name ? 260 : 70, 40, -1,
+                         juce::TableHeaderComponent::defaultFlags);
+    header.setStretchToFitActive(true);
 
     addAndMakeVisible(loadLibraryButton);
     loadLibraryButton.setButtonText("Load Library");
     loadLibraryButton.onClick = [this] { chooseLibraryFolder(); };
 
+    addAndMakeVisible(presetBox);
+    presetBox.setTextWhenNothingSelected("Presets");
+    presetBox.onChange = [this]()
+        {
+        if (presetBox.getSelectedId() > 0)
+            audioProcessor.setCurrentProgram(presetBox.getSelectedId() - 1);
+        };
+
+    addAndMakeVisible(savePresetButton);
+    savePresetButton.onClick = [this]()
+        {
+        audioProcessor.presets.saveUserPreset("User " + juce::String(audioProcessor.presets.getNumUserPresets() + 1));
+        refreshPresetList();
+        audioProcessor.updateHostDisplay();
+        };
+    refreshPresetList();
+
+    addAndMakeVisible(bakedButton);
+    bakedButton.setClickingTogglesState(true);
+    bakedButton.setTooltip("Play pre-rendered variations of the models instead of rendering them live");
+
+    // The attachment selects the current choice, so the items have to be there first.
+    addAndMakeVisible(oversamplingBox);
+    oversamplingBox.addItemList(Oversampler::getFactorNames(), 1);
+    oversamplingBox.setTooltip("Oversampling of the live models while playing; offline renders use Render Quality");
+    oversamplingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        audioProcessor.parameters, ModelRegistry::oversamplingParameterId, oversamplingBox);
+
+    addAndMakeVisible(diagnosticsButton);
+    diagnosticsButton.setClickingTogglesState(true);
+    diagnosticsButton.onClick = [this]()
+        {
+        if (diagnosticsButton.getToggleState())
+        {
+            diagnosticsOverlay = std::make_unique<DiagnosticsOverlay>(audioProcessor.performance, audioProcessor.library->getMemoryBudget(),
+                                                                     audioProcessor.parameters);
+            addAndMakeVisible(*diagnosticsOverlay);
+        }
+        else
+        {
+            diagnosticsOverlay = nullptr;
+        }
+        resized();
+        };
+
     addAndMakeVisible(searchBar);
     searchBar.setTextToShowWhenEmpty("Search sounds...", juce::Colours::grey);
     searchBar.onTextChange = [this]()
         {
+        audioProcessor.setSearchText(searchBar.getText());
         filterFileList(searchBar.getText());
         };
 
-    filteredWavFileNames = audioProcessor.getWavFileNames();
-
     juce::Image loadedAssistantImage;
     juce::File imageFile("/Users/nellygarcia/Downloads/Irhedoki.png");
 
@@ -78,17 +130,24 @@ QAPAudioProcessorEditor::QAPAudioProcessorEditor (QAPAudioProcessor& p)
     assistantLabel.setVisible(false);
     
     // Procedural Audio Models.
-    setupExplosionUI();
-    
-    setupFireUI();
-  
+    for (int i = 0; i < audioProcessor.models.size(); ++i)
+    {
+        auto* panel = modelPanels.add(new ModelPanel(audioProcessor, audioProcessor.models[i]));
+        addChildComponent(panel);
+    }
     
 
     setSize(700, 700); // Set the overall size of your plugin editor
+
+    restoreSessionState();
 }
 
 QAPAudioProcessorEditor::~QAPAudioProcessorEditor()
 {
+    wavFileList.removeMouseListener(&rowDragger);
+
+    if (! regionExportDropped)
+        regionExport.deleteFile();
 }
 
 //==============================================================================
@@ -110,6 +169,25 @@ void QAPAudioProcessorEditor::paint (juce::Graphics& g)
                                0.0,
                                thumbnail.getTotalLength(),
                                1.0f);
+
+        g.setColour(juce::Colours::orange.withAlpha(0.5f));
+        for (auto transient : waveformTransients)
+            g.drawVerticalLine(juce::roundToInt(getXFor((juce::int64) transient)), waveformBounds.getY(), waveformBounds.getY() + 8.0f);
+
+        if (! region.isEmpty())
+        {
+            auto area = waveformBounds.withLeft(getXFor(region.getStart())).withRight(getXFor(region.getEnd()));
+            g.setColour(juce::Colours::white.withAlpha(0.15f));
+            g.fillRect(area);
+            g.setColour(juce::Colours::white.withAlpha(0.6f));
+            g.drawRect(area, 1.0f);
+        }
+
+        if (playFrom >= 0)
+        {
+            g.setColour(juce::Colours::yellow);
+            g.drawVerticalLine(juce::roundToInt(getXFor(playFrom)), waveformBounds.getY(), waveformBounds.getBottom());
+        }
     }
     else
     {
@@ -119,119 +197,415 @@ void QAPAudioProcessorEditor::paint (juce::Graphics& g)
     }
 }
 
-void QAPAudioProcessorEditor::setupFireUI()
+double QAPAudioProcessorEditor::getWaveformSamples() const
 {
-    addAndMakeVisible(firePanel);
-    firePanel.setVisible(false);
+    return thumbnail.getTotalLength() * waveformRate;
+}
 
-    // === Trigger Button ===
-    addAndMakeVisible(FireButton);
-    FireButton.setButtonText("Start Fire");
-    FireButton.onClick = [this]() { audioProcessor.triggerFire(); };
-    
-    addAndMakeVisible(LappingSlider);
-    LappingSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    LappingSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    lappingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "lapping", LappingSlider);
-    addAndMakeVisible(HissingSlider);
-    HissingSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    HissingSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    hissingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "hissing", HissingSlider);
-    addAndMakeVisible(CracklingSlider);
-    CracklingSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    CracklingSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    cracklingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "crackling", CracklingSlider);
-    addAndMakeVisible(IntensitySlider);
-    IntensitySlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    IntensitySlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    intensityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "intensity", IntensitySlider);
-    
-    
+float QAPAudioProcessorEditor::getXFor(juce::int64 sample) const
+{
+    const auto total = getWaveformSamples();
+    return total > 0.0 ? waveformBounds.getX() + (float) ((double) sample / total) * waveformBounds.getWidth()
+                       : waveformBounds.getX();
 }
 
+juce::int64 QAPAudioProcessorEditor::getSampleAt(float x, bool snapToTransient) const
+{
+    const auto total = getWaveformSamples();
+    const auto proportion = juce::jlimit(0.0f, 1.0f, (x - waveformBounds.getX()) / juce::jmax(1.0f, waveformBounds.getWidth()));
+    auto sample = (juce::int64) std::llround(proportion * total);
+
+    if (! snapToTransient || waveformTransients.empty())
+        return sample;
+
+    // The nearest transient within 6 pixels
+    const auto reach = 6.0 / juce::jmax(1.0f, waveformBounds.getWidth()) * total;
+    auto next = std::lower_bound(waveformTransients.begin(), waveformTransients.end(), (juce::uint32) juce::jmin(sample, (juce::int64) 0xffffffff));
+    auto best = sample;
+    auto bestDistance = reach;
+
+    for (auto it : { next, next == waveformTransients.begin() ? next : next - 1 })
+    {
+        if (it == waveformTransients.end())
+            continue;
+
+        const auto distance = std::abs((double) *it - (double) sample);
 
-void QAPAudioProcessorEditor::setupExplosionUI()
+        if (distance <= bestDistance)
+        {
+            best = (juce::int64) *it;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+void QAPAudioProcessorEditor::updateWaveformTransients()
 {
-    // === Explosion Panel ===
-    // Add the panel first
-    addAndMakeVisible(explosionPanel);
-    explosionPanel.setVisible(false);
+    waveformTransients.clear();
 
-    // === Trigger Button ===
-    addAndMakeVisible(triggerButton);
-    triggerButton.setButtonText("Trigger Explosion");
-    triggerButton.onClick = [this]() { audioProcessor.triggerExplosion(); };
+    if (listIndex == nullptr || waveformFile == juce::File())
+        return;
 
+    const auto id = listIndex->paths.indexOf(waveformFile);
 
-    // Explosion Parameters
-    addAndMakeVisible(rumbleSlider);
-    rumbleSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    rumbleSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    rumbleAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(audioProcessor.parameters, "rumble", rumbleSlider));
-    
-    addAndMakeVisible(rumbleDecaySlider);
-    rumbleDecaySlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    rumbleDecaySlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
-    rumbleDecayAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "rumbleDecay", rumbleDecaySlider);
-    
-    addAndMakeVisible(AirSlider);
-    AirSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    airAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "air", AirSlider);
-        
-    addAndMakeVisible(AirDecaySlider);
-    AirDecaySlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    airDecayAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "airDecay", AirDecaySlider);
-    
-    addAndMakeVisible(DustSlider);
-    DustSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    dustAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "dust", DustSlider);
+    if (id >= 0)
+    {
+        waveformRate = listIndex->columns.sampleRate[(size_t) id];
+        waveformTransients = listIndex->columns.getTransients(id);
+    }
+}
 
-    addAndMakeVisible(DustDecaySlider);
-    DustDecaySlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    dustDecayAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "dustDecay", DustDecaySlider);
-        
-    addAndMakeVisible(GritAmountSlider);
-    GritAmountSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    gritAmountAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "gritAmount", GritAmountSlider);
+void QAPAudioProcessorEditor::mouseDown(const juce::MouseEvent& e)
+{
+    pressedWaveform = waveformBounds.contains(e.position) && thumbnail.getTotalLength() > 0.0 && waveformRate > 0.0;
+    pressedRegion = pressedWaveform && region.contains(getSampleAt(e.position.x, false));
+    exportedRegion = false;
+
+    if (pressedRegion)
+        prepareRegionExport();
 }
 
+void QAPAudioProcessorEditor::mouseDrag(const juce::MouseEvent& e)
+{
+    if (! pressedWaveform || e.getDistanceFromDragStart() < 4)
+        return;
+
+    if (pressedRegion)
+    {
+        // Until the export is ready the drag waits; the next move after that starts it.
+        if (exportedRegion || regionExportSource != waveformFile || regionExportRange != region || ! regionExport.existsAsFile())
+            return;
+
+        exportedRegion = true;
+
+        dragFilesOut({ regionExport.getFullPathName() }, *this,
+                     [safeThis = juce::Component::SafePointer<QAPAudioProcessorEditor> (this), dropped = regionExport]()
+            {
+            if (safeThis != nullptr && safeThis->regionExport == dropped)
+                safeThis->regionExportDropped = true;
+            });
+
+        return;
+    }
+
+    region = juce::Range<juce::int64>::between(getSampleAt(e.mouseDownPosition.x, true), getSampleAt(e.position.x, true));
+    repaint(waveformBounds.toNearestInt());
+}
+
+void QAPAudioProcessorEditor::mouseUp(const juce::MouseEvent& e)
+{
+    if (! pressedWaveform)
+        return;
+
+    pressedWaveform = false;
+
+    if (exportedRegion)
+        return;
+
+    if (e.getDistanceFromDragStart() < 4)
+    {
+        region = {};
+        playFrom = getSampleAt(e.position.x, true);
+        audioProcessor.playWavFile(waveformFile, playFrom);
+    }
+    else if (! region.isEmpty())
+    {
+        playFrom = region.getStart();
+        audioProcessor.playWavFile(waveformFile, region.getStart(), region.getEnd());
+        prepareRegionExport();
+    }
+
+    repaint(waveformBounds.toNearestInt());
+}
+
+void QAPAudioProcessorEditor::prepareRegionExport()
+{
+    if (regionExporting || region.isEmpty()
+         || (regionExportSource == waveformFile && regionExportRange == region && regionExport.existsAsFile()))
+        return;
+
+    regionExporting = true;
+
+    audioProcessor.exportRegionAsync(waveformFile, region.getStart(), region.getEnd(),
+                                     [safeThis = juce::Component::SafePointer<QAPAudioProcessorEditor> (this),
+                                      source = waveformFile, range = region] (juce::File trimmed)
+        {
+        if (safeThis != nullptr)
+            safeThis->regionExported(trimmed, source, range);
+        else
+            trimmed.deleteFile();
+        });
+}
+
+void QAPAudioProcessorEditor::regionExported(const juce::File& trimmed, const juce::File& source, juce::Range<juce::int64> range)
+{
+    if (! regionExportDropped)
+        regionExport.deleteFile();
+
+    regionExport = trimmed;
+    regionExportSource = source;
+    regionExportRange = range;
+    regionExporting = false;
+    regionExportDropped = false;
+
+    // Another region was selected while this one exported.
+    if (! region.isEmpty() && (source != waveformFile || range != region))
+        prepareRegionExport();
+}
 
 int QAPAudioProcessorEditor::getNumRows()
 {
-    //return audioProcessor.wavFileNames.size();
-    return filteredWavFileNames.size();
+    return (int) listRows.size();
 }
 
-void QAPAudioProcessorEditor::paintListBoxItem(int rowNumber, juce::Graphics& g,
-                                               int width, int height, bool rowIsSelected)
+void QAPAudioProcessorEditor::paintRowBackground(juce::Graphics& g, int, int, int, bool rowIsSelected)
 {
     if (rowIsSelected)
         g.fillAll(juce::Colours::lightblue);
+}
+
+void QAPAudioProcessorEditor::paintCell(juce::Graphics& g, int rowNumber, int columnId,
+                                        int width, int height, bool)
+{
+    if (! juce::isPositiveAndBelow(rowNumber, (int) listRows.size()))
+        return;
+
+    const auto id = listRows[(size_t) rowNumber];
+    const auto column = (LibraryColumn) (columnId - 1);
+    g.setColour(juce::Colours::black);
 
-    if (rowNumber >= 0 && rowNumber < filteredWavFileNames.size())
+    if (column == LibraryColumn::name)
     {
-        g.setColour(juce::Colours::black);
-        g.drawText(filteredWavFileNames[rowNumber], 5, 0, width, height, juce::Justification::centredLeft);
+        getRowGlyphs(id, width, height).draw(g);
+
+        if (listFacets != nullptr && listFacets->isFavourite(id))
+        {
+            g.setColour(juce::Colours::orange);
+            g.drawText(juce::String(juce::CharPointer_UTF8("\xe2\x98\x85")), width - 20, 0, 15, height,
+                       juce::Justification::centredRight, false);
+        }
     }
+    else
+        g.drawText(LibraryColumns::formatValue(column, *listIndex, id), 5, 0, width - 10, height,
+                   juce::Justification::centredRight, true);
 }
 
+void QAPAudioProcessorEditor::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    // The clicked column becomes the primary key, the previous ones break its ties
+    const auto column = (LibraryColumn) (newSortColumnId - 1);
 
-void QAPAudioProcessorEditor::refreshWavFileList()
+    sortKeys.erase(std::remove_if(sortKeys.begin(), sortKeys.end(),
+                                  [column](const LibraryQuery::SortKey& key) { return key.column == column; }),
+                   sortKeys.end());
+    sortKeys.insert(sortKeys.begin(), { column, isForwards });
+
+    if (sortKeys.size() > 3)
+        sortKeys.resize(3);
+
+    refreshWavFileList();
+}
+
+void QAPAudioProcessorEditor::cellClicked(int rowNumber, int, const juce::MouseEvent& e)
+{
+    if (e.mods.isPopupMenu())
+        showRowMenu(rowNumber);
+}
+
+void QAPAudioProcessorEditor::showRowMenu(int rowNumber)
+{
+    if (listIndex == nullptr || ! juce::isPositiveAndBelow(rowNumber, (int) listRows.size()))
+        return;
+
+    // The actions hold the service, so they are safe to run after the editor has gone
+    auto file = listIndex->getFile(listRows[(size_t) rowNumber]);
+    juce::SharedResourcePointer<LibraryService> library;
+    auto& database = library->getDatabase();
+    const auto record = database.getRecord(file);
+    const auto tagNames = database.getTagNames();
+    const juce::String star(juce::CharPointer_UTF8("\xe2\x98\x85"));
+
+    juce::PopupMenu menu, ratingMenu, tagMenu;
+    menu.addItem("Favourite", true, record.favourite,
+                 [library, file, favourite = record.favourite] { library->getDatabase().setFavourite(file, ! favourite); });
+
+    for (int stars = 0; stars <= 5; ++stars)
+        ratingMenu.addItem(stars == 0 ? juce::String("None") : juce::String::repeatedString(star, stars), true, record.rating == stars,
+                           [library, file, stars] { library->getDatabase().setRating(file, stars); });
+
+    menu.addSubMenu("Rating", ratingMenu);
+
+    for (auto& tag : tagNames)
+        tagMenu.addItem(tag, true, record.tags.contains(tag),
+                        [library, file, tag, has = record.tags.contains(tag)] { library->getDatabase().setTag(file, tag, ! has); });
+
+    if (! tagNames.isEmpty())
+        tagMenu.addSeparator();
+
+    tagMenu.addItem("New tag...", [library, file]
+        {
+        auto* window = new juce::AlertWindow("New tag", "Tag " + file.getFileName() + " with:", juce::MessageBoxIconType::NoIcon);
+        window->addTextEditor("tag", {});
+        window->addButton("Add", 1, juce::KeyPress(juce::KeyPress::returnKey));
+        window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+        window->enterModalState(true, juce::ModalCallbackFunction::create([window, library, file](int result)
+            {
+            if (result == 1)
+                library->getDatabase().setTag(file, window->getTextEditorContents("tag"), true);
+            }), true);
+        });
+
+    menu.addSubMenu("Tags", tagMenu);
+    menu.showMenuAsync(juce::PopupMenu::Options().withMousePosition());
+}
+
+const juce::GlyphArrangement& QAPAudioProcessorEditor::getRowGlyphs(int id, int width, int height)
+{
+    auto& entry = rowTextCache[(size_t) id % rowTextCacheSize];
+
+    if (entry.id != id || entry.width != width || entry.height != height)
+    {
+        // Same layout drawText would produce, but shaped once instead of on every repaint
+        entry.glyphs.clear();
+        entry.glyphs.addCurtailedLineOfText(juce::Font(), listIndex->getName(id), 0.0f, 0.0f, (float) width, true);
+        entry.glyphs.justifyGlyphs(0, entry.glyphs.getNumGlyphs(), 5.0f, 0.0f, (float) width, (float) height,
+                                   juce::Justification::centredLeft);
+        entry.id = id;
+        entry.width = width;
+        entry.height = height;
+    }
+
+    return entry.glyphs;
+}
+
+void QAPAudioProcessorEditor::showMatches(const juce::String& searchText)
+{
+    auto index = audioProcessor.getLibraryIndex();
+    auto facets = audioProcessor.library->getDatabase().getFacets(index);
+
+    auto query = LibraryQuery::parse(searchText);
+    query.sortKeys = sortKeys;
+    query.project = audioProcessor.getProjectId();
+
+    // Ranking scans every name once per word, too slow for a keystroke on a big library
+    const auto search = ++latestSearch;
+
+    searchPool.addJob([this, search, index, facets, query]
+    {
+        if (search != latestSearch.load())
+            return;
+
+        auto rows = std::make_shared<std::vector<int>>(index->runQuery(query, facets.get()));
+
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<QAPAudioProcessorEditor>(this),
+                                         search, index, facets, rows, usesFacets = ! query.facets.empty()]
+        {
+            if (safeThis != nullptr && search == safeThis->latestSearch.load())
+                safeThis->matchesFound(index, facets, std::move(*rows), usesFacets);
+        });
+    });
+}
+
+void QAPAudioProcessorEditor::matchesFound(std::shared_ptr<const LibraryIndex> index, std::shared_ptr<const LibraryFacets> facets,
+                                           std::vector<int> rows, bool usesFacets)
 {
-    filteredWavFileNames = audioProcessor.getWavFileNames();
+    // IDs only mean something within one index
+    if (index != listIndex)
+        for (auto& entry : rowTextCache)
+            entry.id = -1;
+
+    // The library may have changed under the list (watcher update): keep the selected file selected
+    juce::File selectedFile;
+    const auto selectedRow = wavFileList.getSelectedRow();
+    if (listIndex != nullptr && juce::isPositiveAndBelow(selectedRow, (int) listRows.size()))
+        selectedFile = listIndex->getFile(listRows[(size_t) selectedRow]);
+
+    listFacets = std::move(facets);
+    listUsesFacets = usesFacets;
+    listRows = std::move(rows);
+    listIndex = std::move(index);
+    updateWaveformTransients();     // the analysis may have finished the shown file
+
     wavFileList.updateContent();
+
+    const juce::ScopedValueSetter<bool> quiet(restoringSelection, true);
+    const auto selectedId = selectedFile != juce::File() ? listIndex->paths.indexOf(selectedFile) : -1;
+    auto found = std::find(listRows.begin(), listRows.end(), selectedId);
+
+    if (selectedId >= 0 && found != listRows.end())
+        wavFileList.selectRow((int) (found - listRows.begin()), true, true);
+    else
+        wavFileList.deselectAllRows();
+
     wavFileList.repaint();
 }
 
+
+void QAPAudioProcessorEditor::refreshWavFileList()
+{
+    showMatches(searchBar.getText());
+}
+
+void QAPAudioProcessorEditor::libraryDatabaseChanged()
+{
+    // Only a search over facets can change with them; otherwise just the stars are redrawn
+    if (listUsesFacets)
+    {
+        refreshWavFileList();
+        return;
+    }
+
+    listFacets = audioProcessor.library->getDatabase().getFacets(listIndex);
+    wavFileList.repaint();
+}
+
+void QAPAudioProcessorEditor::refreshPresetList()
+{
+    presetBox.clear(juce::dontSendNotification);
+
+    for (int i = 0; i < audioProcessor.getNumPrograms(); ++i)
+    {
+        if (i == audioProcessor.presets.getNumFactoryPresets())
+            presetBox.addSeparator();
+
+        presetBox.addItem(audioProcessor.getProgramName(i), i + 1);
+    }
+
+    presetBox.setSelectedId(audioProcessor.getCurrentProgram() + 1, juce::dontSendNotification);
+}
+
+void QAPAudioProcessorEditor::restoreSessionState()
+{
+    // Read the mode first: filterFileList runs the assistant, which may change it.
+    const auto modelId = audioProcessor.getProceduralModel();
+
+    searchBar.setText(audioProcessor.getSearchText(), juce::dontSendNotification);
+    filterFileList(searchBar.getText());
+
+    showModelPanel(audioProcessor.models.indexOf(modelId));
+    audioProcessor.setProceduralModel(modelId);
+
+    refreshPresetList();
+}
+
 void QAPAudioProcessorEditor::resized()
 {
     int y = 20;
 
     loadLibraryButton.setBounds(20, y, 150, 30);
+    presetBox.setBounds(loadLibraryButton.getRight() + 10, y, 200, 30);
+    savePresetButton.setBounds(presetBox.getRight() + 10, y, 100, 30);
+    diagnosticsButton.setBounds(getWidth() - 80, y, 60, 30);
+    bakedButton.setBounds(diagnosticsButton.getX() - 70, y, 60, 30);
+    oversamplingBox.setBounds(bakedButton.getX() - 80, y, 70, 30);
+
+    if (diagnosticsOverlay != nullptr)
+        diagnosticsOverlay->setBounds(getWidth() - 400, y + 40, 380, 280);
     y = loadLibraryButton.getBottom() + 10;
         
-    // Corrected line: Check for either explosionMode or FireMode.
-    int rightPanelWidth = (explosionMode || FireMode) ? 250 : 0; // Reserve space for either panel
+    int rightPanelWidth = shownModel >= 0 ? 250 : 0; // Reserve space for the model panel
         
     searchBar.setBounds(20, y, getWidth() - 40 - rightPanelWidth, 24);
     y = searchBar.getBottom() + 10;
@@ -250,99 +624,98 @@ void QAPAudioProcessorEditor::resized()
     assistantImage.setBounds(20, getHeight() - 210, 80, 80); // Adjust size as needed
     assistantLabel.setBounds(110, getHeight() - 210, getWidth() - 130 - rightPanelWidth, 80);
 
-    layoutExplosionUI();
-    layoutFireUI();
+    if (shownModel >= 0)
+    {
+        const int panelWidth  = 250;
+        const int margin      = 20;
+        const int top         = 60;
+
+        modelPanels[shownModel]->setBounds(getWidth() - panelWidth - margin, top, panelWidth, getHeight() - top - 20);
+    }
 }
 
-//Fire UI
-void QAPAudioProcessorEditor::layoutFireUI()
+void QAPAudioProcessorEditor::filterFileList(const juce::String& searchText)
 {
-    if(!FireMode)return;
-    const int panelWidth  = 250;
-    const int margin      = 20;
-    const int panelX      = getWidth() - panelWidth - margin;
-    const int top         = 60;
-    const int sliderH     = 40;
-    const int spacing     = 16;
-
-    firePanel.setBounds(panelX, top, panelWidth, getHeight() - top - 20);
+    showMatches(searchText);
+    updateAssistant(searchText); //Check if we're searching for the top 20 sound categories
+}
 
-    int y = top + 30;
-    auto line = [&](juce::Component& c)
-    {
-        c.setBounds(panelX + 10, y, panelWidth - 20, sliderH);
-        y += sliderH + spacing;
-    };
-line(FireButton);
-line(LappingSlider);
-line(HissingSlider);
-line(CracklingSlider);
-line(IntensitySlider);
+void QAPAudioProcessorEditor::dragFilesOut(const juce::StringArray& files, juce::Component& source, std::function<void()> onDropped)
+{
+    juce::Component::SafePointer<juce::Component> window (source.getTopLevelComponent());
 
+    juce::DragAndDropContainer::performExternalDragDropOfFiles(files, false, &source, [window, onDropped]()
+        {
+        // The OS does not say where the files went; a drag released over our own window was not a drop.
+        if (window != nullptr && ! window->getScreenBounds().contains(juce::Desktop::getMousePosition()))
+            onDropped();
+        });
 }
-//EXPLOSION UI
-void QAPAudioProcessorEditor::layoutExplosionUI()
+
+juce::StringArray QAPAudioProcessorEditor::getSelectedFiles() const
 {
-    if (!explosionMode) return;
+    juce::StringArray files;
 
-        const int panelWidth  = 250;
-        const int margin      = 20;
-        const int panelX      = getWidth() - panelWidth - margin;
-        const int top         = 60;
-        const int sliderH     = 40;
-        const int spacing     = 16;
+    if (listIndex == nullptr)
+        return files;
 
-        explosionPanel.setBounds(panelX, top, panelWidth, getHeight() - top - 20);
+    auto selected = wavFileList.getSelectedRows();
 
-        int y = top + 30;
-        auto line = [&](juce::Component& c)
-        {
-            c.setBounds(panelX + 10, y, panelWidth - 20, sliderH);
-            y += sliderH + spacing;
-        };
-    line(triggerButton);
-    line(rumbleSlider);
-    line(rumbleDecaySlider);
-    line(AirDecaySlider);
-    line(AirSlider);
-    line(DustSlider);
-    line(DustDecaySlider);
-    line(GritAmountSlider);
+    for (int i = 0; i < selected.size(); ++i)
+        if (juce::isPositiveAndBelow(selected[i], (int) listRows.size()))
+            files.add(listIndex->paths.getPath(listRows[(size_t) selected[i]]));
+
+    return files;
 }
 
-void QAPAudioProcessorEditor::filterFileList(const juce::String& searchText)
+void QAPAudioProcessorEditor::RowDragger::mouseDrag(const juce::MouseEvent& e)
 {
-    filteredWavFileNames.clear();
+    if (dragging || e.getDistanceFromDragStart() < 6 || e.eventComponent == &editor.wavFileList.getHeader()
+         || editor.wavFileList.getHeader().isParentOf(e.eventComponent))
+        return;
 
-    if (searchText.isEmpty())
-    {
-        filteredWavFileNames = audioProcessor.getWavFileNames();
-    }
-    else
-    {
-        for (auto& name : audioProcessor.getWavFileNames())
-        {
-            if (name.containsIgnoreCase(searchText))
-                filteredWavFileNames.add(name);
-        }
-    }
+    auto files = editor.getSelectedFiles();
 
-    wavFileList.updateContent();
-    wavFileList.repaint();
-    updateAssistant(searchText); //Check if we're searching for the top 20 sound categories
+    if (files.isEmpty())
+        return;
+
+    dragging = true;
+
+    dragFilesOut(files, editor.wavFileList, [safeEditor = juce::Component::SafePointer<QAPAudioProcessorEditor> (&editor), files]()
+        {
+        if (auto* ed = safeEditor.getComponent())
+            for (auto& path : files)
+                ed->audioProcessor.library->getDatabase().noteUsed(juce::File(path), ed->audioProcessor.getProjectId());   // "used-in-project"
+        });
 }
 
 void QAPAudioProcessorEditor::selectedRowsChanged(int lastRowSelected)
 {
-    if (lastRowSelected >= 0 && lastRowSelected < filteredWavFileNames.size())
+    if (restoringSelection)
+        return;
+
+    if (juce::isPositiveAndBelow(lastRowSelected, (int) listRows.size()))
     {
-        auto fileName = filteredWavFileNames[lastRowSelected];
-        audioProcessor.playWavFileByName(fileName); // play the file
+        auto file = listIndex->getFile(listRows[(size_t) lastRowSelected]);
+        audioProcessor.playWavFile(file); // play the file
+        audioProcessor.library->getDatabase().notePlayed(file);    // counted on the database thread
+
+        // Open the neighbours now, so stepping through the list never waits for a file
+        juce::Array<juce::File> neighbours;
+        for (int offset : { 1, -1, 2, -2 })
+            if (juce::isPositiveAndBelow(lastRowSelected + offset, (int) listRows.size()))
+                neighbours.add(listIndex->getFile(listRows[(size_t) (lastRowSelected + offset)]));
+
+        audioProcessor.preloadWavFiles(neighbours);
 
-        auto file = audioProcessor.getWavFileByName(fileName); // get the actual juce::File
         if (file.existsAsFile())
         {
-            thumbnail.setSource(new juce::FileInputSource(file));
+            audioProcessor.library->getThumbnailCache().show(thumbnail, file);
+            waveformFile = file;
+            waveformRate = 0.0;
+            region = {};
+            playFrom = 0;
+            updateWaveformTransients();
 
             repaint(); // Redraw the editor to show the new waveform
         }
@@ -350,73 +723,19 @@ void QAPAudioProcessorEditor::selectedRowsChanged(int lastRowSelected)
 }
 
 
-// in PluginEditor.cpp
-void QAPAudioProcessorEditor::setExplosionMode(bool shouldShow)
+void QAPAudioProcessorEditor::showModelPanel(int modelIndex)
 {
-    if (explosionMode == shouldShow)
+    if (shownModel == modelIndex)
         return;
 
-    explosionMode = shouldShow;
-
-    // Show/hide all Explosion UI elements
-    explosionPanel.setVisible(shouldShow);
-    triggerButton.setVisible(shouldShow);
-    rumbleSlider.setVisible(shouldShow);
-    rumbleDecaySlider.setVisible(shouldShow);
-    AirSlider.setVisible(shouldShow);
-    AirDecaySlider.setVisible(shouldShow);
-    DustSlider.setVisible(shouldShow);
-    DustDecaySlider.setVisible(shouldShow);
-    GritAmountSlider.setVisible(shouldShow);
-
-    // Explicitly hide all Fire UI elements
-    firePanel.setVisible(false);
-    FireButton.setVisible(false);
-    HissingSlider.setVisible(false);
-    LappingSlider.setVisible(false);
-    CracklingSlider.setVisible(false);
-    IntensitySlider.setVisible(false);
-
-    if (shouldShow)
-    {
-        setSize(800, getHeight());
-    }
-    else
-    {
-        setSize(500, getHeight());
-    }
-
-    resized();
-}
+    shownModel = modelIndex;
 
+    for (int i = 0; i < modelPanels.size(); ++i)
+        modelPanels[i]->setVisible(i == modelIndex);
 
-void QAPAudioProcessorEditor::setFireMode(bool shouldShow)
-{
-    if (FireMode == shouldShow)
-        return;
+    audioProcessor.setProceduralModel(modelIndex >= 0 ? juce::String(audioProcessor.models[modelIndex].getId()) : juce::String());
 
-    FireMode = shouldShow;
-
-    // Show/hide all Fire UI elements
-    firePanel.setVisible(shouldShow);
-    FireButton.setVisible(shouldShow);
-    LappingSlider.setVisible(shouldShow);
-    HissingSlider.setVisible(shouldShow);
-    CracklingSlider.setVisible(shouldShow);
-    IntensitySlider.setVisible(shouldShow);
-
-    // Explicitly hide all Explosion UI elements
-    explosionPanel.setVisible(false);
-    triggerButton.setVisible(false);
-    rumbleSlider.setVisible(false);
-    rumbleDecaySlider.setVisible(false);
-    AirSlider.setVisible(false);
-    AirDecaySlider.setVisible(false);
-    DustSlider.setVisible(false);
-    DustDecaySlider.setVisible(false);
-    GritAmountSlider.setVisible(false);
-
-    if (shouldShow)
+    if (modelIndex >= 0)
     {
         setSize(800, getHeight());
     }
@@ -431,36 +750,25 @@ void QAPAudioProcessorEditor::setFireMode(bool shouldShow)
 //Virtual Friend.
 void QAPAudioProcessorEditor::updateAssistant(const juce::String& searchText)
 {
-    if (searchText.containsIgnoreCase("explosion"))
-    {
-        assistantLabel.setText(
-            "Hi.An explosion",
-            juce::dontSendNotification);
-        assistantImage.setVisible(true);
-        assistantLabel.setVisible(true);
-        setFireMode(false);
-        setExplosionMode(true);
-    }
-    
-    else if  (searchText.containsIgnoreCase("fire"))
+    int match = -1;
+
+    for (int i = 0; i < audioProcessor.models.size() && match < 0; ++i)
+        for (auto& keyword : audioProcessor.models[i].getSearchKeywords())
+            if (searchText.containsIgnoreCase(keyword))
+                match = i;
+
+    if (match >= 0)
     {
-        assistantLabel.setText(
-            "Hi.Fire sounds",
-            juce::dontSendNotification);
+        assistantLabel.setText(audioProcessor.models[match].getAssistantText(), juce::dontSendNotification);
         assistantImage.setVisible(true);
         assistantLabel.setVisible(true);
-        setExplosionMode(false);
-        setFireMode(true);
     }
-    
     else
     {
         assistantImage.setVisible(false);
         assistantLabel.setVisible(false);
-        // Corrected logic: Hide all panels when search text is not a match.
-        setExplosionMode (false);
-        setFireMode (false);
     }
+
+    showModelPanel(match);
     resized();
 }
-
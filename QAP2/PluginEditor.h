@@ -8,15 +8,17 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include <array>
 #include "PluginProcessor.h"
-#include "ExplosionImpl.h"
-#include "FireImpl.h"
+#include "DiagnosticsOverlay.h"
+#include "ModelPanel.h"
 
 //==============================================================================
 /**
 */
 class QAPAudioProcessorEditor  : public juce::AudioProcessorEditor,
-public juce::ListBoxModel
+public juce::TableListBoxModel,
+public juce::DragAndDropContainer
 {
 public:
     QAPAudioProcessorEditor (QAPAudioProcessor&);
@@ -24,24 +26,35 @@ public:
 
     //==============================================================================
     int getNumRows() override;
-    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void paintRowBackground(juce::Graphics& g, int rowNumber, int width, int height, bool rowIsSelected) override;
+    void paintCell(juce::Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
+    void cellClicked(int rowNumber, int columnId, const juce::MouseEvent& e) override;     // right click: favourite, rating, tags
+
+    // Hands `files` to the OS as an external drag from `source`. onDropped runs once the drag ended
+    // with the mouse outside the plug-in window, i.e. something else took the files.
+    static void dragFilesOut(const juce::StringArray& files, juce::Component& source, std::function<void()> onDropped);
     void refreshWavFileList();
+    void restoreSessionState();         // Pull search text and procedural mode back from the processor
+    void refreshPresetList();
     void filterFileList(const juce::String& searchText);
+    void libraryDatabaseChanged();      // tags, favourites or play counts changed
     void updateAssistant(const juce::String& searchText);//check for the assistant
 
     
     void paint (juce::Graphics&) override;
     void resized() override;
+
+    // Waveform view: a click plays from there, a drag selects a region and plays it, and dragging
+    // the selected region out of the window hands the DAW a trimmed copy. Both snap to transients.
+    void mouseDown(const juce::MouseEvent& e) override;
+    void mouseDrag(const juce::MouseEvent& e) override;
+    void mouseUp(const juce::MouseEvent& e) override;
     void chooseLibraryFolder();
     void selectedRowsChanged(int lastRowSelected) override; //Check the changes
     
-    //Procedural UI
-    void setupExplosionUI();
-    void layoutExplosionUI();
-    void setExplosionMode (bool shouldShow);
-    void setupFireUI();
-    void layoutFireUI();
-    void setFireMode (bool shouldShow);
+    //Procedural UI, one generated panel per registered model
+    void showModelPanel (int modelIndex);   // -1 hides them all
    
 
     
@@ -50,56 +63,91 @@ public:
 
 private:
     juce::TextButton loadLibraryButton {"Load Library"};
-    juce::ListBox wavFileList; //Total wav files
+    juce::ComboBox presetBox;
+    juce::TextButton savePresetButton {"Save Preset"};
+    juce::TextButton diagnosticsButton {"Stats"};
+    juce::TextButton bakedButton {"Baked"};     // models play pre-rendered material (SampleBank, GranularBed)
+    juce::AudioProcessorValueTreeState::ButtonAttachment bakedAttachment;
+    juce::ComboBox oversamplingBox;             // live factor; offline renders use the "Render Quality" parameter
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> oversamplingAttachment;
+    std::unique_ptr<DiagnosticsOverlay> diagnosticsOverlay;
+    juce::TableListBox wavFileList; //Total wav files, one column per LibraryColumn (column ID = column + 1)
+
+    // Rows dragged out of the window are handed to the DAW by path, nothing is copied. The drag is
+    // started here rather than through the table so a drop can be told from a cancelled drag.
+    struct RowDragger  : public juce::MouseListener
+    {
+        explicit RowDragger(QAPAudioProcessorEditor& e) : editor (e) {}
+        void mouseDrag(const juce::MouseEvent& e) override;
+        void mouseUp(const juce::MouseEvent&) override     { dragging = false; }
+
+        QAPAudioProcessorEditor& editor;
+        bool dragging = false;
+    };
+    RowDragger rowDragger { *this };
+    juce::StringArray getSelectedFiles() const;
     juce::TextEditor searchBar;
-    juce::StringArray filteredWavFileNames; //Filtered wav files
+    // Filtered rows: one ID into the index per match, not only the visible ones, since the list box,
+    // selection restore and drags address any row. Names are read from the arena when painted.
+    std::shared_ptr<const LibraryIndex> listIndex;
+    std::vector<int> listRows;
+    std::shared_ptr<const LibraryFacets> listFacets;    // of listIndex, for the favourite stars
+    bool listUsesFacets = false;                        // the search has facets, so database changes re-run it
+    std::vector<LibraryQuery::SortKey> sortKeys;    // most significant first, the last header clicks
+    bool restoringSelection = false;                // set while showMatches re-selects, so nothing replays
+
+    // Shaped text of recently painted rows, direct-mapped by file ID
+    struct RowText
+    {
+        int id = -1, width = 0, height = 0;
+        juce::GlyphArrangement glyphs;
+    };
+    static constexpr int rowTextCacheSize = 256;
+    std::array<RowText, rowTextCacheSize> rowTextCache;
+    const juce::GlyphArrangement& getRowGlyphs (int id, int width, int height);
+    void showMatches (const juce::String& searchText);      // returns at once, the list updates when the search is done
+    void matchesFound (std::shared_ptr<const LibraryIndex> index, std::shared_ptr<const LibraryFacets> facets,
+                       std::vector<int> rows, bool usesFacets);
+    void showRowMenu (int rowNumber);
     
     std::unique_ptr<juce::FileChooser> folderChooser;
     QAPAudioProcessor& audioProcessor;
-    juce::AudioThumbnailCache thumbnailCache {10}; // Cache up to 5 thumbnails
     juce::AudioThumbnail thumbnail;
     juce::Rectangle<float> waveformBounds;
+
+    // Shown file, in its sample frames; transients come from the library analysis
+    juce::File waveformFile;
+    double waveformRate = 0.0;
+    std::vector<juce::uint32> waveformTransients;
+    juce::Range<juce::int64> region;            // empty for none
+    juce::int64 playFrom = -1;                  // last seek, drawn as a cursor
+    bool pressedWaveform = false, pressedRegion = false, exportedRegion = false;
+
+    // The region as a trimmed file, exported in the background once it is selected so a drag
+    // out of the window can start at once.
+    juce::File regionExport, regionExportSource;
+    juce::Range<juce::int64> regionExportRange;
+    bool regionExporting = false, regionExportDropped = false;
+    void prepareRegionExport();
+    void regionExported(const juce::File& trimmed, const juce::File& source, juce::Range<juce::int64> range);
+
+    void updateWaveformTransients();
+    double getWaveformSamples() const;
+    juce::int64 getSampleAt(float x, bool snapToTransient) const;
+    float getXFor(juce::int64 sample) const;
     
     //IREDOKI Assistant
     juce::ImageComponent assistantImage;
     juce::Label assistantLabel;
     
     //Panels for the procedural Audio Models
-    bool explosionMode=false;
-    juce::GroupComponent explosionPanel { "explosionPanel", "Procedural Explosion" };
-    juce::TextButton triggerButton;
-    
-    bool FireMode=false;
-    juce::GroupComponent firePanel { "firePanel", "Procedural Fire" };
-    juce::TextButton FireButton;
-    //Explosion
-    juce::Slider rumbleSlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> rumbleAttachment;
-    juce::Slider rumbleDecaySlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> rumbleDecayAttachment;
-    juce::Slider AirSlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> airAttachment;
-    juce::Slider AirDecaySlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> airDecayAttachment;
-    juce::Slider DustSlider;
-    juce::Slider DustDecaySlider;
-    juce::Slider GritAmountSlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dustAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dustDecayAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> gritAmountAttachment;
-    
-    //Fire
-    juce::Slider LappingSlider;
-    juce::Slider HissingSlider;
-    juce::Slider CracklingSlider;
-    juce::Slider IntensitySlider;
-    
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lappingAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> hissingAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> cracklingAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> intensityAttachment;
+    juce::OwnedArray<ModelPanel> modelPanels;
+    int shownModel = -1;
 
-    
+    // Searches run here, not on the message thread; one overtaken by a newer keystroke before it
+    // starts is dropped. Last, so it stops before anything a search reads goes away.
+    std::atomic<juce::uint32> latestSearch { 0 };
+    juce::ThreadPool searchPool { 1 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QAPAudioProcessorEditor)
 };
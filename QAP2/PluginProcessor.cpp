@@ -8,7 +8,6 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "ExplosionImpl.h"
 
 QAPAudioProcessor::QAPAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -19,17 +18,34 @@ QAPAudioProcessor::QAPAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                      ), parameters(*this, nullptr, "parameters", createParameterLayout()),explosionModel(std::make_unique<nemisindo::Explosion>()),fireModel(std::make_unique<nemisindo::Fire>())
+                      ), parameters(*this, nullptr, "parameters", createParameterLayout())
 
 {
-
-      formatManager.registerBasicFormats();
+    models.bindParameters (parameters);
+    parameters.addParameterListener (ModelRegistry::oversamplingParameterId, this);
+    parameters.addParameterListener (ModelRegistry::renderQualityParameterId, this);
+    parameters.addParameterListener (MemoryBudget::capParameterId, this);
+    parameters.addParameterListener (ModelRegistry::bakedParameterId, this);
+    library->getMemoryBudget().addClient (this, MemoryBudget::getCapForChoice (juce::roundToInt (parameters.getRawParameterValue (MemoryBudget::capParameterId)->load())));
+    libraryIndex = LibraryService::getEmptyIndex();
+    session.projectId = juce::Uuid().toString();
+    library->addChangeListener (this);
+    library->getDatabase().addChangeListener (this);
+    audition.onRequestQueued = [this] { activity.wake (ActivityTracker::transport); };
 }
 
 #endif
 QAPAudioProcessor::~QAPAudioProcessor()
 {
-
+    cancelPendingUpdate();
+    audition.cancelPendingRequests();
+    parameters.removeParameterListener (ModelRegistry::oversamplingParameterId, this);
+    parameters.removeParameterListener (ModelRegistry::renderQualityParameterId, this);
+    parameters.removeParameterListener (MemoryBudget::capParameterId, this);
+    parameters.removeParameterListener (ModelRegistry::bakedParameterId, this);
+    library->getMemoryBudget().removeClient (this);
+    library->removeChangeListener (this);
+    library->getDatabase().removeChangeListener (this);
 }
 
 
@@ -68,31 +84,32 @@ bool QAPAudioProcessor::isMidiEffect() const
 
 double QAPAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return models.getLongestTailSeconds();
 }
 
 int QAPAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presets.size();   // always at least the factory presets
 }
 
 int QAPAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return presets.getCurrentIndex();
 }
 
 void QAPAudioProcessor::setCurrentProgram (int index)
 {
+    presets.select (index);
 }
 
 const juce::String QAPAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presets.getName (index);
 }
 
 void QAPAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    presets.renameUserPreset (index, newName);
 }
 
 //==============================================================================
@@ -122,115 +139,340 @@ bool QAPAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) cons
 #endif
 
 
-void QAPAudioProcessor::triggerFire()
+void QAPAudioProcessor::triggerModel (const juce::String& modelId)
 {
-    if (fireModel->isActive()){fireModel->stop();}
-      else{fireModel->start();
+    if (auto* model = models.find (modelId))
+    {
+        scheduler.trigger (model->getSlot());
+        renderPool.wakeWorkers();
     }
 }
 
-void QAPAudioProcessor::triggerExplosion()
-{
-    float newRumble=0.0f;
-    float newRumbleDecay=0.0f;
-    float newAir=0.0f;
-    float newAirDecay=0.0f;
-    float newDust=0.0f;
-    float newDustDecay=0.0f;
-    float newGritAmount=0.0f;
-    if (explosionModel)
-       {
-           auto* rumbleParam = parameters.getRawParameterValue("rumble");
-           newRumble=rumbleParam->load();
-           explosionModel->setRumble(newRumble);
-           //explosionModel->setRumble(0.6f);
-           auto* rumbleDecayParam=parameters.getRawParameterValue("rumbleDecay");
-           newRumbleDecay=rumbleDecayParam->load();
-           explosionModel->setRumbleDecay(newRumbleDecay);
-           //explosionModel->setRumbleDecay(4.0f);
-           auto* airParam=parameters.getRawParameterValue("air");
-           newAir=airParam->load();
-           explosionModel->setAir(newAir);
-           auto* airDecayParam=parameters.getRawParameterValue("airDecay");
-           newAirDecay=airDecayParam->load();
-            explosionModel->setAirDecay(newAirDecay);
-           //explosionModel->setAir(0.8f);
-           //explosionModel->setAirDecay(2.0f);
-           auto* dustParam=parameters.getRawParameterValue("dust");
-           newDust=dustParam->load();
-           explosionModel->setDust(newDust);
-           auto* dustDecayParam=parameters.getRawParameterValue("dustDecay");
-           newDustDecay=dustDecayParam->load();
-           explosionModel->setDustDecay(newDustDecay);
-                   
-           explosionModel->setTimeSeparation(0.0f);
-           explosionModel->setGrit(true);
-           auto* gritAmountParam=parameters.getRawParameterValue("gritAmount");
-           newGritAmount=gritAmountParam->load();
-           explosionModel->setGritAmount(newGritAmount);
-           explosionModel->setOverTheTop(true);
-           explosionModel->trigger();
-       }
+void QAPAudioProcessor::startSequence (const juce::String& modelId, TriggerScheduler::Sequence sequence)
+{
+    if (auto* model = models.find (modelId))
+    {
+        sequence.model = model->getSlot();
+        scheduler.start (sequence);
+    }
 }
 
+void QAPAudioProcessor::stopSequences (const juce::String& modelId)
+{
+    if (auto* model = models.find (modelId))
+        scheduler.stop (model->getSlot());
+}
 
+juce::File QAPAudioProcessor::renderTake (const juce::String& modelId, const juce::File& folder)
+{
+    auto* model = models.find (modelId);
 
-void QAPAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+    if (model == nullptr || ! folder.createDirectory())
+        return {};
+
+    auto file = folder.getNonexistentChildFile (juce::String (model->getId()) + "_take", ".wav", false);
+    auto stream = std::unique_ptr<juce::OutputStream> (file.createOutputStream());
+    const double rate = getSampleRate() > 0.0 ? getSampleRate() : 48000.0;
+
+    if (stream == nullptr)
+        return {};
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), rate, 1, 24, {}, 0));
+
+    if (writer == nullptr)
+    {
+        stream.reset();
+        file.deleteFile();
+        return {};
+    }
+
+    stream.release();   // the writer owns it now
+
+    // Offline, so at the render quality rather than the live oversampling.
+    const bool rendered = model->renderTake (*writer, rate, ModelRegistry::getOversamplingFactor (parameters, true), takeSeconds);
+    writer.reset();
+
+    if (! rendered)
+    {
+        file.deleteFile();
+        return {};
+    }
+
+    return file;
+}
+
+juce::File QAPAudioProcessor::exportRegion (const juce::File& file, juce::int64 startSample, juce::int64 endSample,
+                                           const juce::File& folder)
 {
-    transportSource.prepareToPlay(samplesPerBlock, sampleRate);
-    
-    // Corrected code: Initialize both models unconditionally
-    if (explosionModel)
+    auto reader = library->createReaderFor (file);
+
+    if (reader == nullptr || ! folder.createDirectory())
+        return {};
+
+    const auto start = juce::jlimit ((juce::int64) 0, reader->lengthInSamples, startSample);
+    const auto end = juce::jlimit (start, reader->lengthInSamples, endSample);
+
+    if (end <= start)
+        return {};
+
+    auto target = folder.getNonexistentChildFile (file.getFileNameWithoutExtension() + "_trim", ".wav", false);
+    auto stream = std::unique_ptr<juce::OutputStream> (target.createOutputStream());
+
+    if (stream == nullptr)
+        return {};
+
+    // Same rate and channels; the bit depth too where WAV has it.
+    const int bits = (int) reader->bitsPerSample == 16 || (int) reader->bitsPerSample == 32 ? (int) reader->bitsPerSample : 24;
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), reader->sampleRate,
+                                                                          reader->numChannels, bits, {}, 0));
+
+    if (writer == nullptr)
     {
-        explosionModel->initialize((float) sampleRate);
+        stream.reset();
+        target.deleteFile();
+        return {};
     }
-    
-    if (fireModel)
+
+    stream.release();   // the writer owns it now
+
+    const bool written = writer->writeFromAudioReader (*reader, start, end - start);
+    writer.reset();
+
+    if (! written)
     {
-        fireModel->initialize((float) sampleRate);
+        target.deleteFile();
+        return {};
     }
+
+    return target;
+}
+
+void QAPAudioProcessor::renderTakeAsync (const juce::String& modelId, std::function<void (juce::File)> onDone)
+{
+    exportPool.addJob ([this, modelId, onDone]
+    {
+        const auto folder = getTakesFolder();
+        deleteOldFiles (folder);
+        const auto take = renderTake (modelId, folder);
+        juce::MessageManager::callAsync ([onDone, take] { onDone (take); });
+    });
+}
+
+void QAPAudioProcessor::exportRegionAsync (const juce::File& file, juce::int64 startSample, juce::int64 endSample,
+                                           std::function<void (juce::File)> onDone)
+{
+    exportPool.addJob ([this, file, startSample, endSample, onDone]
+    {
+        const auto folder = getRegionsFolder();
+        deleteOldFiles (folder);
+        const auto trimmed = exportRegion (file, startSample, endSample, folder);
+        juce::MessageManager::callAsync ([onDone, trimmed] { onDone (trimmed); });
+    });
+}
+
+juce::File QAPAudioProcessor::getTakesFolder()
+{
+    return juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("QAP Takes");
+}
+
+juce::File QAPAudioProcessor::getRegionsFolder()
+{
+    return juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("QAP Regions");
+}
+
+void QAPAudioProcessor::deleteOldFiles (const juce::File& folder)
+{
+    const auto cutOff = juce::Time::getCurrentTime() - juce::RelativeTime::hours (tempFileHours);
+
+    for (auto& file : folder.findChildFiles (juce::File::findFiles, false))
+        if (file.getLastModificationTime() < cutOff)
+            file.deleteFile();
+}
+
+bool QAPAudioProcessor::isModelAwake (const juce::String& modelId) const
+{
+    auto* model = models.find (modelId);
+    return model != nullptr && activity.isAwake (model->getActivitySource());
+}
+
+
+
+void QAPAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+
+    audition.prepare (sampleRate, samplesPerBlock);
+    prepareModels();
+    scheduler.prepare (sampleRate);
+
+    proceduralRenderer.prepare (ProceduralModel::numChannels, samplesPerBlock);
+    renderPool.prepare (models.size(), ProceduralModel::numChannels, samplesPerBlock);
+    activity.prepare (sampleRate);
+    performance.prepare (sampleRate, samplesPerBlock);
+
+    for (int i = 0; i < models.size(); ++i)
+        performance.setStageName (PerformanceMonitor::firstModel + models[i].getSlot(), models[i].getId());
 }
 
 void QAPAudioProcessor::releaseResources()
 {
-    transportSource.releaseResources();
+    audition.release();
+    models.release();
+    proceduralRenderer.release();
+    renderPool.release();
+    preparedBlockSize = 0;
+}
+
+void QAPAudioProcessor::prepareModels()
+{
+    const int factor = ModelRegistry::getOversamplingFactor (parameters, isNonRealtime());
+    models.prepare (preparedSampleRate, preparedBlockSize, factor);
+
+    // The decimators delay the models' output; the host compensates once it knows by how much.
+    setLatencySamples (juce::roundToInt (Oversampler::getLatencySamples (factor)));
+}
+
+void QAPAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+    triggerAsyncUpdate();
+}
+
+void QAPAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    // The cap is process-wide: the largest one any live instance asks for applies to all of them.
+    if (parameterID == MemoryBudget::capParameterId)
+        library->getMemoryBudget().requestCap (this, MemoryBudget::getCapForChoice (juce::roundToInt (newValue)));
+    else if (parameterID == ModelRegistry::bakedParameterId)
+        models.bakedModeChanged();      // the bake threads sleep while it is off
+    else
+        triggerAsyncUpdate();
+}
+
+void QAPAudioProcessor::handleAsyncUpdate()
+{
+    // A new factor re-initialises the models, so the audio thread has to be kept out meanwhile.
+    // Hosts usually switch to offline rendering before prepareToPlay, which picks it up anyway.
+    if (preparedBlockSize <= 0 || ModelRegistry::getOversamplingFactor (parameters, isNonRealtime()) == models.getOversampling())
+        return;
+
+    suspendProcessing (true);
+    prepareModels();
+    suspendProcessing (false);
 }
 
 void QAPAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    buffer.clear();
-    
 
-    juce::AudioSourceChannelInfo info(buffer);
-    transportSource.getNextAudioBlock(info);
-    float samples=buffer.getNumSamples();
-    
-    float newLapping = *parameters.getRawParameterValue("lapping");
-    float newHissing = *parameters.getRawParameterValue("hissing");
-    float newCrackling = *parameters.getRawParameterValue("crackling");
-    float newIntensity = *parameters.getRawParameterValue("intensity");
-    if (explosionModel->isActive())
+    performance.beginBlock (buffer.getNumSamples());
+    renderBlock (buffer, midiMessages);
+    performance.endBlock();
+}
+
+void QAPAudioProcessor::renderBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    {
+        PerformanceMonitor::ScopedStage stage (performance, PerformanceMonitor::mix);
+        buffer.clear();
+
+        for (const auto metadata : midiMessages)
+        {
+            const auto message = metadata.getMessage();
+
+            if (message.isProgramChange())
+                presets.select (message.getProgramChangeNumber());   // applied on the message thread
+        }
+    }
+
+    const int numSamples = buffer.getNumSamples();
+    const int numEvents = scheduler.collect (numSamples, getPlayHead(), models);
+
+    // Nothing playing, no model sounding and nothing due: leave the cleared buffer as it is.
+    if (activity.isIdle() && numEvents == 0)
+        return;
+
+    if (activity.isAwake (ActivityTracker::transport))
+    {
+        PerformanceMonitor::ScopedStage stage (performance, PerformanceMonitor::transport);
+
+        // play() may queue a file and wake the transport at any point; trySleep keeps that wake.
+        if (! audition.renderAdding (buffer, numSamples) && ! audition.hasPendingCommands())
+            activity.trySleep (ActivityTracker::transport);
+    }
+
+    // The models render up to each event, so every onset lands on its exact sample.
+    int position = 0;
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        auto& event = scheduler.getEvent (i);
+
+        if (event.offset > position)
+        {
+            renderModels (buffer, position, event.offset - position);
+            position = event.offset;
+        }
+
+        auto& model = models[event.model];
+        model.trigger();
+        activity.wake (model.getActivitySource());
+    }
+
+    renderModels (buffer, position, numSamples - position);
+}
+
+void QAPAudioProcessor::renderModels (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numAwake = models.collectAwake (activity);
+
+    if (renderPool.shouldRunParallel (numAwake, numSamples))
+    {
+        renderPool.render (models, numAwake, numSamples, proceduralRenderer.getMode());
+
+        // Mix in registry order, the same order the serial path adds them in.
+        for (int i = 0; i < numAwake; ++i)
         {
-            juce::AudioBuffer<float> proceduralBuffer(buffer.getNumChannels(), buffer.getNumSamples());
-            proceduralBuffer.clear();
-            explosionModel->fillBuffer(const_cast<float**>(proceduralBuffer.getArrayOfWritePointers()), proceduralBuffer.getNumSamples());
-            buffer.addFrom(0, 0, proceduralBuffer, 0, 0, proceduralBuffer.getNumSamples());
+            auto& job = renderPool.getJob (i);
+
+            if (! job.active)
+            {
+                activity.trySleep (job.model->getActivitySource());
+                continue;
+            }
+
+            performance.addStageCycles (PerformanceMonitor::firstModel + job.model->getSlot(), job.cycles);
+            buffer.addFrom (0, startSample, job.output, 0, 0, numSamples);
+            noteModelOutput (*job.model, job.peak, numSamples);
         }
-        
-    fireModel->setLapping(newLapping);
-    fireModel->setHissing(newHissing);
-    fireModel->setCrackling(newCrackling);
-    fireModel->setIntensity(newIntensity);
-        if (fireModel->isActive())
+
+        return;
+    }
+
+    for (int i = 0; i < numAwake; ++i)
+    {
+        auto& model = *models.getAwake (i);
+
+        if (! model.isActive())
         {
-            juce::AudioBuffer<float> proceduralBuffer(buffer.getNumChannels(), buffer.getNumSamples());
-            proceduralBuffer.clear();
-            fireModel->fillBuffer(const_cast<float**>(proceduralBuffer.getArrayOfWritePointers()), proceduralBuffer.getNumSamples());
-            buffer.addFrom(0, 0, proceduralBuffer, 0, 0, proceduralBuffer.getNumSamples());
+            activity.trySleep (model.getActivitySource());
+            continue;
         }
+
+        PerformanceMonitor::ScopedStage stage (performance, PerformanceMonitor::firstModel + model.getSlot());
+        noteModelOutput (model, model.render (proceduralRenderer, buffer, startSample, numSamples), numSamples);
+    }
+}
+
+void QAPAudioProcessor::noteModelOutput (ProceduralModel& model, float peak, int numSamples)
+{
+    // Silent for the hold: one-shots go to sleep, sustained models stay awake and skip their own work.
+    if (! activity.reportOutput (model.getActivitySource(), peak, numSamples) && ! model.isSustained())
+        activity.trySleep (model.getActivitySource());
 }
 
 
@@ -249,7 +491,7 @@ void QAPAudioProcessorEditor::chooseLibraryFolder()
 
         if (selectedFolder.isDirectory())
         {
-            audioProcessor.loadAllWavFilesFromFolder(selectedFolder);
+            audioProcessor.loadLibraryFolderAsync(selectedFolder);
         }
 
         // Clear the pointer to destroy FileChooser after use
@@ -260,51 +502,112 @@ void QAPAudioProcessorEditor::chooseLibraryFolder()
 
 void QAPAudioProcessor::loadAllWavFilesFromFolder(const juce::File &folder)
 {
-    juce::Array<juce::File> wavFiles;
-    folder.findChildFiles(wavFiles, juce::File::findFiles, true, "*.wav");
-    wavFileNames.clear();
-    wavFilePaths.clear();
-    
+    // Another instance may already have scanned this folder, in which case we just
+    // share its index. Loading the folder we already show is a manual refresh.
+    const bool rescan = getLibraryIndex()->root == folder;
 
-    for (auto& file : wavFiles)
     {
-        DBG("Found WAV: " + file.getFileName());
-        wavFilePaths.add(file);
-        wavFileNames.add(file.getFileName());
+        const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+        session.libraryRoot = folder.getFullPathName();
     }
+
+    ++libraryRequest;   // a scan still running for an earlier request must not replace this one
+    applyLibraryIndex (library->acquireIndex (folder, rescan));
+}
+
+void QAPAudioProcessor::loadLibraryFolderAsync(const juce::File& folder)
+{
+    const bool rescan = getLibraryIndex()->root == folder;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+        session.libraryRoot = folder.getFullPathName();
+    }
+
+    requestLibraryIndex (folder, rescan);
+}
+
+void QAPAudioProcessor::requestLibraryIndex (const juce::File& folder, bool rescan)
+{
+    // Scans finish in any order: only the result of the latest request is shown.
+    const auto request = ++libraryRequest;
+    juce::WeakReference<QAPAudioProcessor> weakThis (this);
+
+    library->acquireIndexAsync (folder, [weakThis, request] (std::shared_ptr<const LibraryIndex> index)
+    {
+        if (auto* processor = weakThis.get())
+            if (processor->libraryRequest.load() == request)
+                processor->applyLibraryIndex (std::move (index));
+    }, rescan);
+}
+
+void QAPAudioProcessor::applyLibraryIndex (std::shared_ptr<const LibraryIndex> index)
+{
+    std::atomic_store (&libraryIndex, std::move (index));
+
     if (auto* editor = dynamic_cast<QAPAudioProcessorEditor*>(getActiveEditor()))
     {
         editor->refreshWavFileList();
     }
 }
 
-juce::File QAPAudioProcessor::getWavFileByName(const juce::String& name) const
+void QAPAudioProcessor::changeListenerCallback (juce::ChangeBroadcaster* source)
 {
-    for (int i = 0; i < wavFilePaths.size(); ++i)
+    if (source == &library->getDatabase())
     {
-        if (wavFilePaths[i].getFileName() == name)
-            return wavFilePaths[i];
+        if (auto* editor = dynamic_cast<QAPAudioProcessorEditor*>(getActiveEditor()))
+            editor->libraryDatabaseChanged();
+
+        return;
     }
-    return {};
+
+    // Some instance rescanned a folder: pick up the new index if it is ours.
+    auto current = getLibraryIndex();
+
+    if (current->root == juce::File())
+        return;
+
+    auto latest = library->acquireIndex (current->root);
+
+    if (latest != current)
+        applyLibraryIndex (latest);
+}
+
+juce::File QAPAudioProcessor::getWavFileByName(const juce::String& name) const
+{
+    return getLibraryIndex()->getFile (name);
 }
 
 void QAPAudioProcessor::playWavFileByName(const juce::String& name)
 {
-    auto file = getWavFileByName(name);
+    playWavFile(getWavFileByName(name));
+}
 
+void QAPAudioProcessor::playWavFile(const juce::File& file, juce::int64 startSample, juce::int64 endSample)
+{
     if (!file.existsAsFile())
         return;
 
-    auto* reader = formatManager.createReaderFor(file);
+    // Crossfades from whatever is playing, the reader is usually open already (see preloadWavFiles).
+    // The transport wakes once the request is queued (onRequestQueued).
+    audition.play(file, startSample, endSample);
+}
 
-    if (reader != nullptr)
-    {
-        std::unique_ptr<juce::AudioFormatReaderSource> newSource(new juce::AudioFormatReaderSource(reader, true));
-        transportSource.stop();
-        transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
-        readerSource = std::move(newSource);
-        transportSource.start();
-    }
+void QAPAudioProcessor::preloadWavFiles(const juce::Array<juce::File>& files)
+{
+    audition.preload(files);
+}
+
+juce::StringArray QAPAudioProcessor::getWavFileNames() const
+{
+    auto index = getLibraryIndex();
+    juce::StringArray names;
+    names.ensureStorageAllocated(index->size());
+
+    for (int i = 0; i < index->size(); ++i)
+        names.add(index->getName(i));
+
+    return names;
 }
 
 
@@ -322,15 +625,85 @@ juce::AudioProcessorEditor* QAPAudioProcessor::createEditor()
 //==============================================================================
 void QAPAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    SessionState snapshot;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+        snapshot = session;
+    }
+
+    juce::MemoryOutputStream out (destData, false);
+    SessionState::write (out, *this, snapshot);
 }
 
 void QAPAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    juce::MemoryInputStream in (data, (size_t) sizeInBytes, false);
+    SessionState restored;
+
+    if (! SessionState::read (in, *this, restored))
+        return;
+
+    {
+        const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+
+        // Sessions from before project IDs keep the one this instance made up.
+        if (restored.projectId.isEmpty())
+            restored.projectId = session.projectId;
+
+        session = restored;
+    }
+
+    juce::WeakReference<QAPAudioProcessor> weakThis (this);
+
+    // Scanning can take a while on big libraries, so never do it inside the host's
+    // state call: the index arrives later on the message thread.
+    if (juce::File::isAbsolutePath (restored.libraryRoot))
+    {
+        requestLibraryIndex (juce::File (restored.libraryRoot), false);
+    }
+    else
+    {
+        ++libraryRequest;
+        std::atomic_store (&libraryIndex, LibraryService::getEmptyIndex());
+    }
+
+    juce::MessageManager::callAsync ([weakThis]
+    {
+        if (auto* processor = weakThis.get())
+            if (auto* editor = dynamic_cast<QAPAudioProcessorEditor*>(processor->getActiveEditor()))
+                editor->restoreSessionState();
+    });
+}
+
+juce::String QAPAudioProcessor::getSearchText() const
+{
+    const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+    return session.searchText;
+}
+
+void QAPAudioProcessor::setSearchText (const juce::String& newText)
+{
+    const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+    session.searchText = newText;
+}
+
+juce::String QAPAudioProcessor::getProceduralModel() const
+{
+    const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+    return session.proceduralModel;
+}
+
+void QAPAudioProcessor::setProceduralModel (const juce::String& modelId)
+{
+    const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+    session.proceduralModel = modelId;
+}
+
+juce::String QAPAudioProcessor::getProjectId() const
+{
+    const RealtimeCheckedLock::ScopedLockType sl (sessionLock);
+    return session.projectId;
 }
 
 //==============================================================================
@@ -344,20 +717,11 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 juce::AudioProcessorValueTreeState::ParameterLayout QAPAudioProcessor::createParameterLayout()
 {
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> parameters;
-    //Explosion
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"rumble", 1},"Rumble", 0.1f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"rumbleDecay",1},"Rumble Decay", 0.5f, 4.0f, 4.0f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"dust",1}, "Dust", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"dustDecay",1}, "Dust Decay", 0.0f, 5.0f, 1.0f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"air",1}, "Air", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"airDecay",1}, "Air Decay", 1.0f, 5.0f, 1.0f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"gritAmount",1}, "Grit Amount", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"timeSeparation",1}, "Time Separation", 0.0f, 1.0f, 0.5f));
-    //Fire
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"lapping", 1},"Lapping", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"hissing", 1},"Hissing", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"crackling", 1},"Crackling", 0.0f, 1.0f, 0.5f));
-    parameters.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"intensity", 1},"Intensity", 0.0f, 1.0f, 0.5f));
+    models.addParametersTo (parameters);
+
+    parameters.push_back (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { MemoryBudget::capParameterId, 1 }, "Memory",
+                                                                        MemoryBudget::getCapNames(), MemoryBudget::defaultCapChoice,
+                                                                        juce::AudioParameterChoiceAttributes().withAutomatable (false)));
 
     return { parameters.begin(), parameters.end() };
 }
@@ -10,10 +10,21 @@
 
 #include <JuceHeader.h>
 #include <atomic>
-#include "ExplosionImpl.h"
-#include "FireImpl.h"
-
-class QAPAudioProcessor  : public juce::AudioProcessor
+#include "ProceduralRenderer.h"
+#include "ActivityTracker.h"
+#include "ModelRegistry.h"
+#include "RenderPool.h"
+#include "LibraryService.h"
+#include "AuditionEngine.h"
+#include "SessionState.h"
+#include "PresetBank.h"
+#include "PerformanceMonitor.h"
+#include "TriggerScheduler.h"
+
+class QAPAudioProcessor  : public juce::AudioProcessor,
+                           private juce::ChangeListener,
+                           private juce::AudioProcessorValueTreeState::Listener,
+                           private juce::AsyncUpdater
                           
 {
 public:
@@ -24,6 +35,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -53,39 +65,97 @@ public:
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
-    void loadAllWavFilesFromFolder(const juce::File& folder);
+    void loadAllWavFilesFromFolder(const juce::File& folder);     // blocks while it scans: tests and tools
+    void loadLibraryFolderAsync(const juce::File& folder);          // scans on the library's pool, the editor's way
     void refreshWavFileList();          // Refresh list display (called from processor)
     void playWavFileByName(const juce::String& name);
+    void playWavFile(const juce::File& file, juce::int64 startSample = 0, juce::int64 endSample = -1);  // in the file's sample frames, -1 to its end
+    void preloadWavFiles(const juce::Array<juce::File>& files);   // open readers for rows the user may step to next
 
 
     // Variables
-    juce::StringArray wavFileNames;
-    juce::Array<juce::File> wavFilePaths;
-    
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-    juce::AudioTransportSource transportSource;
-    juce::AudioFormatManager formatManager;
+    juce::SharedResourcePointer<LibraryService> library;
+    AuditionEngine audition { [this] (const juce::File& file) { return library->createReaderFor (file); } };
     
-    juce::StringArray getWavFileNames() const { return wavFileNames; }
+    std::shared_ptr<const LibraryIndex> getLibraryIndex() const { return std::atomic_load (&libraryIndex); }
+    juce::StringArray getWavFileNames() const;
     juce::File getWavFileByName(const juce::String& name) const;
+
+    // Session state that belongs to the editor but has to outlive it
+    juce::String getSearchText() const;
+    void setSearchText (const juce::String& newText);
+    juce::String getProceduralModel() const;
+    void setProceduralModel (const juce::String& modelId);
+    juce::String getProjectId() const;      // what the library database records "used-in-project" under
     
-    // Procedural Explosion
-    
+    // Procedural models, declared before the parameters: the layout is built from them
+    ModelRegistry models;
+    TriggerScheduler scheduler;
+    void triggerModel (const juce::String& modelId);        // at the start of the next block
+    void startSequence (const juce::String& modelId, TriggerScheduler::Sequence sequence);
+    void stopSequences (const juce::String& modelId);
+    bool isModelAwake (const juce::String& modelId) const;
+
+    // Renders a take of the model with the current sliders, faster than real time and streamed
+    // to disk, into a new WAV file in `folder`. Returns {} if it failed. Not on the audio thread;
+    // the editor uses renderTakeAsync.
+    juce::File renderTake (const juce::String& modelId, const juce::File& folder);
+    static constexpr double takeSeconds = 20.0;     // continuous models (Fire), before the fade
+
+    // Copies [startSample, endSample) of a library file into a new WAV file in `folder`, read
+    // through the library's caches. Returns {} if it failed. Not on the audio thread either.
+    juce::File exportRegion (const juce::File& file, juce::int64 startSample, juce::int64 endSample, const juce::File& folder);
+
+    // renderTake and exportRegion on the export thread, into getTakesFolder() and getRegionsFolder();
+    // `onDone` gets the file ({} if it failed) on the message thread.
+    void renderTakeAsync (const juce::String& modelId, std::function<void (juce::File)> onDone);
+    void exportRegionAsync (const juce::File& file, juce::int64 startSample, juce::int64 endSample, std::function<void (juce::File)> onDone);
+
+    // Temp folders for what is dragged out to the DAW. Files older than tempFileHours are deleted
+    // before a new one is written: by then the DAW has copied or dropped them.
+    static juce::File getTakesFolder();
+    static juce::File getRegionsFolder();
+    static void deleteOldFiles (const juce::File& folder);
+    static constexpr int tempFileHours = 24;
     
     //ParameterValueTreeState
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState parameters;
+    PresetBank presets { parameters, models };
 
-    void triggerExplosion();
-    std::unique_ptr<nemisindo::Explosion> explosionModel;
-    void triggerFire();
-    std::unique_ptr<nemisindo::Fire> fireModel;
+    ProceduralRenderer proceduralRenderer;
+    RenderPool renderPool;      // off by default, see RenderPool::setEnabled
+    ActivityTracker activity;
+    PerformanceMonitor performance;
    
     
 
 
 private:
     //==============================================================================
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void prepareModels();
+    void applyLibraryIndex (std::shared_ptr<const LibraryIndex> index);
+    void requestLibraryIndex (const juce::File& folder, bool rescan);
+
+    std::shared_ptr<const LibraryIndex> libraryIndex;
+    std::atomic<juce::uint32> libraryRequest { 0 };     // bumped per load; older async results are dropped
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+
+    void renderBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&);
+    void renderModels (juce::AudioBuffer<float>&, int startSample, int numSamples);
+    void noteModelOutput (ProceduralModel&, float peak, int numSamples);
+
+    RealtimeCheckedLock sessionLock;
+    SessionState session;
+
+    juce::ThreadPool exportPool { 1 };      // last, so its jobs finish before anything they use goes
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (QAPAudioProcessor)
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QAPAudioProcessor)
     //void parameterChanged (const juce::String& parameterID, float newValue) override;
     
@@ -0,0 +1,297 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+    struct BankHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 numParameters;
+        juce::uint32 numPresets;
+    };
+
+    // Version 2 follows the header with the parameter IDs, then per preset the name
+    // (maxNameLength + 1 bytes) and one float per ID. Version 1 had no IDs and always
+    // stored legacyParameterIDs.
+    constexpr juce::uint32 bankMagic   = 0x4b4e4251; // "QBNK"
+    constexpr juce::uint32 bankVersion = 2;
+
+    // The columns of version-1 banks and of the factory table below. Matched by ID, so the
+    // models can add, drop or reorder parameters.
+    const char* const legacyParameterIDs[] =
+    {
+        "rumble", "rumbleDecay", "dust", "dustDecay", "air", "airDecay", "gritAmount", "timeSeparation",
+        "lapping", "hissing", "crackling", "intensity"
+    };
+
+    constexpr int numLegacyParameters = (int) (sizeof (legacyParameterIDs) / sizeof (legacyParameterIDs[0]));
+
+    struct FactoryPreset
+    {
+        const char* name;
+        float values[numLegacyParameters];
+    };
+
+    //   rumble rumbleDecay dust dustDecay air airDecay grit timeSep | lapping hissing crackling intensity
+    const FactoryPreset factoryPresets[] =
+    {
+        { "Default",          { 0.5f, 4.0f, 0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 0.5f,   0.5f, 0.5f, 0.5f, 0.5f } },
+        { "Distant Thunder",  { 0.9f, 4.0f, 0.1f, 0.5f, 0.2f, 4.0f, 0.1f, 0.8f,   0.5f, 0.5f, 0.5f, 0.5f } },
+        { "Close Blast",      { 0.7f, 1.5f, 0.8f, 2.5f, 1.0f, 1.5f, 0.9f, 0.0f,   0.5f, 0.5f, 0.5f, 0.5f } },
+        { "Debris Rain",      { 0.3f, 2.0f, 1.0f, 5.0f, 0.4f, 2.0f, 0.7f, 0.3f,   0.5f, 0.5f, 0.5f, 0.5f } },
+        { "Campfire",         { 0.5f, 4.0f, 0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 0.5f,   0.3f, 0.2f, 0.6f, 0.3f } },
+        { "Forest Blaze",     { 0.5f, 4.0f, 0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 0.5f,   0.9f, 0.7f, 0.8f, 1.0f } },
+        { "Embers",           { 0.5f, 4.0f, 0.5f, 1.0f, 0.5f, 1.0f, 0.5f, 0.5f,   0.1f, 0.4f, 0.9f, 0.1f } },
+    };
+}
+
+//==============================================================================
+void ParameterBlock::setName (const juce::String& newName)
+{
+    std::fill (std::begin (name), std::end (name), 0);
+    newName.copyToUTF8 (name, sizeof (name));
+}
+
+//==============================================================================
+PresetBank::PresetBank (juce::AudioProcessorValueTreeState& state, const ModelRegistry& models)
+    : parameters (state)
+{
+    for (int m = 0; m < models.size(); ++m)
+    {
+        for (auto& spec : models[m].getParameterSpecs())
+        {
+            auto* target = parameters.getParameter (spec.id);
+            jassert (target != nullptr); // a model parameter is missing from createParameterLayout
+
+            if (target != nullptr)
+            {
+                parameterIDs.add (spec.id);
+                targets.push_back (target);
+            }
+        }
+    }
+
+    for (auto& preset : factoryPresets)
+    {
+        auto block = std::make_unique<ParameterBlock>();
+        block->setName (preset.name);
+
+        for (auto* target : targets)
+            block->values.push_back (target->convertFrom0to1 (target->getDefaultValue()));
+
+        for (int i = 0; i < numLegacyParameters; ++i)
+        {
+            const auto index = parameterIDs.indexOf (legacyParameterIDs[i]);
+
+            if (index >= 0)
+                block->values[(size_t) index] = preset.values[i];
+        }
+
+        addBlock (std::move (block));
+    }
+
+    numFactoryPresets = size();
+    loadUserBank();
+
+    startTimerHz (30);
+}
+
+PresetBank::~PresetBank()
+{
+    stopTimer();
+}
+
+juce::String PresetBank::getName (int index) const
+{
+    if (juce::isPositiveAndBelow (index, size()))
+        return blockTable[index].load (std::memory_order_acquire)->getName();
+
+    return {};
+}
+
+void PresetBank::select (int index) noexcept
+{
+    if (! juce::isPositiveAndBelow (index, size()))
+        return;
+
+    currentIndex.store (index, std::memory_order_relaxed);
+    pending.store (blockTable[index].load (std::memory_order_acquire), std::memory_order_release);
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        applyPendingSelection();
+}
+
+void PresetBank::applyPendingSelection()
+{
+    auto* block = pending.exchange (nullptr, std::memory_order_acq_rel);
+
+    if (block == nullptr)
+        return;
+
+    for (size_t i = 0; i < targets.size(); ++i)
+        targets[i]->setValueNotifyingHost (targets[i]->convertTo0to1 (block->values[i]));
+}
+
+void PresetBank::timerCallback()
+{
+    // Program changes from the audio thread (MIDI) or a host thread land here.
+    applyPendingSelection();
+}
+
+void PresetBank::addBlock (std::unique_ptr<ParameterBlock> block)
+{
+    const int index = size();
+
+    if (index >= maxPresets)
+    {
+        jassertfalse;
+        return;
+    }
+
+    blockTable[index].store (block.get(), std::memory_order_release);
+    blocks.add (block.release());
+    numBlocks.store (index + 1, std::memory_order_release);
+}
+
+//==============================================================================
+int PresetBank::saveUserPreset (const juce::String& name)
+{
+    auto block = std::make_unique<ParameterBlock>();
+    block->setName (name);
+
+    for (auto* target : targets)
+        block->values.push_back (target->convertFrom0to1 (target->getValue()));
+
+    addBlock (std::move (block));
+    writeUserBank();
+
+    const int index = size() - 1;
+    currentIndex.store (index, std::memory_order_relaxed);
+    return index;
+}
+
+void PresetBank::renameUserPreset (int index, const juce::String& newName)
+{
+    if (isFactoryPreset (index) || ! juce::isPositiveAndBelow (index, size()))
+        return;
+
+    // Blocks are immutable, so a rename publishes a copy; the old block stays alive
+    // in case another thread is still holding it.
+    auto renamed = std::make_unique<ParameterBlock> (*blockTable[index].load());
+    renamed->setName (newName);
+
+    blockTable[index].store (renamed.get(), std::memory_order_release);
+    blocks.add (renamed.release());
+    writeUserBank();
+}
+
+juce::File PresetBank::getUserBankFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("QAP")
+               .getChildFile ("UserPresets.qapbank");
+}
+
+void PresetBank::loadUserBank()
+{
+    auto file = getUserBankFile();
+
+    if (! file.existsAsFile())
+        return;
+
+    juce::MemoryMappedFile mapped (file, juce::MemoryMappedFile::readOnly);
+
+    if (mapped.getData() == nullptr || mapped.getSize() < sizeof (BankHeader))
+        return;
+
+    juce::MemoryInputStream in (mapped.getData(), mapped.getSize(), false);
+    BankHeader header;
+    in.read (&header, sizeof (header));
+
+    if (header.magic != bankMagic || (header.version != 1 && header.version != bankVersion)
+         || (header.version == 1 && header.numParameters != (juce::uint32) numLegacyParameters))
+        return;
+
+    // Where each stored column goes in our blocks, -1 for parameters the models no longer have.
+    std::vector<int> columns;
+
+    for (juce::uint32 i = 0; i < header.numParameters; ++i)
+    {
+        if (in.isExhausted())
+            return;
+
+        const auto id = header.version == 1 ? juce::String (legacyParameterIDs[i]) : in.readString();
+        columns.push_back (parameterIDs.indexOf (id));
+    }
+
+    const auto recordBytes = (juce::int64) (ParameterBlock::maxNameLength + 1) + (juce::int64) sizeof (float) * header.numParameters;
+    const auto count = juce::jmin ((juce::int64) header.numPresets, in.getNumBytesRemaining() / recordBytes);
+
+    for (juce::int64 n = 0; n < count; ++n)
+    {
+        auto block = std::make_unique<ParameterBlock>();
+        in.read (block->name, sizeof (block->name));
+        block->name[ParameterBlock::maxNameLength] = 0;
+
+        for (auto* target : targets)
+            block->values.push_back (target->convertFrom0to1 (target->getDefaultValue()));
+
+        for (auto column : columns)
+        {
+            float value = 0.0f;
+            in.read (&value, sizeof (value));
+
+            if (column >= 0)
+                block->values[(size_t) column] = value;
+        }
+
+        addBlock (std::move (block));
+    }
+}
+
+bool PresetBank::writeUserBank() const
+{
+    auto file = getUserBankFile();
+    file.getParentDirectory().createDirectory();
+
+    const int total = size();
+
+    BankHeader header { bankMagic, bankVersion, (juce::uint32) parameterIDs.size(), (juce::uint32) (total - numFactoryPresets) };
+
+    // Written next to the target and renamed over it, so a crash mid-save
+    // never leaves a half-written bank behind.
+    juce::TemporaryFile temp (file);
+
+    if (auto out = temp.getFile().createOutputStream())
+    {
+        out->write (&header, sizeof (header));
+
+        for (auto& id : parameterIDs)
+            out->writeString (id);
+
+        for (int i = numFactoryPresets; i < total; ++i)
+        {
+            auto* block = blockTable[i].load();
+            out->write (block->name, sizeof (block->name));
+            out->write (block->values.data(), block->values.size() * sizeof (float));
+        }
+
+        out->flush();
+
+        if (out->getStatus().wasOk())
+        {
+            out.reset();
+            return temp.overwriteTargetFileWithTemporary();
+        }
+    }
+
+    return false;
+}
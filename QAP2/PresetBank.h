@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Factory and user presets for the procedural models' parameters.
+
+    Each preset is an immutable ParameterBlock. Blocks are only ever appended,
+    so any thread can hold a plain pointer to one: selecting a program is a
+    single atomic pointer exchange, applied to the parameters on the message
+    thread. The parameters come from the model registry.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "ModelRegistry.h"
+
+// A preset: a name and one plain (not normalised) value per preset parameter, in the bank's
+// parameter order (see PresetBank::getParameterIDs).
+struct ParameterBlock
+{
+    static constexpr int maxNameLength = 31;
+
+    char name[maxNameLength + 1] {};
+    std::vector<float> values;
+
+    juce::String getName() const    { return juce::String::fromUTF8 (name); }
+    void setName (const juce::String& newName);
+};
+
+class PresetBank  : private juce::Timer
+{
+public:
+    // Presets cover every parameter the registered models declare.
+    PresetBank (juce::AudioProcessorValueTreeState& state, const ModelRegistry& models);
+    ~PresetBank() override;
+
+    int size() const noexcept                    { return numBlocks.load (std::memory_order_acquire); }
+    int getCurrentIndex() const noexcept         { return currentIndex.load (std::memory_order_relaxed); }
+    juce::String getName (int index) const;
+    int getNumFactoryPresets() const noexcept         { return numFactoryPresets; }
+    int getNumUserPresets() const noexcept            { return size() - numFactoryPresets; }
+    bool isFactoryPreset (int index) const noexcept   { return index < numFactoryPresets; }
+    const juce::StringArray& getParameterIDs() const noexcept  { return parameterIDs; }
+
+    // Any thread (host program change, MIDI, editor). Never locks or allocates. On the message
+    // thread the preset applies at once, from anywhere else at the next timer tick.
+    void select (int index) noexcept;
+
+    // Message thread. Copies a newly selected block into the parameters, telling the host.
+    void applyPendingSelection();
+
+    // Message thread. Captures the current parameter values as a new user preset.
+    int saveUserPreset (const juce::String& name);
+    void renameUserPreset (int index, const juce::String& newName);
+
+    static juce::File getUserBankFile();
+
+    static constexpr int maxPresets = 512;
+
+private:
+    void timerCallback() override;
+    void addBlock (std::unique_ptr<ParameterBlock> block);
+    void loadUserBank();
+    bool writeUserBank() const;
+
+    juce::AudioProcessorValueTreeState& parameters;
+    juce::StringArray parameterIDs;
+    std::vector<juce::RangedAudioParameter*> targets;   // one per ID
+
+    // Append-only: blocks are never freed or moved until the bank is destroyed.
+    juce::OwnedArray<ParameterBlock> blocks;
+    std::atomic<const ParameterBlock*> blockTable[maxPresets] {};
+    std::atomic<int> numBlocks { 0 };
+    int numFactoryPresets = 0;
+
+    std::atomic<const ParameterBlock*> pending { nullptr };
+    std::atomic<int> currentIndex { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+
+    ProceduralModels.cpp
+
+  ==============================================================================
+*/
+
+#include "ProceduralModels.h"
+
+namespace
+{
+    std::vector<float> currentValues (const ProceduralModel& model)
+    {
+        std::vector<float> values (model.getParameterSpecs().size());
+
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = model.getParameter ((int) i);
+
+        return values;
+    }
+
+    // fillBuffer takes float**, which AudioBuffer only hands out as const: keep our own array, as
+    // ProceduralRenderer does. Clear through it too, so the buffer's cleared flag never goes stale.
+    std::vector<float*> getChannelPointers (juce::AudioBuffer<float>& buffer)
+    {
+        std::vector<float*> pointers ((size_t) buffer.getNumChannels());
+
+        for (size_t ch = 0; ch < pointers.size(); ++ch)
+            pointers[ch] = buffer.getWritePointer ((int) ch);
+
+        return pointers;
+    }
+
+    void clearChannels (const std::vector<float*>& channels, int numSamples)
+    {
+        for (auto* channel : channels)
+            juce::FloatVectorOperations::clear (channel, numSamples);
+    }
+
+    // Streams a model into `writer` one chunk at a time, so a long take never sits in memory
+    // as a whole. `keepGoing` is asked before every chunk with the samples written so far.
+    template <typename Model, typename KeepGoing>
+    bool streamTake (Model& model, juce::AudioFormatWriter& writer, int oversampling, KeepGoing keepGoing)
+    {
+        constexpr int chunk = 4096;
+        Oversampler oversampler;
+        oversampler.prepare (oversampling, ProceduralModel::numChannels, chunk);
+
+        // The writer takes channel 0, the model's output.
+        juce::AudioBuffer<float> output (ProceduralModel::numChannels, chunk);
+        auto channels = getChannelPointers (output);
+
+        for (juce::int64 written = 0; keepGoing (model, written); written += chunk)
+        {
+            clearChannels (channels, chunk);
+
+            if (oversampler.getFactor() > 1)
+            {
+                model.fillBuffer (oversampler.getInput (chunk), chunk * oversampler.getFactor());
+                oversampler.decimate (channels[0], chunk);
+            }
+            else
+            {
+                model.fillBuffer (channels.data(), chunk);
+            }
+
+            if (! writer.writeFromAudioSampleBuffer (output, 0, chunk))
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+const std::vector<ModelParameterSpec>& ExplosionModel::getParameterSpecs() const
+{
+    // Same order as the Parameter enum.
+    static const std::vector<ModelParameterSpec> specs
+    {
+        { "rumble",         "Rumble",          0.1f, 1.0f, 0.5f, true },
+        { "rumbleDecay",    "Rumble Decay",    0.5f, 4.0f, 4.0f, true },
+        { "dust",           "Dust",            0.0f, 1.0f, 0.5f, true },
+        { "dustDecay",      "Dust Decay",      0.0f, 5.0f, 1.0f, true },
+        { "air",            "Air",             0.0f, 1.0f, 0.5f, true },
+        { "airDecay",       "Air Decay",       1.0f, 5.0f, 1.0f, true },
+        { "gritAmount",     "Grit Amount",     0.0f, 1.0f, 0.5f, true },
+        { "timeSeparation", "Time Separation", 0.0f, 1.0f, 0.5f, true }
+    };
+
+    return specs;
+}
+
+void ExplosionModel::trigger()
+{
+    if (bank.canPlay())
+    {
+        bank.trigger();
+        return;
+    }
+
+    model.setRumble (getParameter (rumble));
+    model.setRumbleDecay (getParameter (rumbleDecay));
+    model.setAir (getParameter (air));
+    model.setAirDecay (getParameter (airDecay));
+    model.setDust (getParameter (dust));
+    model.setDustDecay (getParameter (dustDecay));
+    model.setTimeSeparation (0.0f);
+    model.setGrit (true);
+    model.setGritAmount (getParameter (gritAmount));
+    model.setOverTheTop (true);
+    model.trigger();
+}
+
+double ExplosionModel::getTailSeconds() const
+{
+    // The layers decay independently, the longest one decides, plus the silence hold
+    // so the host keeps calling us until the tracker has had a chance to go idle.
+    return (double) juce::jmax (getParameter (rumbleDecay), getParameter (airDecay), getParameter (dustDecay))
+             + ActivityTracker::silenceHoldSeconds;
+}
+
+void ExplosionModel::prepare (double sampleRate, int maximumBlockSize)
+{
+    model.initialize ((float) (sampleRate * getOversampling()));
+    bank.prepare (sampleRate, maximumBlockSize);
+}
+
+void ExplosionModel::release()
+{
+    bank.release();
+}
+
+bool ExplosionModel::isActive()
+{
+    return model.isActive() || bank.isActive();
+}
+
+float ExplosionModel::render (ProceduralRenderer& renderer, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    // A live explosion triggered before the bank was ready rings out alongside the baked ones.
+    float peak = bank.renderAdding (output, startSample, numSamples);
+
+    if (model.isActive())
+        peak = juce::jmax (peak, renderer.renderAdding (model, getOversampler(), output, startSample, numSamples));
+
+    return peak;
+}
+
+void ExplosionModel::applyParameters (nemisindo::Explosion& target, const std::vector<float>& values)
+{
+    target.setRumble (values[rumble]);
+    target.setRumbleDecay (values[rumbleDecay]);
+    target.setAir (values[air]);
+    target.setAirDecay (values[airDecay]);
+    target.setDust (values[dust]);
+    target.setDustDecay (values[dustDecay]);
+    target.setTimeSeparation (0.0f);
+    target.setGrit (true);
+    target.setGritAmount (values[gritAmount]);
+    target.setOverTheTop (true);
+}
+
+int ExplosionModel::renderVariation (const std::vector<float>& values, double sampleRate, juce::AudioBuffer<float>& output)
+{
+    bakingModel.initialize ((float) sampleRate);
+    applyParameters (bakingModel, values);
+    bakingModel.trigger();
+
+    // Until the tail has died away, or the bank's length limit.
+    int length = 0;
+    constexpr int chunk = 256;
+    juce::AudioBuffer<float> scratch (numChannels, chunk);
+    auto channels = getChannelPointers (scratch);
+
+    while (bakingModel.isActive() && length < output.getNumSamples())
+    {
+        const int n = juce::jmin (chunk, output.getNumSamples() - length);
+        clearChannels (channels, n);
+        bakingModel.fillBuffer (channels.data(), n);
+        output.copyFrom (0, length, scratch, 0, 0, n);
+        length += n;
+    }
+
+    return length;
+}
+
+bool ExplosionModel::renderTake (juce::AudioFormatWriter& writer, double sampleRate, int oversampling, double)
+{
+    auto take = std::make_unique<nemisindo::Explosion>();
+    take->initialize ((float) (sampleRate * oversampling));
+    applyParameters (*take, currentValues (*this));
+    take->trigger();
+
+    // Until the tail has died away; a minute at most.
+    const auto maxSamples = (juce::int64) (60.0 * sampleRate);
+
+    return streamTake (*take, writer, oversampling, [maxSamples] (nemisindo::Explosion& model, juce::int64 written)
+                       { return model.isActive() && written < maxSamples; });
+}
+
+//==============================================================================
+const std::vector<ModelParameterSpec>& FireModel::getParameterSpecs() const
+{
+    static const std::vector<ModelParameterSpec> specs
+    {
+        { "lapping",   "Lapping",   0.0f, 1.0f, 0.5f, true },
+        { "hissing",   "Hissing",   0.0f, 1.0f, 0.5f, true },
+        { "crackling", "Crackling", 0.0f, 1.0f, 0.5f, true },
+        { "intensity", "Intensity", 0.0f, 1.0f, 0.5f, true }
+    };
+
+    return specs;
+}
+
+void FireModel::trigger()
+{
+    if (model.isActive() || bed.isRunning())
+    {
+        model.stop();
+        bed.setRunning (false);
+        burning = false;
+        return;
+    }
+
+    if (bed.canPlay())
+        bed.setRunning (true);
+    else
+        model.start();
+
+    burning = true;
+}
+
+double FireModel::getTailSeconds() const
+{
+    // Once stopped: the model's fade or the last grains of the bed, then the silence hold.
+    return juce::jmax (fadeSeconds, GranularBed::Settings().grainSeconds) + ActivityTracker::silenceHoldSeconds;
+}
+
+void FireModel::prepare (double sampleRate, int maximumBlockSize)
+{
+    model.initialize ((float) (sampleRate * getOversampling()));
+    bed.prepare (sampleRate, maximumBlockSize);
+}
+
+void FireModel::release()
+{
+    bed.release();
+}
+
+bool FireModel::isActive()
+{
+    return model.isActive() || bed.isActive();
+}
+
+float FireModel::render (ProceduralRenderer& renderer, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    // Fire follows its sliders continuously, not only when triggered.
+    model.setLapping (getParameter (lapping));
+    model.setHissing (getParameter (hissing));
+    model.setCrackling (getParameter (crackling));
+    model.setIntensity (getParameter (intensity));
+
+    // Grains already sounding finish on their own once the bed is stopped.
+    float peak = bed.renderAdding (output, startSample, numSamples);
+
+    // Burning at zero intensity is silent: skip the model until the slider comes back up. Once
+    // stopped it always renders, so its fade runs out.
+    if (model.isActive() && ! (burning && getParameter (intensity) <= 0.0f))
+        peak = juce::jmax (peak, renderer.renderAdding (model, getOversampler(), output, startSample, numSamples));
+
+    return peak;
+}
+
+void FireModel::applyParameters (nemisindo::Fire& target, const std::vector<float>& values)
+{
+    target.setLapping (values[lapping]);
+    target.setHissing (values[hissing]);
+    target.setCrackling (values[crackling]);
+    target.setIntensity (values[intensity]);
+}
+
+bool FireModel::renderTake (juce::AudioFormatWriter& writer, double sampleRate, int oversampling, double seconds)
+{
+    auto take = std::make_unique<nemisindo::Fire>();
+    take->initialize ((float) (sampleRate * oversampling));
+    applyParameters (*take, currentValues (*this));
+    take->start();
+
+    // Burn for `seconds`, then let the model's own fade finish the take.
+    const auto stopAt = (juce::int64) (seconds * sampleRate);
+    const auto maxSamples = stopAt + (juce::int64) (10.0 * sampleRate);
+
+    return streamTake (*take, writer, oversampling, [stopAt, maxSamples] (nemisindo::Fire& model, juce::int64 written)
+                       {
+                           if (written >= stopAt)
+                               model.stop();
+
+                           return model.isActive() && written < maxSamples;
+                       });
+}
+
+void FireModel::renderSource (const std::vector<float>& values, double sampleRate, juce::AudioBuffer<float>& output)
+{
+    bakingModel.initialize ((float) sampleRate);
+    applyParameters (bakingModel, values);
+    bakingModel.start();
+
+    // Skip the start-up fade: grains are taken from anywhere in the source.
+    constexpr int chunk = 256;
+    int preRoll = (int) (0.1 * sampleRate);
+    juce::AudioBuffer<float> scratch (numChannels, chunk);
+    auto channels = getChannelPointers (scratch);
+
+    while (preRoll > 0)
+    {
+        clearChannels (channels, chunk);
+        bakingModel.fillBuffer (channels.data(), juce::jmin (chunk, preRoll));
+        preRoll -= chunk;
+    }
+
+    for (int pos = 0; pos < output.getNumSamples(); pos += chunk)
+    {
+        const int n = juce::jmin (chunk, output.getNumSamples() - pos);
+        clearChannels (channels, n);
+        bakingModel.fillBuffer (channels.data(), n);
+        output.copyFrom (0, pos, scratch, 0, 0, n);
+    }
+}
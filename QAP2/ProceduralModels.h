@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    ProceduralModels.h
+    The built-in procedural models, wrapping the nemisindo implementations.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ModelRegistry.h"
+#include "SampleBank.h"
+#include "GranularBed.h"
+#include "ExplosionImpl.h"
+#include "FireImpl.h"
+
+//==============================================================================
+class ExplosionModel  : public ProceduralModel
+{
+public:
+    enum Parameter { rumble, rumbleDecay, dust, dustDecay, air, airDecay, gritAmount, timeSeparation };
+
+    const char* getId() const override                  { return "explosion"; }
+    juce::String getDisplayName() const override        { return "Procedural Explosion"; }
+    juce::String getTriggerLabel() const override       { return "Trigger Explosion"; }
+    juce::String getAssistantText() const override      { return "Hi.An explosion"; }
+    juce::StringArray getSearchKeywords() const override    { return { "explosion" }; }
+    const std::vector<ModelParameterSpec>& getParameterSpecs() const override;
+
+    void trigger() override;
+    float getSequenceJitter() const noexcept override   { return getParameter (timeSeparation); }
+    double getTailSeconds() const override;
+
+    void prepare (double sampleRate, int maximumBlockSize) override;
+    void release() override;
+    bool isActive() override;
+    float render (ProceduralRenderer&, juce::AudioBuffer<float>&, int startSample, int numSamples) override;
+
+    bool renderTake (juce::AudioFormatWriter&, double sampleRate, int oversampling, double seconds) override;
+
+    bool isBakedReady() const noexcept override     { return bank.isFull(); }
+    void bakedModeChanged() override                { bank.wake(); }
+    SampleBank& getSampleBank() noexcept            { return bank; }
+
+private:
+    int renderVariation (const std::vector<float>& values, double sampleRate, juce::AudioBuffer<float>& output);
+    static void applyParameters (nemisindo::Explosion& target, const std::vector<float>& values);
+
+    nemisindo::Explosion model;
+    nemisindo::Explosion bakingModel;       // only used on the bank's thread
+
+    SampleBank bank { *this, { 16, 8.0, 0.08f, 2.0f, 3.0f },
+                      [this] (const std::vector<float>& values, double rate, juce::AudioBuffer<float>& output)
+                      { return renderVariation (values, rate, output); } };
+};
+
+//==============================================================================
+class FireModel  : public ProceduralModel
+{
+public:
+    enum Parameter { lapping, hissing, crackling, intensity };
+
+    const char* getId() const override                  { return "fire"; }
+    juce::String getDisplayName() const override        { return "Procedural Fire"; }
+    juce::String getTriggerLabel() const override       { return "Start Fire"; }
+    juce::String getAssistantText() const override      { return "Hi.Fire sounds"; }
+    juce::StringArray getSearchKeywords() const override    { return { "fire" }; }
+    const std::vector<ModelParameterSpec>& getParameterSpecs() const override;
+
+    // Toggles: starts the fire, or stops it if it is burning.
+    void trigger() override;
+    double getTailSeconds() const override;
+
+    void prepare (double sampleRate, int maximumBlockSize) override;
+    void release() override;
+    bool isActive() override;
+    float render (ProceduralRenderer&, juce::AudioBuffer<float>&, int startSample, int numSamples) override;
+    bool isSustained() const noexcept override      { return burning; }
+
+    bool renderTake (juce::AudioFormatWriter&, double sampleRate, int oversampling, double seconds) override;
+
+    bool isBakedReady() const noexcept override     { return bed.isReady(); }
+    void bakedModeChanged() override                { bed.wake(); }
+    GranularBed& getGranularBed() noexcept          { return bed; }
+
+private:
+    void renderSource (const std::vector<float>& values, double sampleRate, juce::AudioBuffer<float>& output);
+    static void applyParameters (nemisindo::Fire& target, const std::vector<float>& values);
+
+    // Longer than the model's own fade once stopped
+    static constexpr double fadeSeconds = 0.1;
+
+    nemisindo::Fire model;
+    nemisindo::Fire bakingModel;            // only used on the bed's thread
+    bool burning = false;                   // audio thread: started and not stopped since
+
+    GranularBed bed { *this, {},
+                      [this] (const std::vector<float>& values, double rate, juce::AudioBuffer<float>& output)
+                      { renderSource (values, rate, output); } };
+};
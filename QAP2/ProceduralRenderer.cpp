@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    ProceduralRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "ProceduralRenderer.h"
+
+void ProceduralRenderer::prepare (int numChannels, int maximumBlockSize)
+{
+    numChannels = juce::jmax (1, numChannels);
+    preparedBlockSize = juce::jmax (subBlockSize, maximumBlockSize);
+
+    // Each channel starts on an `alignment` boundary so the models and the
+    // vector ops always see aligned pointers, whatever the host block size is.
+    const size_t floatsPerLine  = alignment / sizeof (float);
+    const size_t channelStride  = ((size_t) preparedBlockSize + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    const size_t bytesNeeded    = channelStride * sizeof (float) * (size_t) numChannels + alignment;
+
+    storage.allocate (bytesNeeded, true);
+
+    auto* base = reinterpret_cast<float*> (juce::snapPointerToAlignment (storage.get(), (size_t) alignment));
+
+    channelPointers.resize ((size_t) numChannels);
+    for (size_t ch = 0; ch < channelPointers.size(); ++ch)
+        channelPointers[ch] = base + ch * channelStride;
+}
+
+void ProceduralRenderer::release()
+{
+    channelPointers.clear();
+    storage.free();
+    preparedBlockSize = 0;
+}
+
+void ProceduralRenderer::clearScratch (int numSamples) noexcept
+{
+    for (auto* channel : channelPointers)
+        juce::FloatVectorOperations::clear (channel, numSamples);
+}
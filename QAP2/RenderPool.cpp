@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    RenderPool.cpp
+
+  ==============================================================================
+*/
+
+#include "RenderPool.h"
+#include "PerformanceMonitor.h"
+#include <thread>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    // A hint to the core that we are spinning; unlike yield() it never enters the scheduler.
+    inline void spinPause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+}
+
+//==============================================================================
+class RenderPool::Worker  : public juce::Thread
+{
+public:
+    explicit Worker (RenderPool& p) : juce::Thread ("QAP render worker"), pool (p) {}
+
+    void run() override
+    {
+        auto seen = pool.generation.load (std::memory_order_acquire);
+
+        while (! threadShouldExit())
+        {
+            if (spinForBlock (seen))
+            {
+                pool.runJobs();
+                continue;
+            }
+
+            // No block for a while: park until the message thread wakes us, or the timeout
+            // finds that the audio thread asked for us.
+            pool.parkedWorkers.fetch_add (1);
+
+            while (! threadShouldExit())
+                if (wakeUp.wait (parkTimeoutMs) || pool.wakeRequested.load (std::memory_order_relaxed))
+                    break;
+
+            if (pool.parkedWorkers.fetch_sub (1) == 1)
+                pool.wakeRequested.store (false, std::memory_order_relaxed);
+
+            // Whatever of the current block is still unclaimed is ours to help with.
+            seen = pool.generation.load (std::memory_order_acquire);
+            pool.runJobs();
+        }
+    }
+
+    void wake()
+    {
+        wakeUp.signal();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread (1000);
+    }
+
+private:
+    // True once a new block is published, false once twice the last gap between blocks has passed without one.
+    bool spinForBlock (juce::uint32& seen)
+    {
+        const auto minSpinTicks = juce::Time::getHighResolutionTicksPerSecond() / 1000;
+        const auto maxSpinTicks = juce::Time::getHighResolutionTicksPerSecond() / 50;
+
+        while (! threadShouldExit())
+        {
+            const auto current = pool.generation.load (std::memory_order_acquire);
+
+            if (current != seen)
+            {
+                seen = current;
+                return true;
+            }
+
+            const auto spinTicks = juce::jlimit (minSpinTicks, maxSpinTicks, 2 * pool.blockIntervalTicks.load (std::memory_order_relaxed));
+
+            if (juce::Time::getHighResolutionTicks() - pool.lastBlockTicks.load (std::memory_order_relaxed) > spinTicks)
+                return false;
+
+            std::this_thread::yield();
+        }
+
+        return false;
+    }
+
+    static constexpr int parkTimeoutMs = 10;
+
+    RenderPool& pool;
+    juce::WaitableEvent wakeUp;
+};
+
+//==============================================================================
+RenderPool::~RenderPool()
+{
+    release();
+}
+
+void RenderPool::prepare (int maximumJobs, int numChannels, int maximumBlockSize)
+{
+    release();
+
+    for (int i = 0; i < maximumJobs; ++i)
+    {
+        auto* job = jobs.add (new Job());
+        job->renderer.prepare (numChannels, maximumBlockSize);
+        job->output.setSize (1, maximumBlockSize);
+    }
+
+    if (enabled)
+        startWorkers();
+}
+
+void RenderPool::release()
+{
+    stopWorkers();
+    jobs.clear();
+    work.store (0);
+}
+
+void RenderPool::setEnabled (bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+
+    if (! enabled)
+        stopWorkers();
+    else if (workers.isEmpty() && ! jobs.isEmpty())
+        startWorkers();
+}
+
+void RenderPool::startWorkers()
+{
+    // The audio thread renders too, so one worker fewer than jobs is enough.
+    const int numWorkers = juce::jmin (jobs.size() - 1, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this));
+        worker->startThread (juce::Thread::Priority::highest);
+    }
+
+    running.store (! workers.isEmpty());
+}
+
+void RenderPool::stopWorkers()
+{
+    // A block already past shouldRunParallel() finishes without them: the audio thread claims what is left.
+    running.store (false);
+
+    for (auto* worker : workers)
+        worker->stop();
+
+    workers.clear();
+    parkedWorkers.store (0);
+    wakeRequested.store (false);
+}
+
+void RenderPool::wakeWorkers()
+{
+    for (auto* worker : workers)
+        worker->wake();
+}
+
+//==============================================================================
+bool RenderPool::shouldRunParallel (int numJobs, int numSamples) const noexcept
+{
+    return running.load (std::memory_order_relaxed)
+        && numJobs > 1
+        && numJobs <= jobs.size()
+        && numSamples >= minParallelBlockSize
+        && numSamples <= jobs.getUnchecked (0)->output.getNumSamples();
+}
+
+void RenderPool::render (const ModelRegistry& models, int numAwake, int numSamples, ProceduralRenderer::Mode mode) noexcept
+{
+    // All jobs of the previous block have been claimed, so nobody reads these while we write them.
+    for (int i = 0; i < numAwake; ++i)
+    {
+        auto& job = *jobs.getUnchecked (i);
+        job.model = models.getAwake (i);
+        job.renderer.setMode (mode);
+    }
+
+    const auto now = juce::Time::getHighResolutionTicks();
+    const auto previous = lastBlockTicks.load (std::memory_order_relaxed);
+    blockIntervalTicks.store (previous > 0 ? now - previous : 0, std::memory_order_relaxed);
+    lastBlockTicks.store (now, std::memory_order_relaxed);
+
+    blockSamples = numSamples;
+    jobsRemaining.store (numAwake, std::memory_order_relaxed);
+    work.store ((juce::uint64) numAwake << 32, std::memory_order_release);
+    generation.fetch_add (1, std::memory_order_release);
+
+    // Parked workers are left to their timeout: signalling an event takes a lock.
+    if (parkedWorkers.load (std::memory_order_relaxed) > 0)
+        wakeRequested.store (true, std::memory_order_relaxed);
+
+    // Claims every job no worker has taken yet, so all that is left to wait for is the
+    // jobs already being rendered, each bounded by one model's block.
+    runJobs();
+
+    while (jobsRemaining.load (std::memory_order_acquire) > 0)
+        spinPause();
+}
+
+bool RenderPool::claimJob (int& index) noexcept
+{
+    auto current = work.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        const auto count = (int) (current >> 32);
+        const auto next  = (int) (current & 0xffffffffu);
+
+        if (next >= count)
+            return false;
+
+        if (work.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            index = next;
+            return true;
+        }
+    }
+}
+
+void RenderPool::runJobs() noexcept
+{
+    juce::ScopedNoDenormals noDenormals;
+    int index;
+
+    while (claimJob (index))
+    {
+        auto& job = *jobs.getUnchecked (index);
+        const int numSamples = blockSamples;
+
+        job.active = job.model->isActive();
+        job.peak = 0.0f;
+        job.cycles = 0;
+
+        if (job.active)
+        {
+            const auto start = PerformanceMonitor::readCycleCounter();
+            job.output.clear (0, 0, numSamples);
+            job.peak = job.model->render (job.renderer, job.output, 0, numSamples);
+            job.cycles = PerformanceMonitor::readCycleCounter() - start;
+        }
+
+        jobsRemaining.fetch_sub (1, std::memory_order_release);
+    }
+}
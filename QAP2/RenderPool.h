@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    RenderPool.h
+    Optional worker threads that render the awake procedural models of one
+    block in parallel. Each model renders into its own scratch buffer; the
+    audio thread takes part in the work, waits on a lock-free counter for
+    the rest, and then mixes the results in registry order, so the output is
+    identical to the serial path. The audio thread only touches atomics:
+    workers spin while blocks keep coming and park once they stop, and a
+    parked worker is woken from the message thread or by its own timeout,
+    never by the audio thread. Whatever no worker has claimed, the audio
+    thread renders itself. While the pool is disabled no worker runs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "ModelRegistry.h"
+
+class RenderPool
+{
+public:
+    // Below this block size the hand-off costs more than the models themselves.
+    static constexpr int minParallelBlockSize = 256;
+
+    struct Job
+    {
+        ProceduralModel* model = nullptr;
+        bool active = false;            // false if the model had nothing left to render
+        float peak = 0.0f;
+        juce::uint64 cycles = 0;
+
+        ProceduralRenderer renderer;    // the renderer's scratch is per thread of work
+        juce::AudioBuffer<float> output;
+    };
+
+    RenderPool() = default;
+    ~RenderPool();
+
+    // Message thread: allocates one job per model, and starts the workers if the pool is enabled.
+    void prepare (int maximumJobs, int numChannels, int maximumBlockSize);
+    void release();
+
+    // Message thread: wakes parked workers ahead of a burst of work, e.g. when a model is triggered.
+    void wakeWorkers();
+
+    // Message thread: starts or stops the workers of a prepared pool.
+    void setEnabled (bool shouldBeEnabled);
+    bool isEnabled() const noexcept                    { return enabled; }
+    int getNumWorkers() const noexcept                 { return workers.size(); }
+
+    //==============================================================================
+    // Audio thread
+    bool shouldRunParallel (int numJobs, int numSamples) const noexcept;
+
+    // Renders the first `numAwake` awake models of the registry and returns once all of them are done.
+    void render (const ModelRegistry& models, int numAwake, int numSamples, ProceduralRenderer::Mode mode) noexcept;
+
+    const Job& getJob (int index) const noexcept       { return *jobs.getUnchecked (index); }
+
+private:
+    class Worker;
+
+    void startWorkers();
+    void stopWorkers();
+    void runJobs() noexcept;
+    bool claimJob (int& index) noexcept;
+
+    juce::OwnedArray<Job> jobs;
+    juce::OwnedArray<Worker> workers;
+    bool enabled = false;
+    std::atomic<bool> running { false };            // workers started: what the audio thread checks
+
+    // Jobs of the current block: count in the high half, next unclaimed index in the
+    // low half, so a worker waking up late can never claim a job that is being set up.
+    std::atomic<juce::uint64> work { 0 };
+    std::atomic<int> jobsRemaining { 0 };
+    std::atomic<juce::uint32> generation { 0 };
+    int blockSamples = 0;
+
+    // When the last block started and the gap before it, so workers know how long to keep spinning.
+    std::atomic<juce::int64> lastBlockTicks { 0 }, blockIntervalTicks { 0 };
+    std::atomic<int> parkedWorkers { 0 };
+    std::atomic<bool> wakeRequested { false };      // set by the audio thread, seen by parked workers
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderPool)
+};
@@ -0,0 +1,313 @@
+/*
+  ==============================================================================
+
+    SampleBank.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleBank.h"
+#include "ModelRegistry.h"
+
+SampleBank::SampleBank (ProceduralModel& owner, Settings bankSettings, RenderFunction renderFunction)
+    : juce::Thread ("QAP sample bank"),
+      model (owner), settings (bankSettings), render (std::move (renderFunction)),
+      numSlots (bankSettings.numVariations * 2),      // new variations are baked before stale ones go
+      variations (std::make_unique<Variation[]> ((size_t) numSlots)),
+      baked (owner, MemoryBudget::sampleBanks)
+{
+}
+
+SampleBank::~SampleBank()
+{
+    stopThread (10000);
+}
+
+void SampleBank::prepare (double sampleRate, int)
+{
+    stop();
+
+    hostSampleRate = sampleRate;
+    bakeSampleRate.store (sampleRate, std::memory_order_relaxed);
+
+    if (! isThreadRunning())
+        startThread (juce::Thread::Priority::low);
+}
+
+void SampleBank::release()
+{
+    stop();
+}
+
+bool SampleBank::canPlay() const noexcept
+{
+    return model.isBakedModeOn() && getNumReady() > 0;
+}
+
+int SampleBank::getNumReady() const noexcept
+{
+    int numReady = 0;
+
+    for (int i = 0; i < numSlots; ++i)
+        if (variations[(size_t) i].state.load (std::memory_order_acquire) == ready)
+            ++numReady;
+
+    return numReady;
+}
+
+bool SampleBank::isFull() const noexcept
+{
+    const int numReady = getNumReady();
+    return numReady >= settings.numVariations
+            || (limitedByBudget.load (std::memory_order_relaxed) && numReady >= minimumVariations);
+}
+
+//==============================================================================
+void SampleBank::run()
+{
+    // Polls for slider moves while baked mode is on, and until what it baked is freed after it
+    // goes off; then sleeps until wake().
+    while (! threadShouldExit())
+        if (! bakeNextVariation())
+            wait (model.isBakedModeOn() || baked.getMemoryBytes() > 0 ? 50 : -1);
+}
+
+void SampleBank::freeVariation (Variation& variation)
+{
+    baked.account (-(juce::int64) (variation.samples.capacity() * sizeof (juce::int16)));
+    std::vector<juce::int16>().swap (variation.samples);
+    variation.length = 0;
+    variation.state.store (empty, std::memory_order_release);
+}
+
+bool SampleBank::bakeNextVariation()
+{
+    const bool enabled = model.isBakedModeOn();
+    const double rate = bakeSampleRate.load (std::memory_order_relaxed);
+    const auto current = enabled ? baked.readParameters() : std::vector<float>();
+
+    int fresh = 0, stale = -1, target = -1, freshSlot = -1, numRetiring = 0;
+    juce::int64 freshBytes = 0;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& variation = variations[(size_t) i];
+        const auto state = variation.state.load (std::memory_order_acquire);
+
+        // A retired variation can go once the last voice playing it has finished.
+        if (state == retiring && ! variation.isHeld())
+            freeVariation (variation);
+        else if (state == retiring)
+            ++numRetiring;
+        else if (state == ready && (! enabled || baked.isStale (variation, current, rate)))
+            stale = i;
+        else if (state == ready)
+        {
+            ++fresh;
+            freshSlot = i;
+            freshBytes += (juce::int64) (variation.samples.capacity() * sizeof (juce::int16));
+        }
+
+        if (variation.state.load (std::memory_order_acquire) == empty && target < 0)
+            target = i;
+    }
+
+    // Over budget: give back one variation at a time, once the last one given back is freed.
+    if (enabled && baked.isOverLimit() && fresh > minimumVariations && numRetiring == 0)
+    {
+        variations[(size_t) freshSlot].state.store (retiring);
+        return false;
+    }
+
+    // Growing needs room in the budget, a replacement for a stale variation does not.
+    const auto expectedBytes = fresh > 0 ? freshBytes / fresh : (juce::int64) (settings.maxSeconds * rate * sizeof (juce::int16));
+    const bool budgetAllows = baked.canGrow (expectedBytes);
+    const bool mayGrow = stale >= 0 || fresh < minimumVariations || budgetAllows;
+    limitedByBudget.store (! budgetAllows, std::memory_order_relaxed);
+
+    if (! enabled || rate <= 0.0 || fresh >= settings.numVariations || target < 0 || ! mayGrow)
+    {
+        // Nothing to bake: whatever no longer matches the sliders can go.
+        for (int i = 0; i < numSlots; ++i)
+        {
+            auto& variation = variations[(size_t) i];
+
+            if (variation.state.load (std::memory_order_acquire) == ready && (! enabled || baked.isStale (variation, current, rate)))
+                variation.state.store (retiring);
+        }
+
+        return false;
+    }
+
+    // Jittered around the sliders, so the variations differ in more than playback pitch and gain.
+    auto& specs = model.getParameterSpecs();
+    auto values = current;
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        const auto range = specs[i].maxValue - specs[i].minValue;
+        values[i] = juce::jlimit (specs[i].minValue, specs[i].maxValue,
+                                  values[i] + (bakeRandom.nextFloat() * 2.0f - 1.0f) * settings.jitter * range);
+    }
+
+    scratch.setSize (1, (int) std::ceil (settings.maxSeconds * rate), false, false, true);
+    scratch.clear();
+
+    const int length = juce::jlimit (0, scratch.getNumSamples(), render (values, rate, scratch));
+
+    if (length < 2)
+        return false;
+
+    auto& variation = variations[(size_t) target];
+    const auto peak = juce::jmax (1.0e-9f, scratch.getMagnitude (0, 0, length));
+
+    baked.account (-(juce::int64) (variation.samples.capacity() * sizeof (juce::int16)));
+    variation.samples.resize ((size_t) length);
+    variation.samples.shrink_to_fit();
+    baked.account ((juce::int64) (variation.samples.capacity() * sizeof (juce::int16)));
+
+    auto* source = scratch.getReadPointer (0);
+
+    for (int i = 0; i < length; ++i)
+        variation.samples[(size_t) i] = (juce::int16) juce::roundToInt (source[i] / peak * 32767.0f);
+
+    variation.length = length;
+    variation.scale = peak / 32767.0f;
+    variation.sampleRate = rate;
+    variation.centre = current;
+    variation.state.store (ready, std::memory_order_release);
+
+    // One in, one out: the bank moves towards the new sliders without ever running dry.
+    if (stale >= 0)
+        variations[(size_t) stale].state.store (retiring);
+
+    return true;
+}
+
+//==============================================================================
+int SampleBank::pickVariation() noexcept
+{
+    const int start = playRandom.nextInt (numSlots);
+    int fallback = -1;
+
+    for (int n = 0; n < numSlots; ++n)
+    {
+        const int i = (start + n) % numSlots;
+        auto& variation = variations[(size_t) i];
+
+        if (variation.state.load (std::memory_order_acquire) != ready)
+            continue;
+
+        if (! variation.claim ([&variation] { return variation.state.load() == ready; }))
+            continue;
+
+        if (i != lastSlot)
+        {
+            if (fallback >= 0)
+                variations[(size_t) fallback].release();
+
+            lastSlot = i;
+            return i;
+        }
+
+        fallback = i;   // only if nothing else is ready: avoid playing the same one twice in a row
+    }
+
+    return fallback;
+}
+
+void SampleBank::startVoice() noexcept
+{
+    for (auto& voice : voices)
+    {
+        if (voice.slot >= 0)
+            continue;
+
+        const int slot = pickVariation();
+
+        if (slot < 0)
+        {
+            baked.noteMiss();
+            return;
+        }
+
+        baked.noteHit();
+
+        const auto semitones = (playRandom.nextFloat() * 2.0f - 1.0f) * settings.pitchSemitones;
+        const auto decibels  = (playRandom.nextFloat() * 2.0f - 1.0f) * settings.gainDecibels;
+
+        voice.slot = slot;
+        voice.position = 0.0;
+        voice.increment = variations[(size_t) slot].sampleRate / hostSampleRate * std::pow (2.0, semitones / 12.0);
+        voice.gain = juce::Decibels::decibelsToGain (decibels);
+        return;
+    }
+}
+
+void SampleBank::stopVoice (Voice& voice) noexcept
+{
+    variations[(size_t) voice.slot].release();
+    voice.slot = -1;
+}
+
+void SampleBank::stop() noexcept
+{
+    for (auto& voice : voices)
+        if (voice.slot >= 0)
+            stopVoice (voice);
+
+    pendingTriggers.store (0);
+}
+
+bool SampleBank::isActive() const noexcept
+{
+    for (auto& voice : voices)
+        if (voice.slot >= 0)
+            return true;
+
+    return pendingTriggers.load (std::memory_order_acquire) > 0;
+}
+
+float SampleBank::renderAdding (juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept
+{
+    for (auto triggers = pendingTriggers.exchange (0, std::memory_order_acquire); triggers > 0; --triggers)
+        startVoice();
+
+    float peak = 0.0f;
+    auto* out = output.getWritePointer (0, startSample);
+
+    for (auto& voice : voices)
+        if (voice.slot >= 0)
+            peak = juce::jmax (peak, renderVoice (voice, out, numSamples));
+
+    return peak;
+}
+
+float SampleBank::renderVoice (Voice& voice, float* out, int numSamples) noexcept
+{
+    auto& variation = variations[(size_t) voice.slot];
+    const auto* data = variation.samples.data();
+    const int last = variation.length - 1;
+    const float scale = variation.scale * voice.gain;
+    float peak = 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto index = (int) voice.position;
+
+        if (index >= last)
+        {
+            stopVoice (voice);
+            break;
+        }
+
+        const auto frac = (float) (voice.position - index);
+        const auto sample = ((float) data[index] + frac * (float) (data[index + 1] - data[index])) * scale;
+
+        out[i] += sample;
+        peak = juce::jmax (peak, std::abs (sample));
+        voice.position += voice.increment;
+    }
+
+    return peak;
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    SampleBank.h
+    "Baked" playback for a procedural model: a background thread renders a
+    bank of variations around the current slider values and keeps it up to
+    date as the sliders move, one variation at a time. Triggers then only
+    pick a variation and play it back with a random pitch and gain, which
+    costs a fraction of rendering the model live. The variations count
+    against the MemoryBudget: under pressure the bank holds fewer of them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BakedAudio.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+class ProceduralModel;
+
+class SampleBank  : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        int numVariations = 16;
+        double maxSeconds = 4.0;        // longest variation the render function may produce
+        float jitter = 0.08f;           // parameter spread around the sliders, as a fraction of each range
+        float pitchSemitones = 2.0f;    // playback spread, +/-
+        float gainDecibels = 3.0f;      // playback spread, +/-
+    };
+
+    // Bank thread: renders one mono variation with the given parameter values (in spec order)
+    // into channel 0 of `output` and returns the number of samples it used.
+    using RenderFunction = std::function<int (const std::vector<float>& parameterValues, double sampleRate,
+                                              juce::AudioBuffer<float>& output)>;
+
+    SampleBank (ProceduralModel& owner, Settings settings, RenderFunction render);
+    ~SampleBank() override;
+
+    static constexpr int maxVoices = 8;
+    static constexpr int minimumVariations = 2;     // kept whatever the budget says
+
+    // Message thread. The bank renders while the owner's baked mode is on and frees its
+    // memory when it goes off.
+    void prepare (double sampleRate, int maximumBlockSize);
+    void release();
+
+    // Any thread: the owner's baked mode changed, see ProceduralModel::bakedModeChanged.
+    void wake()                                     { notify(); }
+
+    bool canPlay() const noexcept;
+    int getNumReady() const noexcept;
+    bool isFull() const noexcept;       // as full as the budget lets it be
+    juce::int64 getMemoryBytes() const noexcept     { return baked.getMemoryBytes(); }
+
+    // Any thread: plays a random variation
+    void trigger() noexcept                         { pendingTriggers.fetch_add (1, std::memory_order_release); }
+
+    //==============================================================================
+    // Audio thread
+    bool isActive() const noexcept;
+    float renderAdding (juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept;
+    void stop() noexcept;
+
+private:
+    enum State { empty, ready, retiring };
+
+    // Stored as 16-bit with a per-variation scale: half the memory of float, and far below
+    // the noise floor of the models.
+    // Held by the voices playing it.
+    struct Variation  : BakedAudio
+    {
+        std::atomic<int> state { empty };
+
+        std::vector<juce::int16> samples;
+        int length = 0;
+        float scale = 0.0f;
+    };
+
+    struct Voice
+    {
+        int slot = -1;
+        double position = 0.0, increment = 1.0;
+        float gain = 1.0f;
+    };
+
+    void run() override;
+    bool bakeNextVariation();
+    void freeVariation (Variation& variation);
+
+    int pickVariation() noexcept;
+    void startVoice() noexcept;
+    void stopVoice (Voice& voice) noexcept;
+    float renderVoice (Voice& voice, float* output, int numSamples) noexcept;
+
+    ProceduralModel& model;
+    const Settings settings;
+    const RenderFunction render;
+
+    const int numSlots;
+    std::unique_ptr<Variation[]> variations;
+    BakedAudioPool baked;
+    std::atomic<bool> limitedByBudget { false };
+    std::atomic<double> bakeSampleRate { 0.0 };
+    juce::AudioBuffer<float> scratch;       // bank thread
+    juce::Random bakeRandom;
+
+    std::atomic<int> pendingTriggers { 0 };
+
+    std::array<Voice, maxVoices> voices;
+    double hostSampleRate = 44100.0;
+    int lastSlot = -1;
+    juce::Random playRandom;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleBank)
+};
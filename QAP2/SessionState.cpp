@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    SessionState.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionState.h"
+
+namespace
+{
+    juce::String getParameterID (const juce::AudioProcessorParameter* parameter)
+    {
+        if (auto* withID = dynamic_cast<const juce::AudioProcessorParameterWithID*> (parameter))
+            return withID->paramID;
+
+        return {};
+    }
+}
+
+void SessionState::write (juce::OutputStream& out, const juce::AudioProcessor& processor, const SessionState& state)
+{
+    auto& params = processor.getParameters();
+
+    out.writeInt (magic);
+    out.writeByte ((char) version);
+    out.writeShort ((short) params.size());
+
+    for (auto* parameter : params)
+    {
+        out.writeString (getParameterID (parameter));
+        out.writeFloat (parameter->getValue());
+    }
+
+    out.writeString (state.libraryRoot);
+    out.writeString (state.searchText);
+    out.writeString (state.proceduralModel);
+    out.writeString (state.projectId);
+}
+
+bool SessionState::read (juce::InputStream& in, juce::AudioProcessor& processor, SessionState& state)
+{
+    if (in.getNumBytesRemaining() < 7 || in.readInt() != magic)
+        return false;
+
+    const auto dataVersion = (juce::uint8) in.readByte();
+
+    if (dataVersion == 0 || dataVersion > version)
+        return false;
+
+    const int numParams = (juce::uint16) in.readShort();
+
+    // A block that ends inside a field is truncated, not a session with empty or cut-off fields.
+    bool truncated = false;
+
+    auto readString = [&in, &truncated]
+    {
+        const auto start = in.getPosition();
+        auto text = in.readString();
+        truncated = truncated || in.getPosition() - start != (juce::int64) text.getNumBytesAsUTF8() + 1;   // and its terminator
+        return text;
+    };
+
+    auto readFloat = [&in, &truncated]
+    {
+        truncated = truncated || in.getNumBytesRemaining() < 4;
+        return in.readFloat();
+    };
+
+    // Parameters are small in number, so a linear lookup per stored entry is fine.
+    auto& params = processor.getParameters();
+    std::vector<std::pair<juce::AudioProcessorParameter*, float>> values;
+
+    for (int i = 0; i < numParams && ! truncated; ++i)
+    {
+        auto id = readString();
+        auto value = readFloat();
+
+        for (auto* parameter : params)
+        {
+            if (getParameterID (parameter) == id)
+            {
+                values.emplace_back (parameter, juce::jlimit (0.0f, 1.0f, value));
+                break;
+            }
+        }
+    }
+
+    SessionState parsed;
+    parsed.libraryRoot = readString();
+    parsed.searchText = readString();
+
+    if (dataVersion == 1)
+    {
+        // Version 1 stored the panel as 0 = none, 1 = explosion, 2 = fire.
+        truncated = truncated || in.isExhausted();
+        const auto mode = in.readByte();
+        parsed.proceduralModel = mode == 1 ? "explosion" : (mode == 2 ? "fire" : "");
+    }
+    else
+    {
+        parsed.proceduralModel = readString();
+    }
+
+    if (dataVersion >= 3)
+        parsed.projectId = readString();
+
+    if (truncated)
+        return false;
+
+    for (auto& value : values)
+        value.first->setValueNotifyingHost (value.second);
+
+    state = parsed;
+    return true;
+}
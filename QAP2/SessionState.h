@@ -0,0 +1,34 @@
+/*
+  ==============================================================================
+
+    SessionState.h
+    Compact binary encoding of everything a session needs to restore a QAP
+    instance: parameter values, library root, search text, procedural mode
+    and the project ID that library usage is recorded under.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct SessionState
+{
+    juce::String libraryRoot;
+    juce::String searchText;
+    juce::String proceduralModel;       // ID of the model whose panel is shown, empty for none
+    juce::String projectId;             // made up once per instance, then kept with the session; empty before version 3
+
+    // Layout: magic, version, parameter count, then (id, normalised value) pairs,
+    // then the strings, the model ID (a mode byte in version 1) and the project ID (from version 3). Parameters are matched by ID on load, so
+    // adding or removing parameters never breaks older sessions.
+    static void write (juce::OutputStream& out, const juce::AudioProcessor& processor, const SessionState& state);
+
+    // Returns false if the data is not a complete QAP state block; `processor` and `state` are
+    // left untouched then. Everything is parsed first, then applied in one go.
+    static bool read (juce::InputStream& in, juce::AudioProcessor& processor, SessionState& state);
+
+    static constexpr juce::int32 magic   = 0x31504151; // "QAP1"
+    static constexpr juce::uint8 version = 3;
+};
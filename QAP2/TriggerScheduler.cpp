@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    TriggerScheduler.cpp
+
+  ==============================================================================
+*/
+
+#include "TriggerScheduler.h"
+#include "ModelRegistry.h"
+
+TriggerScheduler::Sequence TriggerScheduler::Sequence::parse (const juce::String& text)
+{
+    Sequence sequence;
+    auto tokens = juce::StringArray::fromTokens (text.toLowerCase(), " \t,", {});
+
+    for (int i = 0; i + 1 < tokens.size(); ++i)
+    {
+        const auto& word = tokens[i];
+        const auto value = tokens[i + 1];
+
+        if (word == "bar")
+            sequence.bar = juce::jmax (1, value.getIntValue());
+        else if (word == "beat")
+            sequence.beat = juce::jmax (1.0, value.getDoubleValue());
+        else if (word == "x" || word == "times" || word == "count")
+            sequence.count = juce::jmax (0, value.getIntValue());
+        else if (word == "every")
+            sequence.intervalSeconds = value.getDoubleValue() / (value.endsWith ("ms") || tokens[i + 2] == "ms" ? 1000.0 : 1.0);
+        else
+            continue;
+
+        ++i;
+    }
+
+    // A beat on its own means the first bar.
+    if (sequence.beat > 1.0 && sequence.bar <= 0)
+        sequence.bar = 1;
+
+    sequence.intervalSeconds = juce::jlimit (0.01, 3600.0, sequence.intervalSeconds);
+    return sequence;
+}
+
+void TriggerScheduler::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    clock = 0;
+    expectedPpq = -1.0;
+    numEvents = 0;
+
+    for (auto& running : sequences)
+        running.active = false;
+}
+
+//==============================================================================
+bool TriggerScheduler::push (const Command& command) noexcept
+{
+    if (commands.getFreeSpace() == 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    commands.prepareToWrite (1, start1, size1, start2, size2);
+    queue[(size_t) start1] = command;
+    commands.finishedWrite (1);
+    return true;
+}
+
+bool TriggerScheduler::trigger (int model) noexcept
+{
+    return push ({ Command::triggerModel, { model } });
+}
+
+bool TriggerScheduler::start (const Sequence& sequence) noexcept
+{
+    return push ({ Command::startSequence, sequence });
+}
+
+bool TriggerScheduler::stop (int model) noexcept
+{
+    return push ({ Command::stopSequences, { model } });
+}
+
+//==============================================================================
+void TriggerScheduler::applyCommands (const ModelRegistry& models) noexcept
+{
+    int start1, size1, start2, size2;
+    const int numReady = commands.getNumReady();
+    commands.prepareToRead (numReady, start1, size1, start2, size2);
+
+    for (int n = 0; n < size1 + size2; ++n)
+    {
+        auto& command = queue[(size_t) (n < size1 ? start1 + n : start2 + n - size1)];
+        const int model = command.sequence.model;
+
+        if (model < 0 && command.type != Command::stopSequences)
+            continue;
+
+        if (model >= models.size())
+            continue;
+
+        switch (command.type)
+        {
+            case Command::triggerModel:
+                addEvent (0, model);
+                break;
+
+            case Command::startSequence:
+                for (auto& running : sequences)
+                {
+                    if (running.active)
+                        continue;
+
+                    running.sequence = command.sequence;
+                    running.active = true;
+                    running.resync = true;
+                    running.index = 0;
+                    running.emitted = 0;
+                    running.jitter = 0.0f;     // the first event lands exactly where it was asked for
+                    running.origin = clock;
+                    break;
+                }
+                break;
+
+            case Command::stopSequences:
+                for (auto& running : sequences)
+                    if (model < 0 || running.sequence.model == model)
+                        running.active = false;
+                break;
+        }
+    }
+
+    commands.finishedRead (size1 + size2);
+}
+
+void TriggerScheduler::addEvent (int offset, int model) noexcept
+{
+    if (numEvents == maxEventsPerBlock)
+        return;
+
+    // Insertion sort, after any event at the same offset: the list is a handful long.
+    int i = numEvents++;
+
+    for (; i > 0 && events[(size_t) (i - 1)].offset > offset; --i)
+        events[(size_t) i] = events[(size_t) (i - 1)];
+
+    events[(size_t) i] = { offset, model };
+}
+
+void TriggerScheduler::advance (Running& running) noexcept
+{
+    ++running.index;
+    running.jitter = random.nextFloat() * 2.0f - 1.0f;
+}
+
+void TriggerScheduler::collectFree (Running& running, int numSamples, const ModelRegistry& models) noexcept
+{
+    auto& sequence = running.sequence;
+    const double interval = sequence.intervalSeconds * sampleRate;
+    const double spread = 0.5 * interval * (double) models[sequence.model].getSequenceJitter();
+
+    while (running.active)
+    {
+        if (sequence.count > 0 && running.index >= sequence.count)
+        {
+            running.active = false;
+            break;
+        }
+
+        const auto when = running.origin + (juce::int64) std::llround (running.index * interval + running.jitter * spread);
+
+        if (when >= clock + numSamples)
+            break;
+
+        addEvent ((int) juce::jmax ((juce::int64) 0, when - clock), sequence.model);
+        advance (running);
+    }
+}
+
+void TriggerScheduler::collectSynced (Running& running, int numSamples, const juce::AudioPlayHead::PositionInfo& position,
+                                      Jump jump, const ModelRegistry& models) noexcept
+{
+    auto& sequence = running.sequence;
+    const double ppq = *position.getPpqPosition();
+    const double bpm = position.getBpm().orFallback (120.0);
+    const auto signature = position.getTimeSignature().orFallback (juce::AudioPlayHead::TimeSignature {});
+
+    // Bars are counted from the start of the timeline in the current time signature.
+    const double ppqPerBeat = 4.0 / juce::jmax (1, signature.denominator);
+    const double startPpq = (sequence.bar - 1) * signature.numerator * ppqPerBeat + (sequence.beat - 1.0) * ppqPerBeat;
+    const double intervalPpq = sequence.intervalSeconds * bpm / 60.0;
+    const double samplesPerPpq = sampleRate * 60.0 / bpm;
+    const double spread = 0.5 * intervalPpq * (double) models[sequence.model].getSequenceJitter();
+
+    if (jump != Jump::none || running.resync)
+    {
+        // The events are tied to the timeline: after a jump, carry on from the next one. Skipping
+        // ahead never replays an event already emitted; only starting over (transport start, loop,
+        // seek back) does.
+        const int next = juce::jmax (0, (int) std::ceil ((ppq - startPpq) / intervalPpq - 1.0e-9));
+        running.index = jump == Jump::ahead && ! running.resync ? juce::jmax (next, running.emitted) : next;
+        running.jitter = running.index > 0 ? random.nextFloat() * 2.0f - 1.0f : 0.0f;
+        running.resync = false;
+    }
+
+    while (sequence.count == 0 || running.index < sequence.count)
+    {
+        // Rounded the same way in every block, so an event is claimed by exactly one of them.
+        const double when = startPpq + running.index * intervalPpq + running.jitter * spread;
+        const int offset = juce::roundToInt ((when - ppq) * samplesPerPpq);
+
+        if (offset >= numSamples)
+            break;
+
+        // Slightly behind the host (its rounding, or jitter past the block start): late rather than lost.
+        addEvent (juce::jmax (0, offset), sequence.model);
+        advance (running);
+        running.emitted = running.index;
+    }
+}
+
+int TriggerScheduler::collect (int numSamples, juce::AudioPlayHead* playHead, const ModelRegistry& models) noexcept
+{
+    numEvents = 0;
+    applyCommands (models);
+
+    juce::Optional<juce::AudioPlayHead::PositionInfo> position;
+
+    if (playHead != nullptr)
+        position = playHead->getPosition();
+
+    const bool playing = position.hasValue() && position->getIsPlaying() && position->getPpqPosition().hasValue();
+    const double ppq = playing ? *position->getPpqPosition() : 0.0;
+    auto jump = Jump::none;
+
+    if (playing)
+    {
+        const double tolerance = jumpSeconds * position->getBpm().orFallback (120.0) / 60.0;
+
+        if (expectedPpq < 0.0 || ppq < expectedPpq - tolerance)
+            jump = Jump::back;
+        else if (ppq > expectedPpq + tolerance)
+            jump = Jump::ahead;
+    }
+
+    for (auto& running : sequences)
+    {
+        if (! running.active)
+            continue;
+
+        if (running.sequence.bar <= 0)
+            collectFree (running, numSamples, models);
+        else if (playing)
+            collectSynced (running, numSamples, *position, jump, models);
+    }
+
+    expectedPpq = playing ? ppq + numSamples * position->getBpm().orFallback (120.0) / (60.0 * sampleRate) : -1.0;
+    clock += numSamples;
+    return numEvents;
+}
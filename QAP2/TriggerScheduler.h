@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    TriggerScheduler.h
+    Queue of model triggers that the audio thread consumes with sample-offset
+    precision: single triggers from the editor, and repeating sequences that
+    either run free from the moment they start or are locked to the host
+    timeline ("bar 3 beat 2 every 1.5 s"). Commands reach the audio thread
+    through a lock-free FIFO; sequences live in a fixed table, so nothing is
+    allocated per event.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class ModelRegistry;
+
+class TriggerScheduler
+{
+public:
+    static constexpr int maxSequences = 8;
+    static constexpr int maxEventsPerBlock = 64;
+
+    struct Sequence
+    {
+        int model = -1;                 // registry slot
+        double intervalSeconds = 1.5;
+        int count = 0;                  // events, 0 = until stopped
+
+        // Host-synced start (1-based). With bar <= 0 the sequence runs free from the next block.
+        int bar = 0;
+        double beat = 1.0;
+
+        // Parses e.g. "bar 3 beat 2 every 1.5 s x 8"; every part is optional.
+        static Sequence parse (const juce::String& text);
+    };
+
+    struct Event
+    {
+        int offset;                     // sample in the block
+        int model;
+    };
+
+    void prepare (double sampleRate);
+
+    //==============================================================================
+    // Message thread, lock free. Return false if the queue is full.
+    bool trigger (int model) noexcept;                      // at the start of the next block
+    bool start (const Sequence& sequence) noexcept;
+    bool stop (int model) noexcept;                         // its sequences; -1 stops them all
+
+    //==============================================================================
+    // Audio thread: collects the events that fall into the next `numSamples`, in time order.
+    // Sequence spacing is jittered by each model's getSequenceJitter().
+    int collect (int numSamples, juce::AudioPlayHead* playHead, const ModelRegistry& models) noexcept;
+    const Event& getEvent (int index) const noexcept    { return events[(size_t) index]; }
+
+private:
+    struct Command
+    {
+        enum Type { triggerModel, startSequence, stopSequences } type;
+        Sequence sequence;
+    };
+
+    struct Running
+    {
+        Sequence sequence;
+        bool active = false;
+        bool resync = true;             // synced: find the next event from the host position first
+        int index = 0;                  // of the next event
+        int emitted = 0;                // synced: index after the last event emitted, kept across a jump ahead
+        float jitter = 0.0f;            // of the next event, -1 .. 1
+        juce::int64 origin = 0;         // free-running: first event, on the scheduler's own clock
+    };
+
+    bool push (const Command& command) noexcept;
+    void applyCommands (const ModelRegistry& models) noexcept;
+    void addEvent (int offset, int model) noexcept;
+    void advance (Running& running) noexcept;
+    void collectFree (Running& running, int numSamples, const ModelRegistry& models) noexcept;
+    enum class Jump { none, ahead, back };  // of the host position against where it should be
+
+    void collectSynced (Running& running, int numSamples, const juce::AudioPlayHead::PositionInfo& position,
+                        Jump jump, const ModelRegistry& models) noexcept;
+
+    static constexpr int queueSize = 64;
+    static constexpr double jumpSeconds = 0.01;     // hosts round and drift by less; loops and seeks move further
+    juce::AbstractFifo commands { queueSize };
+    std::array<Command, queueSize> queue {};
+
+    // Audio thread only
+    std::array<Running, maxSequences> sequences;
+    std::array<Event, maxEventsPerBlock> events {};
+    int numEvents = 0;
+    double sampleRate = 44100.0;
+    juce::int64 clock = 0;              // samples rendered since prepare
+    double expectedPpq = -1.0;          // where the host should be next block if it keeps playing
+    juce::Random random;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TriggerScheduler)
+};
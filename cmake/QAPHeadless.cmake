@@ -0,0 +1,42 @@
+# qap_add_headless_executable(<target> <sources>...)
+#
+# Builds a console executable that contains the QAP2 processor sources, the
+# procedural models and the given sources, with the JucePlugin_* macros the
+# processor expects from a plugin build.
+#
+# Without QAP_MODELS_DIR the header-only stand-ins in Headless/Stubs are used,
+# so everything builds on a plain Linux box without the nemisindo sources.
+
+if(NOT QAP_MODELS_DIR)
+    set(QAP_MODELS_DIR "${PROJECT_SOURCE_DIR}/Headless/Stubs")
+    message(STATUS "QAP: QAP_MODELS_DIR not set, using the stub Explosion/Fire models")
+endif()
+
+file(GLOB QAP_PROCESSOR_SOURCES CONFIGURE_DEPENDS "${PROJECT_SOURCE_DIR}/QAP2/*.cpp")
+file(GLOB QAP_MODEL_SOURCES CONFIGURE_DEPENDS "${QAP_MODELS_DIR}/*.cpp")
+
+function(qap_add_headless_executable target)
+    juce_add_console_app(${target} PRODUCT_NAME ${target})
+    juce_generate_juce_header(${target})
+
+    target_sources(${target} PRIVATE ${ARGN} ${QAP_PROCESSOR_SOURCES} ${QAP_MODEL_SOURCES})
+
+    target_include_directories(${target} PRIVATE
+        "${PROJECT_SOURCE_DIR}/QAP2"
+        "${QAP_MODELS_DIR}")
+
+    target_compile_definitions(${target} PRIVATE
+        JucePlugin_Name="QAP"
+        JucePlugin_WantsMidiInput=1
+        JucePlugin_ProducesMidiOutput=0
+        JucePlugin_IsMidiEffect=0
+        JucePlugin_IsSynth=0
+        JUCE_WEB_BROWSER=0
+        JUCE_USE_CURL=0
+        JUCE_DISPLAY_SPLASH_SCREEN=0)
+
+    target_link_libraries(${target} PRIVATE
+        juce::juce_audio_utils
+        juce::juce_recommended_config_flags
+        juce::juce_recommended_warning_flags)
+endfunction()